@@ -18,10 +18,34 @@ function(auto_test subsystem module)
     COMMAND ${TEST_CROSSCOMPILING_EMULATOR} test_${module})
 endfunction()
 
+function(auto_bench subsystem module)
+  add_executable(bench_${module}
+    test/${subsystem}/${module}_bench.cpp)
+  target_link_libraries(bench_${module}
+    ${PROJECT_NAME}_static
+    Qt5::Test)
+endfunction()
+
 auto_test(core toxpk)
 auto_test(core toxid)
+auto_test(core spscqueue)
+auto_test(core filereadahead)
+auto_test(core filewritebehind)
+auto_test(core transferregistry)
+auto_test(core transferscheduler)
+auto_test(core tracer)
+auto_test(core memoryusage)
+auto_test(audio audiomixer)
+auto_test(audio gainkernel)
 auto_test(chatlog textformatter)
 auto_test(net toxmedata)
+auto_test(persistence settingsserializer)
+auto_test(persistence savescheduler)
 if (UNIX)
   auto_test(platform posixsignalnotifier)
 endif()
+
+if (BENCHMARKS)
+  auto_bench(audio gainkernel)
+  auto_bench(core filetransfer)
+endif()
@@ -120,6 +120,11 @@
  * @param[in] channels number of channels, currently 1 or 2 is supported
  * @param[in] sampleRate sample rate in Hertz
  *
+ * @fn qreal Audio::captureLatency() const
+ * @brief time between a captured frame being complete and being sent
+ *
+ * @return smoothed latency in milliseconds, 0 if nothing was sent yet
+ *
  * @fn bool Audio::isOutputReady() const
  * @brief check if the output is ready to play audio
  *
@@ -107,6 +107,8 @@ public:
     virtual void playAudioBuffer(uint sourceId, const int16_t* data, int samples, unsigned channels,
                                  int sampleRate) = 0;
 
+    virtual qreal captureLatency() const = 0;
+
 protected:
     // Public default audio settings
     static constexpr uint32_t AUDIO_SAMPLE_RATE = 48000;
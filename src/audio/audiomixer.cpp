@@ -0,0 +1,226 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "audiomixer.h"
+
+#include <QDebug>
+
+#include <algorithm>
+#include <limits>
+
+/**
+ * @class AudioMixer
+ * @brief Mixes the audio of all peers of a group call into a single stream.
+ *
+ * Every peer gets a small jitter buffer. The peer with the most buffered audio clocks the
+ * output: as soon as it holds JITTER_FRAMES frames, one frame is taken from every peer that
+ * has a complete frame, scaled by the peer's gain and summed with saturation. Peers that
+ * fall behind contribute silence for that frame, peers that run ahead are trimmed to
+ * MAX_BUFFERED_FRAMES so latency stays bounded.
+ *
+ * The output format (rate, channels, frame size) is taken from the first frame received
+ * after construction or clear(), frames of other peers are converted to its channel layout.
+ *
+ * The mixing loops work on plain int32 arrays without branches, so the compiler can
+ * vectorize them.
+ *
+ * @note Not thread safe, all calls have to come from the same thread.
+ *
+ * @var AudioMixer::GAIN_SHIFT
+ * @brief Peer gains are stored as fixed point numbers with this many fractional bits.
+ *
+ * @var AudioMixer::JITTER_FRAMES
+ * @brief Number of frames the fullest peer has to buffer before a frame is mixed.
+ *
+ * @var AudioMixer::MAX_BUFFERED_FRAMES
+ * @brief Number of frames after which a peer's oldest audio is dropped.
+ */
+
+/**
+ * @brief Appends a frame of a peer to its jitter buffer.
+ * @param peer Peer number in the group.
+ * @param pcm Interleaved samples.
+ * @param samples Number of samples per channel.
+ * @param channels Number of channels of pcm, 1 or 2.
+ * @param rate Sample rate of pcm, frames not matching the output rate are dropped.
+ */
+void AudioMixer::addPeerFrame(int peer, const int16_t* pcm, unsigned samples, uint8_t channels,
+                              uint32_t rate)
+{
+    if (!samples || (channels != 1 && channels != 2)) {
+        return;
+    }
+
+    if (!this->rate) {
+        this->rate = rate;
+        this->channels = channels;
+        samplesPerFrame = samples;
+        accumulator.resize(frameLength());
+        output.resize(frameLength());
+    }
+
+    if (rate != this->rate) {
+        qDebug() << "Dropping group audio of peer" << peer << "with unexpected sample rate" << rate;
+        return;
+    }
+
+    std::vector<int16_t>& buffer = peers[peer].pcm;
+    const size_t oldSize = buffer.size();
+    buffer.resize(oldSize + samples * this->channels);
+    int16_t* dst = buffer.data() + oldSize;
+
+    if (channels == this->channels) {
+        std::copy(pcm, pcm + samples * channels, dst);
+    } else if (channels == 1) {
+        for (unsigned i = 0; i < samples; ++i) {
+            dst[2 * i] = pcm[i];
+            dst[2 * i + 1] = pcm[i];
+        }
+    } else {
+        for (unsigned i = 0; i < samples; ++i) {
+            dst[i] = static_cast<int16_t>((pcm[2 * i] + pcm[2 * i + 1]) / 2);
+        }
+    }
+
+    const size_t maxLength = MAX_BUFFERED_FRAMES * frameLength();
+    if (buffer.size() > maxLength) {
+        // drop the oldest audio down to the jitter target, we're too far behind this peer
+        const size_t excess = buffer.size() - JITTER_FRAMES * frameLength();
+        buffer.erase(buffer.begin(), buffer.begin() + excess);
+    }
+}
+
+/**
+ * @brief Forgets a peer and its buffered audio, e.g. when the peer left the group.
+ */
+void AudioMixer::removePeer(int peer)
+{
+    peers.remove(peer);
+}
+
+/**
+ * @brief Forgets all peers and the output format.
+ */
+void AudioMixer::clear()
+{
+    peers.clear();
+    accumulator.clear();
+    output.clear();
+    samplesPerFrame = 0;
+    channels = 0;
+    rate = 0;
+}
+
+/**
+ * @brief Sets the linear gain applied to a peer's audio.
+ * @param peer Peer number in the group.
+ * @param gain Linear gain between 0 (muted) and 8.
+ */
+void AudioMixer::setPeerGain(int peer, qreal gain)
+{
+    peers[peer].gain = static_cast<int32_t>(qBound(0.0, gain, 8.0) * UNITY_GAIN);
+}
+
+/**
+ * @brief Mixes the next frame, if enough audio is buffered.
+ * @return True if a frame is available through frameData(), false otherwise.
+ */
+bool AudioMixer::mixFrame()
+{
+    const size_t length = frameLength();
+    if (!length) {
+        return false;
+    }
+
+    size_t fullest = 0;
+    for (const PeerBuffer& peer : peers) {
+        fullest = std::max(fullest, peer.pcm.size());
+    }
+
+    if (fullest < JITTER_FRAMES * length) {
+        return false;
+    }
+
+    int32_t* acc = accumulator.data();
+    std::fill(accumulator.begin(), accumulator.end(), 0);
+
+    for (PeerBuffer& peer : peers) {
+        if (peer.pcm.size() < length) {
+            // underrun, this peer is silent for this frame
+            continue;
+        }
+
+        const int16_t* pcm = peer.pcm.data();
+        const int32_t gain = peer.gain;
+        for (size_t i = 0; i < length; ++i) {
+            acc[i] += (pcm[i] * gain) >> GAIN_SHIFT;
+        }
+
+        peer.pcm.erase(peer.pcm.begin(), peer.pcm.begin() + length);
+    }
+
+    int16_t* out = output.data();
+    for (size_t i = 0; i < length; ++i) {
+        out[i] = static_cast<int16_t>(std::min<int32_t>(std::max<int32_t>(acc[i],
+                                                        std::numeric_limits<int16_t>::min()),
+                                                        std::numeric_limits<int16_t>::max()));
+    }
+
+    return true;
+}
+
+/**
+ * @brief Returns the interleaved samples of the last mixed frame.
+ */
+const int16_t* AudioMixer::frameData() const
+{
+    return output.data();
+}
+
+/**
+ * @brief Returns the number of samples per channel of a mixed frame.
+ */
+unsigned AudioMixer::frameSamples() const
+{
+    return samplesPerFrame;
+}
+
+/**
+ * @brief Returns the number of channels of a mixed frame.
+ */
+uint8_t AudioMixer::frameChannels() const
+{
+    return channels;
+}
+
+/**
+ * @brief Returns the sample rate of a mixed frame.
+ */
+uint32_t AudioMixer::frameRate() const
+{
+    return rate;
+}
+
+/**
+ * @brief Number of interleaved samples in one frame.
+ */
+size_t AudioMixer::frameLength() const
+{
+    return samplesPerFrame * channels;
+}
@@ -0,0 +1,70 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef AUDIOMIXER_H
+#define AUDIOMIXER_H
+
+#include <QHash>
+#include <QtGlobal>
+
+#include <cstdint>
+#include <vector>
+
+class AudioMixer
+{
+public:
+    AudioMixer() = default;
+
+    void addPeerFrame(int peer, const int16_t* pcm, unsigned samples, uint8_t channels,
+                      uint32_t rate);
+    void removePeer(int peer);
+    void clear();
+
+    void setPeerGain(int peer, qreal gain);
+
+    bool mixFrame();
+    const int16_t* frameData() const;
+    unsigned frameSamples() const;
+    uint8_t frameChannels() const;
+    uint32_t frameRate() const;
+
+private:
+    struct PeerBuffer
+    {
+        std::vector<int16_t> pcm;
+        int32_t gain = UNITY_GAIN;
+    };
+
+    size_t frameLength() const;
+
+private:
+    static constexpr int GAIN_SHIFT = 12;
+    static constexpr int32_t UNITY_GAIN = 1 << GAIN_SHIFT;
+    static constexpr unsigned JITTER_FRAMES = 2;
+    static constexpr unsigned MAX_BUFFERED_FRAMES = 6;
+
+    QHash<int, PeerBuffer> peers;
+    std::vector<int32_t> accumulator;
+    std::vector<int16_t> output;
+    unsigned samplesPerFrame = 0;
+    uint8_t channels = 0;
+    uint32_t rate = 0;
+};
+
+#endif // AUDIOMIXER_H
@@ -18,11 +18,13 @@
 */
 
 #include "openal.h"
+#include "src/audio/gainkernel.h"
 #include "src/core/core.h"
 #include "src/core/coreav.h"
 #include "src/persistence/settings.h"
 
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QMutexLocker>
 #include <QPointer>
@@ -32,18 +34,6 @@
 
 #include <cassert>
 
-namespace {
-    void applyGain(int16_t* buffer, uint32_t bufferSize, qreal gainFactor)
-    {
-        for (quint32 i = 0; i < bufferSize; ++i) {
-            // gain amplification with clipping to 16-bit boundaries
-            buffer[i] = qBound<int16_t>(std::numeric_limits<int16_t>::min(),
-                                   qRound(buffer[i] * gainFactor),
-                                   std::numeric_limits<int16_t>::max());
-        }
-    }
-}
-
 /**
  * @class OpenAL
  * @brief Provides the OpenAL audio backend
@@ -51,6 +41,21 @@ namespace {
  * @var BUFFER_COUNT
  * @brief Number of buffers to use per audio source
  *
+ * The buffers are allocated once when the source is subscribed and recycled while playing,
+ * see the underrun and overrun counters logged when a source is removed to tune this value.
+ *
+ * @struct OpenAL::OutputSource
+ * @brief Ring of preallocated buffers belonging to one audio source.
+ *
+ * @var OpenAL::OutputSource::freeBuffers
+ * @brief Buffers not queued on the source, ready to be filled.
+ *
+ * @var OpenAL::OutputSource::underruns
+ * @brief Number of times the source ran dry and stopped before new audio arrived.
+ *
+ * @var OpenAL::OutputSource::overruns
+ * @brief Number of frames dropped because all buffers were still queued.
+ *
  * @var AUDIO_CHANNELS
  * @brief Ideally, we'd auto-detect, but that's a sane default
  */
@@ -78,12 +83,12 @@ OpenAL::OpenAL()
     connect(this, &Audio::startActive, &voiceTimer, static_cast<void (QTimer::*)(int)>(&QTimer::start));
     connect(&voiceTimer, &QTimer::timeout, this, &Audio::stopActive);
 
+    // the timer is rescheduled by doAudio for exactly when the next frame is ready and stays
+    // stopped while there's nothing to capture or play
     connect(&captureTimer, &QTimer::timeout, this, &OpenAL::doAudio);
-    captureTimer.setInterval(AUDIO_FRAME_DURATION / 2);
-    captureTimer.setSingleShot(false);
+    captureTimer.setSingleShot(true);
+    captureTimer.setTimerType(Qt::PreciseTimer);
     captureTimer.moveToThread(audioThread);
-    // TODO for Qt 5.6+: use qOverload
-    connect(audioThread, &QThread::started, &captureTimer, static_cast<void (QTimer::*)(void)>(&QTimer::start));
 
     connect(&playMono16Timer, &QTimer::timeout, this, &OpenAL::playMono16SoundCleanup);
     playMono16Timer.setSingleShot(true);
@@ -114,6 +119,63 @@ void OpenAL::checkAlcError(ALCdevice* device) noexcept
         qWarning("OpenAL error: %d", alc_err);
 }
 
+/**
+ * @brief Allocates the buffers of a source, all of them start out free.
+ * @param source Source to allocate the buffers for.
+ * @param count Number of buffers to allocate.
+ */
+void OpenAL::initSourceBuffers(OutputSource& source, int count)
+{
+    source.buffers.resize(count);
+    alGenBuffers(count, source.buffers.data());
+    checkAlError();
+    source.freeBuffers = source.buffers;
+}
+
+/**
+ * @brief Detaches and deletes all buffers of a source.
+ * @param sourceId OpenAL source the buffers are queued on.
+ * @param source Source to free the buffers of.
+ */
+void OpenAL::deleteSourceBuffers(ALuint sourceId, OutputSource& source)
+{
+    if (source.buffers.isEmpty()) {
+        return;
+    }
+
+    // stopping marks all buffers as processed, detaching the buffer unqueues them all
+    alSourceStop(sourceId);
+    alSourcei(sourceId, AL_BUFFER, AL_NONE);
+    alDeleteBuffers(source.buffers.size(), source.buffers.data());
+    checkAlError();
+    source.buffers.clear();
+    source.freeBuffers.clear();
+}
+
+/**
+ * @brief Reclaims all processed buffers of a source and returns one of them.
+ * @param sourceId OpenAL source the buffers are queued on.
+ * @param source Source to take the buffer from.
+ * @return A free buffer, or 0 if all buffers are still queued.
+ */
+ALuint OpenAL::takeFreeBuffer(ALuint sourceId, OutputSource& source)
+{
+    ALint processed = 0;
+    alGetSourcei(sourceId, AL_BUFFERS_PROCESSED, &processed);
+
+    if (processed > 0) {
+        const int oldSize = source.freeBuffers.size();
+        source.freeBuffers.resize(oldSize + processed);
+        alSourceUnqueueBuffers(sourceId, processed, source.freeBuffers.data() + oldSize);
+    }
+
+    if (source.freeBuffers.isEmpty()) {
+        return 0;
+    }
+
+    return source.freeBuffers.takeLast();
+}
+
 /**
  * @brief Returns the current output volume (between 0 and 1)
  */
@@ -217,13 +279,16 @@ void OpenAL::reinitInput(const QString& inDevDesc)
     QMutexLocker locker(&audioLock);
     cleanupInput();
     initInput(inDevDesc);
+    wakeAudioLoop();
 }
 
 bool OpenAL::reinitOutput(const QString& outDevDesc)
 {
     QMutexLocker locker(&audioLock);
     cleanupOutput();
-    return initOutput(outDevDesc);
+    const bool ok = initOutput(outDevDesc);
+    wakeAudioLoop();
+    return ok;
 }
 
 /**
@@ -242,6 +307,7 @@ void OpenAL::subscribeInput()
 
     ++inSubscriptions;
     qDebug() << "Subscribed to audio input device [" << inSubscriptions << "subscriptions ]";
+    wakeAudioLoop();
 }
 
 /**
@@ -260,8 +326,10 @@ void OpenAL::unsubscribeInput()
     qDebug() << "Unsubscribed from audio input device [" << inSubscriptions
              << "subscriptions left ]";
 
-    if (!inSubscriptions)
+    if (!inSubscriptions) {
+        qDebug() << "Audio capture to send latency was" << captureLatencyMs << "ms";
         cleanupInput();
+    }
 }
 
 /**
@@ -318,6 +386,7 @@ bool OpenAL::initInput(const QString& deviceName, uint32_t channels)
     }
 
     inputBuffer = new int16_t[AUDIO_FRAME_SAMPLE_COUNT_TOTAL];
+    qDebug() << "Using" << GainKernel::implementationName() << "input gain kernel";
     setInputGain(Settings::getInstance().getAudioInGainDecibel());
     setInputThreshold(Settings::getInstance().getAudioThreshold());
 
@@ -425,33 +494,32 @@ void OpenAL::playAudioBuffer(uint sourceId, const int16_t* data, int samples, un
     if (!(alOutDev && outputInitialized))
         return;
 
-    ALuint bufids[BUFFER_COUNT];
-    ALint processed = 0, queued = 0;
-    alGetSourcei(sourceId, AL_BUFFERS_PROCESSED, &processed);
-    alGetSourcei(sourceId, AL_BUFFERS_QUEUED, &queued);
+    auto it = peerSources.find(sourceId);
+    if (it == peerSources.end()) {
+        return;
+    }
+
+    OutputSource& source = it.value();
     alSourcei(sourceId, AL_LOOPING, AL_FALSE);
 
-    if (processed == 0) {
-        if (static_cast<ALuint>(queued) >= BUFFER_COUNT) {
-            // reached limit, drop audio
-            return;
-        }
-        // create new buffer if none got free and we're below the limit
-        alGenBuffers(1, bufids);
-    } else {
-        // unqueue all processed buffers
-        alSourceUnqueueBuffers(sourceId, processed, bufids);
-        // delete all but the first buffer, reuse first for new data
-        alDeleteBuffers(processed - 1, bufids + 1);
+    const ALuint bufid = takeFreeBuffer(sourceId, source);
+    if (!bufid) {
+        // reached limit, drop audio
+        ++source.overruns;
+        return;
     }
 
-    alBufferData(bufids[0], (channels == 1) ? AL_FORMAT_MONO16 : AL_FORMAT_STEREO16, data,
+    alBufferData(bufid, (channels == 1) ? AL_FORMAT_MONO16 : AL_FORMAT_STEREO16, data,
                  samples * 2 * channels, sampleRate);
-    alSourceQueueBuffers(sourceId, 1, bufids);
+    alSourceQueueBuffers(sourceId, 1, &bufid);
 
     ALint state;
     alGetSourcei(sourceId, AL_SOURCE_STATE, &state);
     if (state != AL_PLAYING) {
+        if (state == AL_STOPPED) {
+            // the source played everything we gave it before new audio arrived
+            ++source.underruns;
+        }
         alSourcePlay(sourceId);
     }
 }
@@ -531,29 +599,6 @@ void OpenAL::playMono16SoundCleanup()
     }
 }
 
-/**
- * @brief Called by doCapture to calculate volume of the audio buffer
- *
- * @param[in] buf   the current audio buffer
- *
- * @return normalized volume between 0-1
- */
-float OpenAL::getVolume()
-{
-    const quint32 samples = AUDIO_FRAME_SAMPLE_COUNT_TOTAL;
-    const float rootTwo = 1.414213562; // sqrt(2), but sqrt is not constexpr
-    // calculate volume as the root mean squared of amplitudes in the sample
-    float sumOfSquares = 0;
-    for (quint32 i = 0; i < samples; i++) {
-        float sample = static_cast<float>(inputBuffer[i]) / std::numeric_limits<int16_t>::max();
-        sumOfSquares += std::pow(sample , 2);
-    }
-    const float rms = std::sqrt(sumOfSquares/samples);
-    // our calculated normalized volume could possibly be above 1 because our RMS assumes a sinusoidal wave
-    const float normalizedVolume = std::min(rms * rootTwo, 1.0f);
-    return normalizedVolume;
-}
-
 /**
  * @brief Called by voiceTimer's timeout to disable audio broadcasting
  */
@@ -564,33 +609,52 @@ void OpenAL::stopActive()
 
 /**
  * @brief handles recording of audio frames
+ *
+ * Captures all complete frames, so we catch up in one go if the audio thread fell behind.
  */
 void OpenAL::doInput()
 {
+    QElapsedTimer elapsed;
+    elapsed.start();
+
     ALint curSamples = 0;
     alcGetIntegerv(alInDev, ALC_CAPTURE_SAMPLES, sizeof(curSamples), &curSamples);
-    if (curSamples < static_cast<ALint>(AUDIO_FRAME_SAMPLE_COUNT_PER_CHANNEL)) {
-        return;
-    }
-
-    captureSamples(alInDev, inputBuffer, AUDIO_FRAME_SAMPLE_COUNT_PER_CHANNEL);
+    const ALint frameSamples = static_cast<ALint>(AUDIO_FRAME_SAMPLE_COUNT_PER_CHANNEL);
+
+    for (; curSamples >= frameSamples; curSamples -= frameSamples) {
+        // this frame was complete before the samples recorded after it came in
+        const qint64 backlogUs = static_cast<qint64>(curSamples - frameSamples) * 1000000
+                                 / static_cast<qint64>(AUDIO_SAMPLE_RATE);
+
+        captureSamples(alInDev, inputBuffer, AUDIO_FRAME_SAMPLE_COUNT_PER_CHANNEL);
+
+        // amplify and measure the frame in a single pass
+        const GainKernel::Level level =
+            GainKernel::apply(inputBuffer, AUDIO_FRAME_SAMPLE_COUNT_TOTAL, gainFactor);
+
+        const float rootTwo = 1.414213562; // sqrt(2), but sqrt is not constexpr
+        // our calculated normalized volume could possibly be above 1 because our RMS assumes a sinusoidal wave
+        float volume = std::min(level.rms * rootTwo, 1.0f);
+        if (volume >= inputThreshold) {
+            isActive = true;
+            emit startActive(voiceHold);
+        } else if (!isActive) {
+            volume = 0;
+        }
 
-    applyGain(inputBuffer, AUDIO_FRAME_SAMPLE_COUNT_TOTAL, gainFactor);
+        emit Audio::volumeAvailable(volume);
+        if (!isActive) {
+            continue;
+        }
 
-    float volume = getVolume();
-    if (volume >= inputThreshold) {
-        isActive = true;
-        emit startActive(voiceHold);
-    } else if (!isActive) {
-        volume = 0;
-    }
+        emit Audio::frameAvailable(inputBuffer, AUDIO_FRAME_SAMPLE_COUNT_PER_CHANNEL, channels, AUDIO_SAMPLE_RATE);
 
-    emit Audio::volumeAvailable(volume);
-    if (!isActive) {
-        return;
+        // receivers send the frame synchronously, so this is the capture to send latency
+        const qreal latencyMs = (backlogUs + elapsed.nsecsElapsed() / 1000) / 1000.0;
+        captureLatencyMs = captureLatencyMs > 0
+                               ? captureLatencyMs + (latencyMs - captureLatencyMs) / 16
+                               : latencyMs;
     }
-
-    emit Audio::frameAvailable(inputBuffer, AUDIO_FRAME_SAMPLE_COUNT_PER_CHANNEL, channels, AUDIO_SAMPLE_RATE);
 }
 
 void OpenAL::doOutput()
@@ -605,15 +669,55 @@ void OpenAL::doAudio()
 {
     QMutexLocker lock(&audioLock);
 
+    const bool output = outputInitialized && !peerSources.isEmpty();
+    const bool input = alInDev && inSubscriptions;
+
     // Output section
-    if (outputInitialized && !peerSources.isEmpty()) {
+    if (output) {
         doOutput();
     }
 
     // Input section
-    if (alInDev && inSubscriptions) {
+    if (input) {
         doInput();
     }
+
+    int delayMs = -1;
+    if (input) {
+        // sleep until the device has recorded the missing part of the next frame
+        ALint curSamples = 0;
+        alcGetIntegerv(alInDev, ALC_CAPTURE_SAMPLES, sizeof(curSamples), &curSamples);
+        const ALint missing = static_cast<ALint>(AUDIO_FRAME_SAMPLE_COUNT_PER_CHANNEL) - curSamples;
+        delayMs = missing > 0 ? (missing * 1000 + AUDIO_SAMPLE_RATE - 1) / AUDIO_SAMPLE_RATE : 0;
+    }
+
+    if (output) {
+        // the output is fed in half frames to keep its queue from running dry
+        const int outputDelayMs = AUDIO_FRAME_DURATION / 2;
+        delayMs = delayMs < 0 ? outputDelayMs : std::min(delayMs, outputDelayMs);
+    }
+
+    if (delayMs >= 0) {
+        captureTimer.start(delayMs);
+    }
+}
+
+/**
+ * @brief Restarts the audio loop after it went idle.
+ * @note Can be called from any thread.
+ */
+void OpenAL::wakeAudioLoop()
+{
+    QMetaObject::invokeMethod(&captureTimer, "start", Q_ARG(int, 0));
+}
+
+/**
+ * @brief Returns the smoothed time between a frame being recorded and being sent, in ms.
+ */
+qreal OpenAL::captureLatency() const
+{
+    QMutexLocker locker(&audioLock);
+    return captureLatencyMs;
 }
 
 void OpenAL::captureSamples(ALCdevice* device, int16_t* buffer, ALCsizei samples)
@@ -675,31 +779,24 @@ void OpenAL::subscribeOutput(uint& sid)
 
     alGenSources(1, &sid);
     assert(sid);
-    peerSources << sid;
+    initSourceBuffers(peerSources[sid], BUFFER_COUNT);
 
     qDebug() << "Audio source" << sid << "created. Sources active:" << peerSources.size();
+    wakeAudioLoop();
 }
 
 void OpenAL::unsubscribeOutput(uint& sid)
 {
     QMutexLocker locker(&audioLock);
 
-    peerSources.removeAll(sid);
+    OutputSource source = peerSources.take(sid);
 
     if (sid) {
         if (alIsSource(sid)) {
-            // stop playing, marks all buffers as processed
-            alSourceStop(sid);
-            // unqueue all buffers from the source
-            ALint processed = 0;
-            alGetSourcei(sid, AL_BUFFERS_PROCESSED, &processed);
-            ALuint* bufids = new ALuint[processed];
-            alSourceUnqueueBuffers(sid, processed, bufids);
-            // delete all buffers
-            alDeleteBuffers(processed, bufids);
-            delete[] bufids;
+            deleteSourceBuffers(sid, source);
             alDeleteSources(1, &sid);
-            qDebug() << "Audio source" << sid << "deleted. Sources active:" << peerSources.size();
+            qDebug() << "Audio source" << sid << "deleted. Sources active:" << peerSources.size()
+                     << "Underruns:" << source.underruns << "Overruns:" << source.overruns;
         } else {
             qWarning() << "Trying to delete invalid audio source" << sid;
         }
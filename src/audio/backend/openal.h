@@ -26,9 +26,11 @@
 #include <atomic>
 #include <cmath>
 
+#include <QHash>
 #include <QMutex>
 #include <QObject>
 #include <QTimer>
+#include <QVector>
 
 #include <cassert>
 
@@ -91,8 +93,21 @@ public:
     void playAudioBuffer(uint sourceId, const int16_t* data, int samples, unsigned channels,
                          int sampleRate);
 
+    qreal captureLatency() const;
+
 protected:
+    struct OutputSource
+    {
+        QVector<ALuint> buffers;
+        QVector<ALuint> freeBuffers;
+        quint64 underruns = 0;
+        quint64 overruns = 0;
+    };
+
     static void checkAlError() noexcept;
+    static void initSourceBuffers(OutputSource& source, int count);
+    static void deleteSourceBuffers(ALuint sourceId, OutputSource& source);
+    static ALuint takeFreeBuffer(ALuint sourceId, OutputSource& source);
     static void checkAlcError(ALCdevice* device) noexcept;
 
     qreal inputGainFactor() const;
@@ -105,6 +120,7 @@ protected:
     bool initInput(const QString& deviceName, uint32_t channels);
 
     void doAudio();
+    void wakeAudioLoop();
 
     virtual void doInput();
     virtual void doOutput();
@@ -114,7 +130,6 @@ private:
     virtual bool initInput(const QString& deviceName);
     virtual bool initOutput(const QString& outDevDescr);
     void playMono16SoundCleanup();
-    float getVolume();
 
 protected:
     QThread* audioThread;
@@ -130,7 +145,7 @@ protected:
     ALuint alMainBuffer = 0;
     bool outputInitialized = false;
 
-    QList<ALuint> peerSources;
+    QHash<ALuint, OutputSource> peerSources;
     int channels = 0;
     qreal gain = 0;
     qreal gainFactor = 1;
@@ -143,6 +158,7 @@ protected:
     const qreal minInThreshold = 0.0;
     const qreal maxInThreshold = 0.4;
     int16_t* inputBuffer = nullptr;
+    qreal captureLatencyMs = 0;
 };
 
 #endif // OPENAL_H
@@ -79,7 +79,6 @@ OpenAL2::OpenAL2()
     : alProxyDev{nullptr}
     , alProxyContext{nullptr}
     , alProxySource{0}
-    , alProxyBuffer{0}
 {
 }
 
@@ -154,6 +153,7 @@ bool OpenAL2::initOutputEchoCancel()
     // source for proxy output
     alGenSources(1, &alProxySource);
     checkAlError();
+    initSourceBuffers(proxyBuffers, PROXY_BUFFER_COUNT);
 
     // configuration for the loopback device
     ALCint attrs[] = {ALC_FORMAT_CHANNELS_SOFT,
@@ -168,6 +168,7 @@ bool OpenAL2::initOutputEchoCancel()
     checkAlcError(alProxyDev);
     if (!alProxyDev) {
         qDebug() << "Couldn't create proxy device";
+        deleteSourceBuffers(alProxySource, proxyBuffers);
         alDeleteSources(1, &alProxySource); // cleanup source
         return false;
     }
@@ -175,6 +176,7 @@ bool OpenAL2::initOutputEchoCancel()
     if (!alcIsRenderFormatSupportedSOFT(alProxyDev, attrs[5], attrs[1], attrs[3])) {
         qDebug() << "Unsupported format for loopback";
         alcCloseDevice(alProxyDev);         // cleanup loopback dev
+        deleteSourceBuffers(alProxySource, proxyBuffers);
         alDeleteSources(1, &alProxySource); // cleanup source
         return false;
     }
@@ -184,6 +186,7 @@ bool OpenAL2::initOutputEchoCancel()
     if (!alProxyContext) {
         qDebug() << "Couldn't create proxy context";
         alcCloseDevice(alProxyDev);         // cleanup loopback dev
+        deleteSourceBuffers(alProxySource, proxyBuffers);
         alDeleteSources(1, &alProxySource); // cleanup source
         return false;
     }
@@ -192,6 +195,7 @@ bool OpenAL2::initOutputEchoCancel()
         qDebug() << "Cannot activate proxy context";
         alcDestroyContext(alProxyContext);
         alcCloseDevice(alProxyDev);         // cleanup loopback dev
+        deleteSourceBuffers(alProxySource, proxyBuffers);
         alDeleteSources(1, &alProxySource); // cleanup source
         return false;
     }
@@ -271,12 +275,9 @@ void OpenAL2::cleanupOutput()
 
     if (echoCancelSupported) {
         alcMakeContextCurrent(alOutContext);
-        alSourceStop(alProxySource);
-        ALint processed = 0;
-        ALuint bufids[PROXY_BUFFER_COUNT];
-        alGetSourcei(alProxySource, AL_BUFFERS_PROCESSED, &processed);
-        alSourceUnqueueBuffers(alProxySource, processed, bufids);
-        alDeleteBuffers(processed, bufids);
+        qDebug() << "Proxy source underruns:" << proxyBuffers.underruns;
+        deleteSourceBuffers(alProxySource, proxyBuffers);
+        proxyBuffers = OutputSource{};
         alcMakeContextCurrent(nullptr);
         alcDestroyContext(alOutContext);
         alOutContext = nullptr;
@@ -298,21 +299,15 @@ void OpenAL2::doOutput()
         filterer = nullptr;
     }
 
+    if (proxyBuffers.buffers.isEmpty()) {
+        // no proxy source without echo cancellation, nothing to feed
+        return;
+    }
+
     alcMakeContextCurrent(alOutContext);
-    ALuint bufids[PROXY_BUFFER_COUNT];
-    ALint processed = 0, queued = 0;
-    alGetSourcei(alProxySource, AL_BUFFERS_PROCESSED, &processed);
-    alGetSourcei(alProxySource, AL_BUFFERS_QUEUED, &queued);
-
-    if (processed > 0) {
-        // unqueue all processed buffers
-        alSourceUnqueueBuffers(alProxySource, processed, bufids);
-        // delete all but the first buffer, reuse first for new data
-        alDeleteBuffers(processed - 1, bufids + 1);
-    } else if (queued < static_cast<ALint>(PROXY_BUFFER_COUNT)) {
-        // create new buffer until the maximum is reached
-        alGenBuffers(1, bufids);
-    } else {
+    const ALuint bufid = takeFreeBuffer(alProxySource, proxyBuffers);
+    if (!bufid) {
+        // all buffers still queued, wait until the next one got played
         alcMakeContextCurrent(alProxyContext);
         return;
     }
@@ -333,9 +328,9 @@ void OpenAL2::doOutput()
         alcMakeContextCurrent(alOutContext);
     }
 
-    alBufferData(bufids[0], AL_FORMAT_MONO16, outBuf, AUDIO_FRAME_SAMPLE_COUNT_PER_CHANNEL * 2, AUDIO_SAMPLE_RATE);
+    alBufferData(bufid, AL_FORMAT_MONO16, outBuf, AUDIO_FRAME_SAMPLE_COUNT_PER_CHANNEL * 2, AUDIO_SAMPLE_RATE);
 
-    alSourceQueueBuffers(alProxySource, 1, bufids);
+    alSourceQueueBuffers(alProxySource, 1, &bufid);
 
     // initialize echo canceler if supported
     if (echoCancelSupported && !filterer) {
@@ -353,6 +348,7 @@ void OpenAL2::doOutput()
     alGetSourcei(alProxySource, AL_SOURCE_STATE, &state);
     if (state != AL_PLAYING) {
         qDebug() << "Proxy source underflow detected";
+        ++proxyBuffers.underruns;
         alSourcePlay(alProxySource);
     }
     alcMakeContextCurrent(alProxyContext);
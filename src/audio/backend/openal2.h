@@ -69,7 +69,7 @@ private:
     ALCdevice* alProxyDev;
     ALCcontext* alProxyContext;
     ALuint alProxySource;
-    ALuint alProxyBuffer;
+    OutputSource proxyBuffers;
     bool echoCancelSupported = false;
 
     Filter_Audio* filterer = nullptr;
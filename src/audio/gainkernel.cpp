@@ -0,0 +1,270 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "gainkernel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define GAINKERNEL_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define GAINKERNEL_NEON 1
+#include <arm_neon.h>
+#endif
+
+/**
+ * @class GainKernel
+ * @brief Applies the input gain to a captured audio frame and measures its level in one pass.
+ *
+ * Samples are amplified with saturation to the 16-bit range, the RMS and peak of the amplified
+ * frame are computed while the samples are in registers anyway. The best implementation for
+ * the running CPU (AVX2, SSE2, NEON or plain C++) is picked once on first use.
+ *
+ * @struct GainKernel::Level
+ * @brief Level of an amplified frame.
+ *
+ * @var GainKernel::Level::rms
+ * @brief Root mean square of the samples, normalized to 0-1.
+ *
+ * @var GainKernel::Level::peak
+ * @brief Largest absolute sample, normalized to 0-1.
+ *
+ * @struct GainKernel::Implementation
+ * @brief One of the kernels apply() can dispatch to.
+ *
+ * @var GainKernel::Implementation::function
+ * @brief Entry point of the kernel, with the same contract as apply().
+ *
+ * @var GainKernel::Implementation::name
+ * @brief Instruction set the kernel uses, for logging.
+ */
+
+namespace {
+const float sampleMin = std::numeric_limits<int16_t>::min();
+const float sampleMax = std::numeric_limits<int16_t>::max();
+
+/**
+ * @brief Scalar gain loop, used for the whole frame or for the tail the vector loops leave.
+ */
+void applyRange(int16_t* buffer, size_t begin, size_t end, float gainFactor, float& sumOfSquares,
+                float& peak)
+{
+    for (size_t i = begin; i < end; ++i) {
+        const float sample = std::min(std::max(buffer[i] * gainFactor, sampleMin), sampleMax);
+        sumOfSquares += sample * sample;
+        peak = std::max(peak, std::fabs(sample));
+        buffer[i] = static_cast<int16_t>(std::lrint(sample));
+    }
+}
+
+GainKernel::Level makeLevel(float sumOfSquares, float peak, size_t samples)
+{
+    if (!samples) {
+        return {0.0f, 0.0f};
+    }
+
+    return {std::sqrt(sumOfSquares / samples) / sampleMax, std::min(peak / sampleMax, 1.0f)};
+}
+
+#ifdef GAINKERNEL_X86
+__attribute__((target("sse2"))) GainKernel::Level applySse2(int16_t* buffer, size_t samples,
+                                                            float gainFactor)
+{
+    const __m128 gain = _mm_set1_ps(gainFactor);
+    const __m128 lo = _mm_set1_ps(sampleMin);
+    const __m128 hi = _mm_set1_ps(sampleMax);
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    __m128 sum = _mm_setzero_ps();
+    __m128 peak = _mm_setzero_ps();
+
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buffer + i));
+        // SSE2 has no sign extending move, duplicate into the high half and shift back down
+        const __m128i in0 = _mm_srai_epi32(_mm_unpacklo_epi16(in, in), 16);
+        const __m128i in1 = _mm_srai_epi32(_mm_unpackhi_epi16(in, in), 16);
+
+        __m128 a = _mm_mul_ps(_mm_cvtepi32_ps(in0), gain);
+        __m128 b = _mm_mul_ps(_mm_cvtepi32_ps(in1), gain);
+        a = _mm_min_ps(_mm_max_ps(a, lo), hi);
+        b = _mm_min_ps(_mm_max_ps(b, lo), hi);
+
+        sum = _mm_add_ps(sum, _mm_add_ps(_mm_mul_ps(a, a), _mm_mul_ps(b, b)));
+        peak = _mm_max_ps(peak, _mm_max_ps(_mm_and_ps(a, absMask), _mm_and_ps(b, absMask)));
+
+        const __m128i out = _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(buffer + i), out);
+    }
+
+    float sums[4];
+    float peaks[4];
+    _mm_storeu_ps(sums, sum);
+    _mm_storeu_ps(peaks, peak);
+    float sumOfSquares = sums[0] + sums[1] + sums[2] + sums[3];
+    float maxPeak = std::max(std::max(peaks[0], peaks[1]), std::max(peaks[2], peaks[3]));
+
+    applyRange(buffer, i, samples, gainFactor, sumOfSquares, maxPeak);
+    return makeLevel(sumOfSquares, maxPeak, samples);
+}
+
+__attribute__((target("avx2"))) GainKernel::Level applyAvx2(int16_t* buffer, size_t samples,
+                                                            float gainFactor)
+{
+    const __m256 gain = _mm256_set1_ps(gainFactor);
+    const __m256 lo = _mm256_set1_ps(sampleMin);
+    const __m256 hi = _mm256_set1_ps(sampleMax);
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    __m256 sum = _mm256_setzero_ps();
+    __m256 peak = _mm256_setzero_ps();
+
+    size_t i = 0;
+    for (; i + 16 <= samples; i += 16) {
+        const __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(buffer + i));
+        const __m256i in0 = _mm256_cvtepi16_epi32(_mm256_castsi256_si128(in));
+        const __m256i in1 = _mm256_cvtepi16_epi32(_mm256_extracti128_si256(in, 1));
+
+        __m256 a = _mm256_mul_ps(_mm256_cvtepi32_ps(in0), gain);
+        __m256 b = _mm256_mul_ps(_mm256_cvtepi32_ps(in1), gain);
+        a = _mm256_min_ps(_mm256_max_ps(a, lo), hi);
+        b = _mm256_min_ps(_mm256_max_ps(b, lo), hi);
+
+        sum = _mm256_add_ps(sum, _mm256_add_ps(_mm256_mul_ps(a, a), _mm256_mul_ps(b, b)));
+        peak = _mm256_max_ps(peak,
+                             _mm256_max_ps(_mm256_and_ps(a, absMask), _mm256_and_ps(b, absMask)));
+
+        // packing works per 128 bit lane, put the 64 bit quarters back in order afterwards
+        const __m256i packed = _mm256_packs_epi32(_mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b));
+        const __m256i out = _mm256_permute4x64_epi64(packed, 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(buffer + i), out);
+    }
+
+    float sums[8];
+    float peaks[8];
+    _mm256_storeu_ps(sums, sum);
+    _mm256_storeu_ps(peaks, peak);
+    float sumOfSquares = 0;
+    float maxPeak = 0;
+    for (int lane = 0; lane < 8; ++lane) {
+        sumOfSquares += sums[lane];
+        maxPeak = std::max(maxPeak, peaks[lane]);
+    }
+
+    applyRange(buffer, i, samples, gainFactor, sumOfSquares, maxPeak);
+    return makeLevel(sumOfSquares, maxPeak, samples);
+}
+#endif
+
+#ifdef GAINKERNEL_NEON
+GainKernel::Level applyNeon(int16_t* buffer, size_t samples, float gainFactor)
+{
+    const float32x4_t gain = vdupq_n_f32(gainFactor);
+    const float32x4_t lo = vdupq_n_f32(sampleMin);
+    const float32x4_t hi = vdupq_n_f32(sampleMax);
+    float32x4_t sum = vdupq_n_f32(0.0f);
+    float32x4_t peak = vdupq_n_f32(0.0f);
+
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        const int16x8_t in = vld1q_s16(buffer + i);
+
+        float32x4_t a = vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(in))), gain);
+        float32x4_t b = vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(in))), gain);
+        a = vminq_f32(vmaxq_f32(a, lo), hi);
+        b = vminq_f32(vmaxq_f32(b, lo), hi);
+
+        sum = vmlaq_f32(vmlaq_f32(sum, a, a), b, b);
+        peak = vmaxq_f32(peak, vmaxq_f32(vabsq_f32(a), vabsq_f32(b)));
+
+        const int16x8_t out =
+            vcombine_s16(vqmovn_s32(vcvtnq_s32_f32(a)), vqmovn_s32(vcvtnq_s32_f32(b)));
+        vst1q_s16(buffer + i, out);
+    }
+
+    float sumOfSquares = vaddvq_f32(sum);
+    float maxPeak = vmaxvq_f32(peak);
+
+    applyRange(buffer, i, samples, gainFactor, sumOfSquares, maxPeak);
+    return makeLevel(sumOfSquares, maxPeak, samples);
+}
+#endif
+} // namespace
+
+/**
+ * @brief Amplifies a frame in place and returns its level, using the fastest implementation.
+ * @param buffer Interleaved samples, overwritten with the amplified samples.
+ * @param samples Total number of samples in buffer.
+ * @param gainFactor Linear gain.
+ * @return Level of the amplified frame.
+ */
+GainKernel::Level GainKernel::apply(int16_t* buffer, size_t samples, float gainFactor)
+{
+    return implementation().function(buffer, samples, gainFactor);
+}
+
+/**
+ * @brief Portable reference implementation of apply().
+ */
+GainKernel::Level GainKernel::applyScalar(int16_t* buffer, size_t samples, float gainFactor)
+{
+    float sumOfSquares = 0;
+    float peak = 0;
+    applyRange(buffer, 0, samples, gainFactor, sumOfSquares, peak);
+    return makeLevel(sumOfSquares, peak, samples);
+}
+
+/**
+ * @brief Name of the implementation apply() uses on this CPU, for logging and benchmarks.
+ */
+const char* GainKernel::implementationName()
+{
+    return implementation().name;
+}
+
+/**
+ * @brief Lists the implementations the running CPU can execute, fastest first.
+ *
+ * apply() uses the first entry, tests and benchmarks can call every entry directly to cover the
+ * kernels the dispatcher doesn't pick on this machine. The scalar kernel is always last.
+ */
+std::vector<GainKernel::Implementation> GainKernel::supportedImplementations()
+{
+    std::vector<Implementation> supported;
+#ifdef GAINKERNEL_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        supported.push_back({applyAvx2, "AVX2"});
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        supported.push_back({applySse2, "SSE2"});
+    }
+#elif defined(GAINKERNEL_NEON)
+    supported.push_back({applyNeon, "NEON"});
+#endif
+    supported.push_back({applyScalar, "scalar"});
+    return supported;
+}
+
+const GainKernel::Implementation& GainKernel::implementation()
+{
+    static const Implementation impl = supportedImplementations().front();
+    return impl;
+}
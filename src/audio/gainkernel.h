@@ -0,0 +1,55 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GAINKERNEL_H
+#define GAINKERNEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class GainKernel
+{
+public:
+    struct Level
+    {
+        float rms;
+        float peak;
+    };
+
+    typedef Level (*KernelFunction)(int16_t*, size_t, float);
+
+    struct Implementation
+    {
+        KernelFunction function;
+        const char* name;
+    };
+
+    GainKernel() = delete;
+
+    static Level apply(int16_t* buffer, size_t samples, float gainFactor);
+    static Level applyScalar(int16_t* buffer, size_t samples, float gainFactor);
+    static const char* implementationName();
+    static std::vector<Implementation> supportedImplementations();
+
+private:
+    static const Implementation& implementation();
+};
+
+#endif // GAINKERNEL_H
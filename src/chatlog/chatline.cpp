@@ -124,6 +124,19 @@ int ChatLine::getColumnCount()
     return content.size();
 }
 
+/**
+ * @brief Estimates the memory held by the line, see ChatLineContent::getMemoryUsage().
+ */
+qint64 ChatLine::getMemoryUsage() const
+{
+    qint64 bytes = sizeof(ChatLine);
+    for (ChatLineContent* c : content) {
+        bytes += c->getMemoryUsage();
+    }
+
+    return bytes;
+}
+
 void ChatLine::updateBBox()
 {
     bbox.setHeight(0);
@@ -90,6 +90,7 @@ public:
     ChatLineContent* getContent(QPointF scenePos) const;
 
     bool isOverSelection(QPointF scenePos);
+    qint64 getMemoryUsage() const;
 
     // comparators
     static bool lessThanBSRectTop(const ChatLine::Ptr& lhs, const qreal& rhs);
@@ -92,3 +92,13 @@ QString ChatLineContent::getText() const
 {
     return QString();
 }
+
+/**
+ * @brief Estimates the memory held by the content itself, for MemoryUsage.
+ *
+ * Pixmaps are shared with the PixmapCache, so only content owning data of its own overrides this.
+ */
+qint64 ChatLineContent::getMemoryUsage() const
+{
+    return 0;
+}
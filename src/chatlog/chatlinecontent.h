@@ -52,6 +52,7 @@ public:
     virtual void fontChanged(const QFont& font);
 
     virtual QString getText() const;
+    virtual qint64 getMemoryUsage() const;
 
     virtual qreal getAscent() const;
 
@@ -22,6 +22,7 @@
 #include "chatlinecontentproxy.h"
 #include "chatmessage.h"
 #include "content/filetransferwidget.h"
+#include "src/core/memoryusage.h"
 #include "src/widget/translator.h"
 
 #include <QAction>
@@ -119,10 +120,20 @@ ChatLog::ChatLog(QWidget* parent)
 
     retranslateUi();
     Translator::registerHandler(std::bind(&ChatLog::retranslateUi, this), this);
+
+    memoryUsageId = MemoryUsage::addSource([this]() {
+        qint64 bytes = 0;
+        for (const ChatLine::Ptr& l : lines) {
+            bytes += l->getMemoryUsage();
+        }
+
+        return MemoryUsage::Entry{"chatlog", objectName(), lines.size(), bytes};
+    });
 }
 
 ChatLog::~ChatLog()
 {
+    MemoryUsage::removeSource(memoryUsageId);
     Translator::unregister(this);
 
     // Remove chatlines from scene
@@ -165,6 +165,8 @@ private:
     // layout
     QMargins margins = QMargins(10, 10, 10, 10);
     qreal lineSpacing = 5.0f;
+
+    int memoryUsageId;
 };
 
 #endif // CHATLOG_H
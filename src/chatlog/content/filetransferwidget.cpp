@@ -30,6 +30,7 @@
 #include <libexif/exif-loader.h>
 
 #include <QBuffer>
+#include <QCoreApplication>
 #include <QDebug>
 #include <QDesktopServices>
 #include <QDesktopWidget>
@@ -47,6 +48,9 @@
 // The rightButton is used to cancel a file transfer, or to open the directory a file was
 // downloaded to.
 
+QMultiHash<uint64_t, FileTransferWidget*> FileTransferWidget::progressReceivers;
+QMetaObject::Connection FileTransferWidget::progressConnection;
+
 FileTransferWidget::FileTransferWidget(QWidget* parent, ToxFile file)
     : QWidget(parent)
     , ui(new Ui::FileTransferWidget)
@@ -87,8 +91,7 @@ FileTransferWidget::FileTransferWidget(QWidget* parent, ToxFile file)
 
     setBackgroundColor(Style::getColor(Style::LightGrey), false);
 
-    connect(Core::getInstance(), &Core::fileTransferInfo, this,
-            &FileTransferWidget::onFileTransferInfo);
+    subscribeProgress();
     connect(Core::getInstance(), &Core::fileTransferAccepted, this,
             &FileTransferWidget::onFileTransferAccepted);
     connect(Core::getInstance(), &Core::fileTransferCancelled, this,
@@ -121,9 +124,70 @@ FileTransferWidget::FileTransferWidget(QWidget* parent, ToxFile file)
 
 FileTransferWidget::~FileTransferWidget()
 {
+    unsubscribeProgress();
     delete ui;
 }
 
+uint64_t FileTransferWidget::progressKey(uint32_t friendId, uint32_t fileNum)
+{
+    return (static_cast<uint64_t>(friendId) << 32) + fileNum;
+}
+
+/**
+ * @brief Hands every snapshot of a Core::fileTransferProgress batch to the widget of its transfer.
+ *
+ * All widgets share a single connection, so a batch is delivered once instead of to every
+ * transfer ever shown in any chat.
+ */
+void FileTransferWidget::dispatchProgress(const QVector<ToxFileProgress>& progress)
+{
+    for (const ToxFileProgress& snapshot : progress) {
+        const uint64_t key = progressKey(snapshot.friendId, snapshot.fileNum);
+        for (FileTransferWidget* widget : progressReceivers.values(key)) {
+            if (widget->fileInfo.direction == snapshot.direction) {
+                widget->onFileTransferProgress(snapshot);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Registers the widget for the progress of its transfer.
+ */
+void FileTransferWidget::subscribeProgress()
+{
+    if (!progressConnection) {
+        progressConnection = connect(Core::getInstance(), &Core::fileTransferProgress,
+                                     QCoreApplication::instance(),
+                                     &FileTransferWidget::dispatchProgress);
+    }
+
+    progressReceivers.insert(progressKey(fileInfo.friendId, fileInfo.fileNum), this);
+
+    // a transfer resumed from an earlier session or already running doesn't start at 0, start
+    // from its current progress so the first speed sample isn't off
+    ToxFileProgress progress;
+    if (Core::getInstance()->getFileTransferProgress(fileInfo.friendId, fileInfo.fileNum, progress)
+        && progress.direction == fileInfo.direction && progress.filesize > 0) {
+        fileInfo.bytesSent = progress.bytesSent;
+        lastBytesSent = progress.bytesSent;
+        ui->progressBar->setValue(
+            static_cast<int>(static_cast<qreal>(progress.bytesSent) / progress.filesize * 100.0));
+    }
+}
+
+/**
+ * @brief Stops progress updates for this widget, the last widget also drops the connection.
+ */
+void FileTransferWidget::unsubscribeProgress()
+{
+    progressReceivers.remove(progressKey(fileInfo.friendId, fileInfo.fileNum), this);
+    if (progressReceivers.isEmpty() && progressConnection) {
+        disconnect(progressConnection);
+        progressConnection = QMetaObject::Connection();
+    }
+}
+
 void FileTransferWidget::autoAcceptTransfer(const QString& path)
 {
     QString filepath;
@@ -252,27 +316,29 @@ void FileTransferWidget::paintEvent(QPaintEvent*)
     }
 }
 
-void FileTransferWidget::onFileTransferInfo(ToxFile file)
+void FileTransferWidget::onFileTransferProgress(const ToxFileProgress& progress)
 {
     QTime now = QTime::currentTime();
     qint64 dt = lastTick.msecsTo(now); // ms
 
-    if (fileInfo != file || dt < 1000)
+    if (dt <= 0)
         return;
 
-    fileInfo = file;
+    fileInfo.bytesSent = progress.bytesSent;
 
     if (fileInfo.status == ToxFile::TRANSMITTING) {
         // update progress
-        qreal progress = static_cast<qreal>(file.bytesSent) / static_cast<qreal>(file.filesize);
-        ui->progressBar->setValue(static_cast<int>(progress * 100.0));
+        qreal progressRatio =
+            static_cast<qreal>(progress.bytesSent) / static_cast<qreal>(progress.filesize);
+        ui->progressBar->setValue(static_cast<int>(progressRatio * 100.0));
 
         // ETA, speed
         qreal deltaSecs = dt / 1000.0;
 
         // (can't use ::abs or ::max on unsigned types substraction, they'd just overflow)
-        quint64 deltaBytes = file.bytesSent > lastBytesSent ? file.bytesSent - lastBytesSent
-                                                            : lastBytesSent - file.bytesSent;
+        quint64 deltaBytes = progress.bytesSent > lastBytesSent
+                                 ? progress.bytesSent - lastBytesSent
+                                 : lastBytesSent - progress.bytesSent;
         qreal bytesPerSec = static_cast<int>(static_cast<qreal>(deltaBytes) / deltaSecs);
 
         // calculate mean
@@ -288,7 +354,8 @@ void FileTransferWidget::onFileTransferInfo(ToxFile file)
         // update UI
         if (meanBytesPerSec > 0) {
             // ETA
-            QTime toGo = QTime(0, 0).addSecs((file.filesize - file.bytesSent) / meanBytesPerSec);
+            QTime toGo =
+                QTime(0, 0).addSecs((progress.filesize - progress.bytesSent) / meanBytesPerSec);
             QString format = toGo.hour() > 0 ? "hh:mm:ss" : "mm:ss";
             ui->etaLabel->setText(toGo.toString(format));
         } else {
@@ -297,7 +364,7 @@ void FileTransferWidget::onFileTransferInfo(ToxFile file)
 
         ui->progressLabel->setText(getHumanReadableSize(meanBytesPerSec) + "/s");
 
-        lastBytesSent = file.bytesSent;
+        lastBytesSent = progress.bytesSent;
     }
 
     lastTick = now;
@@ -331,6 +398,7 @@ void FileTransferWidget::onFileTransferCancelled(ToxFile file)
     setupButtons();
     hideWidgets();
 
+    unsubscribeProgress();
     disconnect(Core::getInstance(), nullptr, this, nullptr);
 }
 
@@ -401,6 +469,12 @@ void FileTransferWidget::onFileTransferFinished(ToxFile file)
     if (fileInfo.direction == ToxFile::RECEIVING)
         showPreview(fileInfo.filePath);
 
+    if (!fileInfo.hash.isEmpty()) {
+        ui->fileSizeLabel->setToolTip(
+            tr("BLAKE2b checksum: %1", "file transfer widget").arg(QString(fileInfo.hash.toHex())));
+    }
+
+    unsubscribeProgress();
     disconnect(Core::getInstance(), nullptr, this, nullptr);
 }
 
@@ -20,6 +20,7 @@
 #ifndef FILETRANSFERWIDGET_H
 #define FILETRANSFERWIDGET_H
 
+#include <QMultiHash>
 #include <QTime>
 #include <QWidget>
 
@@ -45,7 +46,6 @@ public:
     bool isActive() const;
 
 protected slots:
-    void onFileTransferInfo(ToxFile file);
     void onFileTransferAccepted(ToxFile file);
     void onFileTransferCancelled(ToxFile file);
     void onFileTransferPaused(ToxFile file);
@@ -55,6 +55,7 @@ protected slots:
     void fileTransferBrokenUnbroken(ToxFile file, bool broken);
 
 protected:
+    void onFileTransferProgress(const ToxFileProgress& progress);
     QString getHumanReadableSize(qint64 size);
     void hideWidgets();
     void setupButtons();
@@ -74,6 +75,11 @@ private slots:
     void onPreviewButtonClicked();
 
 private:
+    static uint64_t progressKey(uint32_t friendId, uint32_t fileNum);
+    static void dispatchProgress(const QVector<ToxFileProgress>& progress);
+    void subscribeProgress();
+    void unsubscribeProgress();
+
     static QPixmap scaleCropIntoSquare(const QPixmap& source, int targetSize);
     static int getExifOrientation(const char* data, const int size);
     static void applyTransformation(const int oritentation, QImage& image);
@@ -94,6 +100,10 @@ private:
     qreal meanData[TRANSFER_ROLLING_AVG_COUNT] = {0.0};
 
     bool active;
+
+    static QMultiHash<uint64_t, FileTransferWidget*> progressReceivers;
+    static QMetaObject::Connection progressConnection;
+
     enum class ExifOrientation {
         /* do not change values, this is exif spec
          *
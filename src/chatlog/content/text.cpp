@@ -292,6 +292,14 @@ QString Text::getText() const
     return rawText;
 }
 
+qint64 Text::getMemoryUsage() const
+{
+    // the document only exists while the text is visible, its layout isn't counted
+    const int chars = text.size() + rawText.size() + selectedText.size()
+                      + (doc ? doc->characterCount() : 0);
+    return chars * static_cast<qint64>(sizeof(QChar));
+}
+
 /**
  * @brief Extracts the target of a link from the text at a given coordinate
  * @param scenePos Position in scene coordinates
@@ -63,6 +63,7 @@ public:
     void hoverMoveEvent(QGraphicsSceneHoverEvent* event) final override;
 
     virtual QString getText() const final;
+    virtual qint64 getMemoryUsage() const final;
     QString getLinkAt(QPointF scenePos) const;
 
 protected:
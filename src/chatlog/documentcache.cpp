@@ -19,9 +19,23 @@
 
 #include "documentcache.h"
 #include "customtextdocument.h"
+#include "src/core/memoryusage.h"
+
+DocumentCache::DocumentCache()
+{
+    memoryUsageId = MemoryUsage::addSource([this]() {
+        qint64 bytes = 0;
+        for (const QTextDocument* doc : documents) {
+            bytes += doc->characterCount() * static_cast<qint64>(sizeof(QChar));
+        }
+
+        return MemoryUsage::Entry{"documentcache", "documents", documents.size(), bytes};
+    });
+}
 
 DocumentCache::~DocumentCache()
 {
+    MemoryUsage::removeSource(memoryUsageId);
     while (!documents.isEmpty())
         delete documents.pop();
 }
@@ -33,13 +33,14 @@ public:
     void push(QTextDocument* doc);
 
 private:
-    DocumentCache() = default;
+    DocumentCache();
     ~DocumentCache();
     DocumentCache(DocumentCache&) = delete;
     DocumentCache& operator=(const DocumentCache&) = delete;
 
 private:
     QStack<QTextDocument*> documents;
+    int memoryUsageId;
 };
 
 #endif // DOCUMENTCACHE_H
@@ -18,6 +18,24 @@
 */
 
 #include "pixmapcache.h"
+#include "src/core/memoryusage.h"
+
+PixmapCache::PixmapCache()
+{
+    memoryUsageId = MemoryUsage::addSource([this]() {
+        qint64 bytes = 0;
+        for (auto it = cache.constBegin(); it != cache.constEnd(); ++it) {
+            bytes += MemoryUsage::estimateIcon(it.value(), it.key());
+        }
+
+        return MemoryUsage::Entry{"pixmapcache", "icons", cache.size(), bytes};
+    });
+}
+
+PixmapCache::~PixmapCache()
+{
+    MemoryUsage::removeSource(memoryUsageId);
+}
 
 QPixmap PixmapCache::get(const QString& filename, QSize size)
 {
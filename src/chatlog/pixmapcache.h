@@ -31,14 +31,14 @@ public:
     static PixmapCache& getInstance();
 
 protected:
-    PixmapCache()
-    {
-    }
+    PixmapCache();
+    ~PixmapCache();
     PixmapCache(PixmapCache&) = delete;
     PixmapCache& operator=(const PixmapCache&) = delete;
 
 private:
     QHash<QString, QIcon> cache;
+    int memoryUsageId;
 };
 
 #endif // ICONCACHE_H
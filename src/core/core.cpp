@@ -25,6 +25,7 @@
 #include "src/core/toxlogger.h"
 #include "src/core/toxoptions.h"
 #include "src/core/toxstring.h"
+#include "src/core/tracer.h"
 #include "src/model/groupinvite.h"
 #include "src/nexus.h"
 #include "src/persistence/profile.h"
@@ -65,6 +66,8 @@ Core::~Core()
 
     coreThread->exit(0);
 
+    CoreFile::setTransferStore(nullptr);
+
     // need to reset av first, because it uses tox
     av.reset();
     tox.reset();
@@ -240,6 +243,7 @@ ToxCorePtr Core::makeToxCore(const QByteArray& savedata, const ICoreSettings* co
 void Core::onStarted()
 {
     ASSERT_CORE_THREAD;
+    Tracer::Span span{"Core::onStarted"};
 
     // One time initialization stuff
     QString name = getUsername();
@@ -300,6 +304,44 @@ CoreAV* Core::getAv()
  */
 #define CORE_DISCONNECT_TOLERANCE 30
 
+/**
+ * @struct FriendEvents
+ * @brief Friend events collected during one iteration of the core loop.
+ *
+ * Status changes and read receipts are kept in the order they happened. For names, status
+ * messages and typing notifications, only the last value per friend matters.
+ */
+
+/**
+ * @brief Checks if no events were collected.
+ */
+bool FriendEvents::isEmpty() const
+{
+    return statuses.isEmpty() && usernames.isEmpty() && statusMessages.isEmpty()
+           && typing.isEmpty() && receipts.isEmpty();
+}
+
+/**
+ * @struct FriendInfo
+ * @brief A friend from the tox save, as loaded on startup.
+ */
+
+/**
+ * @brief Hands the friend events collected during the last iteration to the GUI in one signal.
+ *
+ * A single tox_iterate can report thousands of events after a reconnect, batching them saves
+ * queueing a signal for each of them.
+ */
+void Core::dispatchFriendEvents()
+{
+    if (friendEvents.isEmpty()) {
+        return;
+    }
+
+    emit friendEventsReceived(friendEvents);
+    friendEvents = FriendEvents{};
+}
+
 /**
  * @brief Processes toxcore events and ensure we stay connected, called by its own timer
  */
@@ -315,6 +357,10 @@ void Core::process()
 
     static int tolerance = CORE_DISCONNECT_TOLERANCE;
     tox_iterate(tox.get(), this);
+    CoreFile::flushPendingChunks(this);
+    CoreFile::updateWriteBehind(this);
+    CoreFile::publishProgress(this);
+    dispatchFriendEvents();
 
 #ifdef DEBUG
     // we want to see the debug messages immediately
@@ -405,25 +451,27 @@ void Core::onFriendMessage(Tox*, uint32_t friendId, TOX_MESSAGE_TYPE type, const
 {
     bool isAction = (type == TOX_MESSAGE_TYPE_ACTION);
     QString msg = ToxString(cMessage, cMessageSize).getQString();
+    // the GUI has to see name and status changes that came before the message first
+    static_cast<Core*>(core)->dispatchFriendEvents();
     emit static_cast<Core*>(core)->friendMessageReceived(friendId, msg, isAction);
 }
 
 void Core::onFriendNameChange(Tox*, uint32_t friendId, const uint8_t* cName, size_t cNameSize, void* core)
 {
     QString newName = ToxString(cName, cNameSize).getQString();
-    emit static_cast<Core*>(core)->friendUsernameChanged(friendId, newName);
+    static_cast<Core*>(core)->friendEvents.usernames.insert(friendId, newName);
 }
 
 void Core::onFriendTypingChange(Tox*, uint32_t friendId, bool isTyping, void* core)
 {
-    emit static_cast<Core*>(core)->friendTypingChanged(friendId, isTyping);
+    static_cast<Core*>(core)->friendEvents.typing.insert(friendId, isTyping);
 }
 
 void Core::onStatusMessageChanged(Tox*, uint32_t friendId, const uint8_t* cMessage,
                                   size_t cMessageSize, void* core)
 {
     QString message = ToxString(cMessage, cMessageSize).getQString();
-    emit static_cast<Core*>(core)->friendStatusMessageChanged(friendId, message);
+    static_cast<Core*>(core)->friendEvents.statusMessages.insert(friendId, message);
 }
 
 void Core::onUserStatusChanged(Tox*, uint32_t friendId, TOX_USER_STATUS userstatus, void* core)
@@ -443,7 +491,7 @@ void Core::onUserStatusChanged(Tox*, uint32_t friendId, TOX_USER_STATUS userstat
         break;
     }
 
-    emit static_cast<Core*>(core)->friendStatusChanged(friendId, status);
+    static_cast<Core*>(core)->friendEvents.statuses.append({friendId, status});
 }
 
 void Core::onConnectionStatusChanged(Tox*, uint32_t friendId, TOX_CONNECTION status, void* core)
@@ -452,9 +500,14 @@ void Core::onConnectionStatusChanged(Tox*, uint32_t friendId, TOX_CONNECTION sta
     // Ignore Online because it will be emited from onUserStatusChanged
     bool isOffline = friendStatus == Status::Offline;
     if (isOffline) {
-        emit static_cast<Core*>(core)->friendStatusChanged(friendId, friendStatus);
+        FriendEvents& events = static_cast<Core*>(core)->friendEvents;
+        events.statuses.append({friendId, friendStatus});
+        // the GUI stops showing the typing notification of offline friends by itself
+        events.typing.remove(friendId);
         static_cast<Core*>(core)->checkLastOnline(friendId);
         CoreFile::onConnectionStatusChanged(static_cast<Core*>(core), friendId, !isOffline);
+    } else {
+        CoreFile::resumeFileSends(static_cast<Core*>(core), friendId);
     }
 }
 
@@ -546,7 +599,7 @@ void Core::onGroupTitleChange(Tox*, uint32_t groupId, uint32_t peerId, const uin
 
 void Core::onReadReceiptCallback(Tox*, uint32_t friendId, uint32_t receipt, void* core)
 {
-    emit static_cast<Core*>(core)->receiptRecieved(friendId, receipt);
+    static_cast<Core*>(core)->friendEvents.receipts.append({friendId, static_cast<int>(receipt)});
 }
 
 void Core::acceptFriendRequest(const ToxPk& friendPk)
@@ -746,6 +799,47 @@ void Core::sendFile(uint32_t friendId, QString filename, QString filePath, long
     CoreFile::sendFile(this, friendId, filename, filePath, filesize);
 }
 
+/**
+ * @brief Sets where unfinished file transfers are remembered, so they can be resumed.
+ * @param store Store of the profile, or nullptr if the profile has no database.
+ */
+void Core::setTransferStore(std::shared_ptr<TransferStore> store)
+{
+    QMutexLocker ml{coreLoopLock.get()};
+
+    CoreFile::setTransferStore(store);
+    if (!store) {
+        return;
+    }
+
+    // friends that came online while the database was still opening weren't offered anything
+    for (uint32_t friendId : getFriendList()) {
+        if (isFriendOnline(friendId)) {
+            CoreFile::resumeFileSends(this, friendId);
+        }
+    }
+}
+
+/**
+ * @brief Returns the progress of a file transfer as last reported, can be called from any thread.
+ * @return False if there's no such transfer.
+ */
+bool Core::getFileTransferProgress(uint32_t friendId, uint32_t fileNum,
+                                   ToxFileProgress& progress) const
+{
+    // no loop lock, the registry is safe to query while the core is iterating
+    return CoreFile::registry.progress(friendId, fileNum, progress);
+}
+
+/**
+ * @brief Checks if files are being sent to or received from a friend, can be called from any
+ * thread.
+ */
+bool Core::hasFileTransfers(uint32_t friendId) const
+{
+    return !CoreFile::registry.filesOf(friendId).isEmpty();
+}
+
 void Core::sendAvatarFile(uint32_t friendId, const QByteArray& data)
 {
     QMutexLocker ml{coreLoopLock.get()};
@@ -803,11 +897,13 @@ void Core::removeFriend(uint32_t friendId, bool fake)
         return;
     }
 
+    const ToxPk friendPk = getFriendPublicKey(friendId);
     if (!tox_friend_delete(tox.get(), friendId, nullptr)) {
         emit failedToRemoveFriend(friendId);
         return;
     }
 
+    CoreFile::forgetTransfers(friendPk);
     emit saveRequest();
     emit friendRemoved(friendId);
 }
@@ -1018,15 +1114,18 @@ QByteArray Core::getToxSaveData()
     if ((!checkSize || property##Size) && property##Size != SIZE_MAX) {        \
         uint8_t* prop = new uint8_t[property##Size];                           \
         if (function(tox.get(), ids[i], prop, nullptr)) {                      \
-            QString propStr = ToxString(prop, property##Size).getQString();    \
-            emit friend##property##Changed(ids[i], propStr);                   \
+            info.property = ToxString(prop, property##Size).getQString();      \
         }                                                                      \
                                                                                \
         delete[] prop;                                                         \
     }
 
+/**
+ * @brief Hands all friends of the tox save to the GUI in a single friendsLoaded signal.
+ */
 void Core::loadFriends()
 {
+    Tracer::Span span{"Core::loadFriends"};
     QMutexLocker ml{coreLoopLock.get()};
 
     const uint32_t friendCount = tox_self_get_friend_list_size(tox.get());
@@ -1038,17 +1137,21 @@ void Core::loadFriends()
     uint32_t* ids = new uint32_t[friendCount];
     tox_self_get_friend_list(tox.get(), ids);
     uint8_t friendPk[TOX_PUBLIC_KEY_SIZE] = {0x00};
+    QVector<FriendInfo> friends;
+    friends.reserve(friendCount);
     for (uint32_t i = 0; i < friendCount; ++i) {
         if (!tox_friend_get_public_key(tox.get(), ids[i], friendPk, nullptr)) {
             continue;
         }
 
-        emit friendAdded(ids[i], ToxPk(friendPk));
-        GET_FRIEND_PROPERTY(Username, tox_friend_get_name, true);
-        GET_FRIEND_PROPERTY(StatusMessage, tox_friend_get_status_message, false);
-        checkLastOnline(ids[i]);
+        FriendInfo info{ids[i], ToxPk(friendPk), QString(), QString()};
+        GET_FRIEND_PROPERTY(username, tox_friend_get_name, true);
+        GET_FRIEND_PROPERTY(statusMessage, tox_friend_get_status_message, false);
+        friends.append(info);
     }
     delete[] ids;
+
+    emit friendsLoaded(friends);
 }
 
 void Core::checkLastOnline(uint32_t friendId)
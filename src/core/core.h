@@ -27,10 +27,14 @@
 #include "src/core/dhtserver.h"
 #include <tox/tox.h>
 
+#include <QHash>
 #include <QMutex>
 #include <QObject>
+#include <QPair>
+#include <QString>
 #include <QThread>
 #include <QTimer>
+#include <QVector>
 
 #include <functional>
 #include <memory>
@@ -39,6 +43,7 @@ class CoreAV;
 class ICoreSettings;
 class GroupInvite;
 class Profile;
+class TransferStore;
 
 enum class Status
 {
@@ -48,6 +53,25 @@ enum class Status
     Offline
 };
 
+struct FriendEvents
+{
+    QVector<QPair<uint32_t, Status>> statuses;
+    QHash<uint32_t, QString> usernames;
+    QHash<uint32_t, QString> statusMessages;
+    QHash<uint32_t, bool> typing;
+    QVector<QPair<uint32_t, int>> receipts;
+
+    bool isEmpty() const;
+};
+
+struct FriendInfo
+{
+    uint32_t friendId;
+    ToxPk friendPk;
+    QString username;
+    QString statusMessage;
+};
+
 class Core;
 
 using ToxCorePtr = std::unique_ptr<Core>;
@@ -99,6 +123,10 @@ public:
     bool isReady() const;
 
     void sendFile(uint32_t friendId, QString filename, QString filePath, long long filesize);
+    void setTransferStore(std::shared_ptr<TransferStore> store);
+    bool getFileTransferProgress(uint32_t friendId, uint32_t fileNum,
+                                 ToxFileProgress& progress) const;
+    bool hasFileTransfers(uint32_t friendId) const;
 
 public slots:
     void start();
@@ -166,7 +194,7 @@ signals:
     void fileUploadFinished(const QString& path);
     void fileDownloadFinished(const QString& path);
     void fileTransferPaused(ToxFile file);
-    void fileTransferInfo(ToxFile file);
+    void fileTransferProgress(const QVector<ToxFileProgress>& progress);
     void fileTransferRemotePausedUnpaused(ToxFile file, bool paused);
     void fileTransferBrokenUnbroken(ToxFile file, bool broken);
     void fileNameChanged(const ToxPk& friendPk);
@@ -181,11 +209,9 @@ signals:
 
     void friendMessageReceived(uint32_t friendId, const QString& message, bool isAction);
     void friendAdded(uint32_t friendId, const ToxPk& friendPk);
+    void friendsLoaded(const QVector<FriendInfo>& friends);
 
-    void friendStatusChanged(uint32_t friendId, Status status);
-    void friendStatusMessageChanged(uint32_t friendId, const QString& message);
-    void friendUsernameChanged(uint32_t friendId, const QString& username);
-    void friendTypingChanged(uint32_t friendId, bool isTyping);
+    void friendEventsReceived(const FriendEvents& events);
 
     void friendAvatarChangedDeprecated(uint32_t friendId, const QPixmap& pic);
     void friendRemoved(uint32_t friendId);
@@ -204,8 +230,6 @@ signals:
     void groupSentFailed(int groupId);
     void actionSentResult(uint32_t friendId, const QString& action, int success);
 
-    void receiptRecieved(int friedId, int receipt);
-
     void failedToRemoveFriend(uint32_t friendId);
 
     void fileSendFailed(uint32_t friendId, const QString& fname);
@@ -254,6 +278,7 @@ private:
     void bootstrapDht();
 
     void checkLastOnline(uint32_t friendId);
+    void dispatchFriendEvents();
 
     QString getFriendRequestErrorMessage(const ToxId& friendId, const QString& message) const;
     static void registerCallbacks(Tox* tox);
@@ -283,6 +308,7 @@ private:
 
     std::unique_ptr<QThread> coreThread = nullptr;
     QList<DhtServer> bootstrapNodes{};
+    FriendEvents friendEvents;
 
     friend class Audio;    ///< Audio can access our calls directly to reduce latency
     friend class CoreFile; ///< CoreFile can access tox* and emit our signals
@@ -164,9 +164,51 @@ void CoreAV::killTimerFromThread()
 void CoreAV::process()
 {
     toxav_iterate(toxav);
+    flushOutboundFrames();
     iterateTimer->start(toxav_iteration_interval(toxav));
 }
 
+/**
+ * @brief Sends the frames the capture threads queued while toxav_iterate was holding the lock.
+ * @note Must be called from the CoreAV thread, which is the only consumer of the call queues.
+ */
+void CoreAV::flushOutboundFrames()
+{
+    for (auto& kv : calls) {
+        const uint32_t callId = kv.first;
+        ToxFriendCall& call = kv.second;
+
+        OutboundAudioQueue& audioQueue = call.getAudioQueue();
+        while (OutboundAudioFrame* audioFrame = audioQueue.front()) {
+            TOXAV_ERR_SEND_FRAME err;
+            if (!toxav_audio_send_frame(toxav, callId, audioFrame->pcm.data(), audioFrame->samples,
+                                        audioFrame->chans, audioFrame->rate, &err)) {
+                if (err == TOXAV_ERR_SEND_FRAME_SYNC) {
+                    // Still locked, keep the frame for after the next iteration
+                    break;
+                }
+                qDebug() << "toxav_audio_send_frame error: " << err;
+            }
+            audioQueue.pop();
+        }
+
+        OutboundVideoQueue& videoQueue = call.getVideoQueue();
+        while (OutboundVideoFrame* videoFrame = videoQueue.front()) {
+            ToxYUVFrame frame = videoFrame->frame->toToxYUVFrame();
+            TOXAV_ERR_SEND_FRAME err;
+            if (frame && !toxav_video_send_frame(toxav, callId, frame.width, frame.height, frame.y,
+                                                 frame.u, frame.v, &err)) {
+                if (err == TOXAV_ERR_SEND_FRAME_SYNC) {
+                    break;
+                }
+                qDebug() << "toxav_video_send_frame error: " << err;
+            }
+            videoFrame->frame.reset();
+            videoQueue.pop();
+        }
+    }
+}
+
 /**
  * @brief Check, if any calls are currently active.
  * @return true if any calls are currently active, false otherwise
@@ -359,30 +401,41 @@ bool CoreAV::sendCallAudio(uint32_t callId, const int16_t* pcm, size_t samples,
         return false;
     }
 
-    ToxFriendCall const& call = it->second;
+    ToxFriendCall& call = it->second;
 
     if (call.getMuteMic() || !call.isActive()
         || !(call.getState() & TOXAV_FRIEND_CALL_STATE_ACCEPTING_A)) {
         return true;
     }
 
-    // TOXAV_ERR_SEND_FRAME_SYNC means toxav failed to lock, retry 5 times in this case
-    TOXAV_ERR_SEND_FRAME err;
-    int retries = 0;
-    do {
-        if (!toxav_audio_send_frame(toxav, callId, pcm, samples, chans, rate, &err)) {
-            if (err == TOXAV_ERR_SEND_FRAME_SYNC) {
-                ++retries;
-                QThread::usleep(500);
-            } else {
-                qDebug() << "toxav_audio_send_frame error: " << err;
-            }
+    // Older frames waiting for the CoreAV thread have to go out first to keep the order
+    OutboundAudioQueue& queue = call.getAudioQueue();
+    if (queue.isEmpty()) {
+        TOXAV_ERR_SEND_FRAME err;
+        if (toxav_audio_send_frame(toxav, callId, pcm, samples, chans, rate, &err)) {
+            return true;
         }
-    } while (err == TOXAV_ERR_SEND_FRAME_SYNC && retries < 5);
-    if (err == TOXAV_ERR_SEND_FRAME_SYNC) {
-        qDebug() << "toxav_audio_send_frame error: Lock busy, dropping frame";
+
+        if (err != TOXAV_ERR_SEND_FRAME_SYNC) {
+            qDebug() << "toxav_audio_send_frame error: " << err;
+            return true;
+        }
+    }
+
+    // TOXAV_ERR_SEND_FRAME_SYNC means toxav_iterate holds the lock, don't wait for it here but
+    // let the CoreAV thread send the frame as soon as the iteration is done
+    OutboundAudioFrame* slot = queue.writeSlot();
+    if (!slot) {
+        qDebug() << "toxav_audio_send_frame error: Outbound queue full, dropping frame";
+        return true;
     }
 
+    slot->pcm.assign(pcm, pcm + samples * chans);
+    slot->samples = samples;
+    slot->chans = chans;
+    slot->rate = rate;
+    queue.push();
+
     return true;
 }
 
@@ -418,24 +471,31 @@ void CoreAV::sendCallVideo(uint32_t callId, std::shared_ptr<VideoFrame> vframe)
         return;
     }
 
-    // TOXAV_ERR_SEND_FRAME_SYNC means toxav failed to lock, retry 5 times in this case
-    // We don't want to be dropping iframes because of some lock held by toxav_iterate
-    TOXAV_ERR_SEND_FRAME err;
-    int retries = 0;
-    do {
-        if (!toxav_video_send_frame(toxav, callId, frame.width, frame.height, frame.y, frame.u,
-                                    frame.v, &err)) {
-            if (err == TOXAV_ERR_SEND_FRAME_SYNC) {
-                ++retries;
-                QThread::usleep(500);
-            } else {
-                qDebug() << "toxav_video_send_frame error: " << err;
-            }
+    // Older frames waiting for the CoreAV thread have to go out first to keep the order
+    OutboundVideoQueue& queue = call.getVideoQueue();
+    if (queue.isEmpty()) {
+        TOXAV_ERR_SEND_FRAME err;
+        if (toxav_video_send_frame(toxav, callId, frame.width, frame.height, frame.y, frame.u,
+                                   frame.v, &err)) {
+            return;
+        }
+
+        if (err != TOXAV_ERR_SEND_FRAME_SYNC) {
+            qDebug() << "toxav_video_send_frame error: " << err;
+            return;
         }
-    } while (err == TOXAV_ERR_SEND_FRAME_SYNC && retries < 5);
-    if (err == TOXAV_ERR_SEND_FRAME_SYNC) {
-        qDebug() << "toxav_video_send_frame error: Lock busy, dropping frame";
     }
+
+    // TOXAV_ERR_SEND_FRAME_SYNC means toxav_iterate holds the lock. We don't want to be dropping
+    // iframes because of that, so keep the frame alive and let the CoreAV thread send it
+    OutboundVideoFrame* slot = queue.writeSlot();
+    if (!slot) {
+        qDebug() << "toxav_video_send_frame error: Outbound queue full, dropping frame";
+        return;
+    }
+
+    slot->frame = vframe;
+    queue.push();
 }
 
 /**
@@ -505,12 +565,7 @@ void CoreAV::groupCallCallback(void* tox, uint32_t group, uint32_t peer, const i
         return;
     }
 
-    Audio& audio = Audio::getInstance();
-    if(!call.havePeer(peer)) {
-        call.addPeer(peer);
-    }
-
-    audio.playAudioBuffer(call.getAlSource(peer), data, samples, channels, sample_rate);
+    call.playPeerAudio(peer, data, samples, channels, sample_rate);
 }
 #else
 void CoreAV::groupCallCallback(void* tox, int group, int peer, const int16_t* data,
@@ -534,12 +589,7 @@ void CoreAV::groupCallCallback(void* tox, int group, int peer, const int16_t* da
         return;
     }
 
-    Audio& audio = Audio::getInstance();
-    if(!call.havePeer(peer)) {
-        call.addPeer(peer);
-    }
-
-    audio.playAudioBuffer(call.getAlSource(peer), data, samples, channels, sample_rate);
+    call.playPeerAudio(peer, data, samples, channels, sample_rate);
 }
 #endif
 
@@ -567,6 +617,25 @@ void CoreAV::invalidateGroupCallSources(int group)
     groupCalls.erase(group);
 }
 
+/**
+ * @brief Sets the volume of a single peer in a group call.
+ * @param groupId Group Index
+ * @param peer Peer Index
+ * @param gain Linear gain, 1 leaves the peer's audio unchanged, 0 mutes it.
+ * @note Call from the GUI thread.
+ */
+void CoreAV::setGroupCallPeerGain(int groupId, int peer, qreal gain)
+{
+    // the mixer isn't thread safe, peer audio is mixed by tox_iterate with the core loop locked
+    QMutexLocker ml{Core::getInstance()->coreLoopLock.get()};
+
+    auto it = groupCalls.find(groupId);
+    if (it == groupCalls.end()) {
+        return;
+    }
+    it->second.setPeerGain(peer, gain);
+}
+
 /**
  * @brief Get a call's video source.
  * @param friendNum Id of friend in call list.
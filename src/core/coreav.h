@@ -87,6 +87,7 @@ public:
 #endif
     static void invalidateGroupCallPeerSource(int group, int peer);
     static void invalidateGroupCallSources(int group);
+    static void setGroupCallPeerGain(int group, int peer, qreal gain);
 
 public slots:
     bool startCall(uint32_t friendNum, bool video);
@@ -112,6 +113,7 @@ private slots:
 
 private:
     void process();
+    void flushOutboundFrames();
     static void audioFrameCallback(ToxAV* toxAV, uint32_t friendNum, const int16_t* pcm,
                                    size_t sampleCount, uint8_t channels, uint32_t samplingRate,
                                    void* self);
@@ -20,13 +20,19 @@
 
 #include "corefile.h"
 #include "core.h"
+#include "filereadahead.h"
+#include "filewritebehind.h"
 #include "toxfile.h"
 #include "toxstring.h"
+#include "transferregistry.h"
+#include "transferscheduler.h"
 #include "src/persistence/profile.h"
 #include "src/persistence/settings.h"
+#include "src/persistence/transferstore.h"
 #include <QDebug>
 #include <QDir>
 #include <QFile>
+#include <QFileInfo>
 #include <QRegularExpression>
 #include <QThread>
 #include <memory>
@@ -38,10 +44,30 @@
  * Avoids polluting core.h with private internal callbacks.
  */
 
-QMutex CoreFile::fileSendMutex;
-QHash<uint64_t, ToxFile> CoreFile::fileMap;
+TransferRegistry CoreFile::registry;
+QHash<uint64_t, QQueue<CoreFile::ChunkRequest>> CoreFile::pendingChunks;
+QSet<uint64_t> CoreFile::throttledFiles;
+QSet<uint64_t> CoreFile::finishingFiles;
+QSet<uint64_t> CoreFile::activeFiles;
+TransferScheduler CoreFile::scheduler;
+QElapsedTimer CoreFile::progressTimer;
+std::shared_ptr<TransferStore> CoreFile::transferStore;
+QByteArray CoreFile::hashedAvatar;
+QByteArray CoreFile::avatarHash;
+constexpr qint64 CoreFile::PROGRESS_INTERVAL;
+constexpr quint64 CoreFile::PROGRESS_STORE_INTERVAL;
 using namespace std;
 
+/**
+ * @brief Returns the number of transfers and the file data buffered for them.
+ * @note Can be called from any thread.
+ */
+MemoryUsage::Entry CoreFile::getMemoryUsage()
+{
+    return {"filetransfer", "buffers", registry.files().size(),
+            FileReadAhead::totalBuffered() + FileWriteBehind::totalPending()};
+}
+
 /**
  * @brief Get corefile iteration interval.
  *
@@ -50,39 +76,271 @@ using namespace std;
  */
 unsigned CoreFile::corefileIterationInterval()
 {
-    /*
-       Sleep at most 1000ms if we have no FT, 10 for user FTs
-       There is no real difference between 10ms sleep and 50ms sleep when it
-       comes to CPU usage – just keep the CPU usage low when there are no file
-       transfers, and speed things up when there is an ongoing file transfer.
-    */
-    constexpr unsigned fileInterval = 10, idleInterval = 1000;
-
-    for (ToxFile& file : fileMap) {
-        if (file.status == ToxFile::TRANSMITTING) {
-            return fileInterval;
+    // transfers waiting for the disk are flushed every iteration, so don't back off for them
+    return scheduler.nextInterval(!activeFiles.isEmpty(), !pendingChunks.isEmpty());
+}
+
+/**
+ * @brief Changes the status of a registered file, keeping track of the running transfers.
+ */
+void CoreFile::setStatus(ToxFile* file, ToxFile::FileStatus status)
+{
+    file->status = status;
+    const uint64_t key = getFriendKey(file->friendId, file->fileNum);
+    if (status == ToxFile::TRANSMITTING) {
+        activeFiles.insert(key);
+    } else {
+        activeFiles.remove(key);
+    }
+}
+
+/**
+ * @brief Publishes the progress of all running transfers, at most every PROGRESS_INTERVAL ms.
+ *
+ * Chunk callbacks only count bytes, this collects the transfers that moved since the last
+ * snapshot and hands them to the GUI in a single Core::fileTransferProgress signal.
+ */
+void CoreFile::publishProgress(Core* core)
+{
+    if (progressTimer.isValid() && progressTimer.elapsed() < PROGRESS_INTERVAL) {
+        return;
+    }
+    progressTimer.start();
+
+    QVector<ToxFileProgress> progress;
+    for (const TransferRegistry::Handle& file : registry.files()) {
+        if (file->fileKind == TOX_FILE_KIND_AVATAR || file->status != ToxFile::TRANSMITTING
+            || file->bytesSent == file->bytesReported) {
+            continue;
+        }
+
+        file->bytesReported = file->bytesSent;
+        registry.publish(*file);
+        progress.append(
+            {file->friendId, file->fileNum, file->direction, file->bytesSent, file->filesize});
+    }
+
+    if (!progress.isEmpty()) {
+        emit core->fileTransferProgress(progress);
+    }
+
+    if (!transferStore) {
+        return;
+    }
+
+    // remember how far incoming transfers got: running ones every PROGRESS_STORE_INTERVAL bytes,
+    // paused and broken ones as soon as everything received is on disk
+    for (const TransferRegistry::Handle& file : registry.files()) {
+        if (file->direction != ToxFile::RECEIVING || !file->writeBehind) {
+            continue;
+        }
+
+        if (file->status == ToxFile::TRANSMITTING
+            && file->bytesSent < file->bytesStored + PROGRESS_STORE_INTERVAL) {
+            continue;
+        }
+
+        const FileWriteBehind::Checkpoint checkpoint = file->writeBehind->checkpoint();
+        if (checkpoint.offset != file->bytesStored) {
+            file->bytesStored = checkpoint.offset;
+            transferStore->updateProgress(file->resumeFileId, checkpoint.offset,
+                                          checkpoint.checksum);
         }
     }
-    return idleInterval;
 }
 
-void CoreFile::sendAvatarFile(Core* core, uint32_t friendId, const QByteArray& data)
+/**
+ * @brief Sets where unfinished transfers are remembered, so they can be resumed later.
+ * @param store Store of the current profile, or nullptr to not remember transfers.
+ */
+void CoreFile::setTransferStore(std::shared_ptr<TransferStore> store)
+{
+    transferStore = store;
+}
+
+/**
+ * @brief Forgets the unfinished transfers with a removed friend, they can't be resumed anymore.
+ */
+void CoreFile::forgetTransfers(const ToxPk& friendPk)
 {
-    QMutexLocker mlocker(&fileSendMutex);
+    if (transferStore) {
+        transferStore->removeTransfers(friendPk);
+    }
+}
+
+/**
+ * @brief Offers the unfinished outgoing transfers to a friend that came online again.
+ *
+ * The files are offered with their old file ID, so the friend can recognize them and continue
+ * where the transfer stopped.
+ */
+void CoreFile::resumeFileSends(Core* core, uint32_t friendId)
+{
+    if (!transferStore) {
+        return;
+    }
+
+    const ToxPk friendPk = core->getFriendPublicKey(friendId);
+    for (const TransferStore::Transfer& transfer :
+         transferStore->getTransfers(friendPk, ToxFile::SENDING)) {
+        bool running = false;
+        for (const TransferRegistry::Handle& file : registry.filesOf(friendId)) {
+            if (file->direction != ToxFile::SENDING || file->resumeFileId != transfer.fileId) {
+                continue;
+            }
+
+            if (file->status == ToxFile::BROKEN) {
+                removeFile(file->friendId, file->fileNum);
+            } else {
+                running = true;
+            }
+        }
+
+        if (running) {
+            continue;
+        }
+
+        if (QFileInfo(transfer.filePath).size() != static_cast<qint64>(transfer.filesize)) {
+            qDebug() << "resumeFileSends: File" << transfer.filePath << "changed, not resuming";
+            transferStore->removeTransfer(transfer.fileId);
+            continue;
+        }
+
+        QByteArray fileName = transfer.fileName;
+        uint32_t fileNum =
+            tox_file_send(core->tox.get(), friendId, TOX_FILE_KIND_DATA, transfer.filesize,
+                          reinterpret_cast<const uint8_t*>(transfer.fileId.constData()),
+                          (uint8_t*)fileName.data(), fileName.size(), nullptr);
+        if (fileNum == std::numeric_limits<uint32_t>::max()) {
+            qWarning() << "resumeFileSends: Can't create the Tox file sender";
+            continue;
+        }
+        qDebug() << QString("resumeFileSends: Offering file %1 to friend %2 again")
+                        .arg(fileNum)
+                        .arg(friendId);
+
+        ToxFile file{fileNum, friendId, fileName, transfer.filePath, ToxFile::SENDING};
+        file.filesize = transfer.filesize;
+        file.resumeFileId = transfer.fileId;
+        file.readAhead = std::make_shared<FileReadAhead>(transfer.filePath);
+        addFile(friendId, fileNum, file);
+
+        emit core->fileSendStarted(file);
+    }
+}
+
+/**
+ * @brief Continues an incoming transfer the sender offered again, if we know it.
+ *
+ * A transfer broken by a disconnect just continues to write to its file. After a restart, the
+ * partial file is only continued if the CHECKSUM_WINDOW bytes before the last checkpoint are
+ * unchanged, the data before them isn't verified.
+ * @return True if the transfer is continued and was accepted, false if it's a new transfer.
+ */
+bool CoreFile::resumeFileRecv(Core* core, ToxFile& file)
+{
+    const ToxPk friendPk = core->getFriendPublicKey(file.friendId);
+    quint64 offset = 0;
+    QByteArray tail;
+
+    for (const TransferRegistry::Handle& broken : registry.filesOf(file.friendId)) {
+        if (broken->direction != ToxFile::RECEIVING || broken->resumeFileId != file.resumeFileId
+            || broken->status != ToxFile::BROKEN || !broken->writeBehind
+            || broken->writeBehind->hasFailed()) {
+            continue;
+        }
+
+        // take over the open file, everything received so far will still be written
+        file.setFilePath(broken->filePath);
+        file.file = broken->file;
+        file.writeBehind = broken->writeBehind;
+        offset = broken->bytesSent;
+        file.bytesStored = broken->bytesStored;
+        broken->writeBehind.reset();
+        broken->file = std::make_shared<QFile>();
+        removeFile(broken->friendId, broken->fileNum);
+        break;
+    }
+
+    TransferStore::Transfer transfer;
+    if (!file.writeBehind) {
+        if (!transferStore || !transferStore->findTransfer(file.resumeFileId, transfer)
+            || transfer.friendPk != friendPk || transfer.direction != ToxFile::RECEIVING
+            || transfer.filesize != file.filesize || !transfer.bytesDone) {
+            return false;
+        }
+
+        file.setFilePath(transfer.filePath);
+        if (!file.open(true)) {
+            qWarning() << "resumeFileRecv: Can't open partial file" << transfer.filePath;
+            transferStore->removeTransfer(transfer.fileId);
+            return false;
+        }
+
+        tail = FileWriteBehind::readTail(*file.file, transfer.bytesDone);
+        if (FileWriteBehind::checksum(tail) != transfer.checksum
+            || !file.file->resize(transfer.bytesDone) || !file.file->seek(transfer.bytesDone)) {
+            qDebug() << "resumeFileRecv: Partial file" << transfer.filePath
+                     << "changed, starting over";
+            file.file->close();
+            transferStore->removeTransfer(transfer.fileId);
+            return false;
+        }
+
+        offset = transfer.bytesDone;
+        file.bytesStored = transfer.bytesDone;
+    }
+
+    TOX_ERR_FILE_SEEK error;
+    if (!tox_file_seek(core->tox.get(), file.friendId, file.fileNum, offset, &error)) {
+        qWarning() << "resumeFileRecv: Can't seek to" << offset << "error:" << error;
+        if (file.writeBehind) {
+            file.writeBehind->close();
+            file.writeBehind.reset();
+            file.file = std::make_shared<QFile>();
+        } else {
+            file.file->close();
+        }
+        return false;
+    }
+
+    if (!file.writeBehind) {
+        file.writeBehind = std::make_shared<FileWriteBehind>(file.file, offset, tail);
+    }
+
+    qDebug() << "resumeFileRecv: Continuing file" << file.friendId << ':' << file.fileNum
+             << "at byte" << offset;
+    file.bytesSent = offset;
+    file.status = ToxFile::TRANSMITTING;
+    addFile(file.friendId, file.fileNum, file);
+    emit core->fileReceiveRequested(file);
+    emit core->fileTransferAccepted(file);
+    tox_file_control(core->tox.get(), file.friendId, file.fileNum, TOX_FILE_CONTROL_RESUME,
+                     nullptr);
+    return true;
+}
 
+void CoreFile::sendAvatarFile(Core* core, uint32_t friendId, const QByteArray& data)
+{
     if (data.isEmpty()) {
         tox_file_send(core->tox.get(), friendId, TOX_FILE_KIND_AVATAR, 0, nullptr, nullptr, 0, nullptr);
         return;
     }
 
     static_assert(TOX_HASH_LENGTH <= TOX_FILE_ID_LENGTH, "TOX_HASH_LENGTH > TOX_FILE_ID_LENGTH!");
-    uint8_t avatarHash[TOX_HASH_LENGTH];
-    tox_hash(avatarHash, (uint8_t*)data.data(), data.size());
+    // the same avatar is usually sent to many friends in a row, only hash it once
+    if (data.constData() != hashedAvatar.constData() || data.size() != hashedAvatar.size()) {
+        hashedAvatar = data;
+        avatarHash.resize(TOX_HASH_LENGTH);
+        tox_hash(reinterpret_cast<uint8_t*>(avatarHash.data()),
+                 reinterpret_cast<const uint8_t*>(data.constData()), data.size());
+    }
     uint64_t filesize = data.size();
+    const uint8_t* hash = reinterpret_cast<const uint8_t*>(avatarHash.constData());
 
     TOX_ERR_FILE_SEND error;
     uint32_t fileNum = tox_file_send(core->tox.get(), friendId, TOX_FILE_KIND_AVATAR, filesize,
-                                     avatarHash, avatarHash, TOX_HASH_LENGTH, &error);
+                                     hash, hash, TOX_HASH_LENGTH, &error);
 
     switch (error) {
     case TOX_ERR_FILE_SEND_OK:
@@ -108,7 +366,7 @@ void CoreFile::sendAvatarFile(Core* core, uint32_t friendId, const QByteArray& d
 
     ToxFile file{fileNum, friendId, "", "", ToxFile::SENDING};
     file.filesize = filesize;
-    file.fileName = QByteArray((char*)avatarHash, TOX_HASH_LENGTH);
+    file.fileName = avatarHash;
     file.fileKind = TOX_FILE_KIND_AVATAR;
     file.avatarData = data;
     file.resumeFileId.resize(TOX_FILE_ID_LENGTH);
@@ -120,8 +378,6 @@ void CoreFile::sendAvatarFile(Core* core, uint32_t friendId, const QByteArray& d
 void CoreFile::sendFile(Core* core, uint32_t friendId, QString filename, QString filePath,
                         long long filesize)
 {
-    QMutexLocker mlocker(&fileSendMutex);
-
     QByteArray fileName = filename.toUtf8();
     uint32_t fileNum = tox_file_send(core->tox.get(), friendId, TOX_FILE_KIND_DATA, filesize,
                                      nullptr, (uint8_t*)fileName.data(), fileName.size(), nullptr);
@@ -137,29 +393,29 @@ void CoreFile::sendFile(Core* core, uint32_t friendId, QString filename, QString
     file.resumeFileId.resize(TOX_FILE_ID_LENGTH);
     tox_file_get_file_id(core->tox.get(), friendId, fileNum, (uint8_t*)file.resumeFileId.data(),
                          nullptr);
-    if (!file.open(false)) {
-        qWarning() << QString("sendFile: Can't open file, error: %1").arg(file.file->errorString());
-    }
+    // start buffering right away, so the first chunks are ready once the friend accepts
+    file.readAhead = std::make_shared<FileReadAhead>(filePath);
 
     addFile(friendId, fileNum, file);
+    rememberTransfer(core, file);
 
     emit core->fileSendStarted(file);
 }
 
 void CoreFile::pauseResumeFileSend(Core* core, uint32_t friendId, uint32_t fileId)
 {
-    ToxFile* file = findFile(friendId, fileId);
+    TransferRegistry::Handle file = findFile(friendId, fileId);
     if (!file) {
         qWarning("pauseResumeFileSend: No such file in queue");
         return;
     }
     if (file->status == ToxFile::TRANSMITTING) {
-        file->status = ToxFile::PAUSED;
+        setStatus(file.get(), ToxFile::PAUSED);
         emit core->fileTransferPaused(*file);
         tox_file_control(core->tox.get(), file->friendId, file->fileNum, TOX_FILE_CONTROL_PAUSE,
                          nullptr);
     } else if (file->status == ToxFile::PAUSED) {
-        file->status = ToxFile::TRANSMITTING;
+        setStatus(file.get(), ToxFile::TRANSMITTING);
         emit core->fileTransferAccepted(*file);
         tox_file_control(core->tox.get(), file->friendId, file->fileNum, TOX_FILE_CONTROL_RESUME,
                          nullptr);
@@ -170,18 +426,18 @@ void CoreFile::pauseResumeFileSend(Core* core, uint32_t friendId, uint32_t fileI
 
 void CoreFile::pauseResumeFileRecv(Core* core, uint32_t friendId, uint32_t fileId)
 {
-    ToxFile* file = findFile(friendId, fileId);
+    TransferRegistry::Handle file = findFile(friendId, fileId);
     if (!file) {
         qWarning("cancelFileRecv: No such file in queue");
         return;
     }
     if (file->status == ToxFile::TRANSMITTING) {
-        file->status = ToxFile::PAUSED;
+        setStatus(file.get(), ToxFile::PAUSED);
         emit core->fileTransferPaused(*file);
         tox_file_control(core->tox.get(), file->friendId, file->fileNum, TOX_FILE_CONTROL_PAUSE,
                          nullptr);
     } else if (file->status == ToxFile::PAUSED) {
-        file->status = ToxFile::TRANSMITTING;
+        setStatus(file.get(), ToxFile::TRANSMITTING);
         emit core->fileTransferAccepted(*file);
         tox_file_control(core->tox.get(), file->friendId, file->fileNum, TOX_FILE_CONTROL_RESUME,
                          nullptr);
@@ -192,13 +448,13 @@ void CoreFile::pauseResumeFileRecv(Core* core, uint32_t friendId, uint32_t fileI
 
 void CoreFile::cancelFileSend(Core* core, uint32_t friendId, uint32_t fileId)
 {
-    ToxFile* file = findFile(friendId, fileId);
+    TransferRegistry::Handle file = findFile(friendId, fileId);
     if (!file) {
         qWarning("cancelFileSend: No such file in queue");
         return;
     }
 
-    file->status = ToxFile::STOPPED;
+    setStatus(file.get(), ToxFile::STOPPED);
     emit core->fileTransferCancelled(*file);
     tox_file_control(core->tox.get(), file->friendId, file->fileNum, TOX_FILE_CONTROL_CANCEL, nullptr);
     removeFile(friendId, fileId);
@@ -206,12 +462,12 @@ void CoreFile::cancelFileSend(Core* core, uint32_t friendId, uint32_t fileId)
 
 void CoreFile::cancelFileRecv(Core* core, uint32_t friendId, uint32_t fileId)
 {
-    ToxFile* file = findFile(friendId, fileId);
+    TransferRegistry::Handle file = findFile(friendId, fileId);
     if (!file) {
         qWarning("cancelFileRecv: No such file in queue");
         return;
     }
-    file->status = ToxFile::STOPPED;
+    setStatus(file.get(), ToxFile::STOPPED);
     emit core->fileTransferCancelled(*file);
     tox_file_control(core->tox.get(), file->friendId, file->fileNum, TOX_FILE_CONTROL_CANCEL, nullptr);
     removeFile(friendId, fileId);
@@ -219,12 +475,12 @@ void CoreFile::cancelFileRecv(Core* core, uint32_t friendId, uint32_t fileId)
 
 void CoreFile::rejectFileRecvRequest(Core* core, uint32_t friendId, uint32_t fileId)
 {
-    ToxFile* file = findFile(friendId, fileId);
+    TransferRegistry::Handle file = findFile(friendId, fileId);
     if (!file) {
         qWarning("rejectFileRecvRequest: No such file in queue");
         return;
     }
-    file->status = ToxFile::STOPPED;
+    setStatus(file.get(), ToxFile::STOPPED);
     emit core->fileTransferCancelled(*file);
     tox_file_control(core->tox.get(), file->friendId, file->fileNum, TOX_FILE_CONTROL_CANCEL, nullptr);
     removeFile(friendId, fileId);
@@ -232,53 +488,104 @@ void CoreFile::rejectFileRecvRequest(Core* core, uint32_t friendId, uint32_t fil
 
 void CoreFile::acceptFileRecvRequest(Core* core, uint32_t friendId, uint32_t fileId, QString path)
 {
-    ToxFile* file = findFile(friendId, fileId);
+    TransferRegistry::Handle file = findFile(friendId, fileId);
     if (!file) {
         qWarning("acceptFileRecvRequest: No such file in queue");
         return;
     }
+    if (file->writeBehind) {
+        // resumed transfers are accepted already
+        qDebug() << "acceptFileRecvRequest: File already accepted";
+        return;
+    }
     file->setFilePath(path);
     if (!file->open(true)) {
         qWarning() << "acceptFileRecvRequest: Unable to open file";
         return;
     }
-    file->status = ToxFile::TRANSMITTING;
+    file->writeBehind = std::make_shared<FileWriteBehind>(file->file);
+    if (Settings::getInstance().getHashReceivedFiles()) {
+        file->writeBehind->enableHash();
+    }
+    rememberTransfer(core, *file);
+    setStatus(file.get(), ToxFile::TRANSMITTING);
     emit core->fileTransferAccepted(*file);
     tox_file_control(core->tox.get(), file->friendId, file->fileNum, TOX_FILE_CONTROL_RESUME, nullptr);
 }
 
-ToxFile* CoreFile::findFile(uint32_t friendId, uint32_t fileId)
+TransferRegistry::Handle CoreFile::findFile(uint32_t friendId, uint32_t fileId)
 {
-    uint64_t key = getFriendKey(friendId, fileId);
-    if (fileMap.contains(key)) {
-        return &fileMap[key];
+    TransferRegistry::Handle file = registry.find(friendId, fileId);
+    if (!file) {
+        qWarning() << "findFile: File transfer with ID" << friendId << ':' << fileId
+                   << "doesn't exist";
     }
 
-    qWarning() << "findFile: File transfer with ID" << friendId << ':' << fileId << "doesn't exist";
-    return nullptr;
+    return file;
 }
 
 void CoreFile::addFile(uint32_t friendId, uint32_t fileId, const ToxFile& file)
 {
     uint64_t key = getFriendKey(friendId, fileId);
 
-    if (fileMap.contains(key)) {
+    if (registry.find(friendId, fileId)) {
         qWarning() << "addFile: Overwriting existing file transfer with same ID" << friendId << ':'
                    << fileId;
     }
 
-    fileMap.insert(key, file);
+    registry.insert(file);
+    if (file.status == ToxFile::TRANSMITTING) {
+        activeFiles.insert(key);
+    } else {
+        activeFiles.remove(key);
+    }
 }
 
 void CoreFile::removeFile(uint32_t friendId, uint32_t fileId)
 {
     uint64_t key = getFriendKey(friendId, fileId);
-    if (!fileMap.contains(key)) {
+    TransferRegistry::Handle file = registry.take(friendId, fileId);
+    if (!file) {
         qWarning() << "removeFile: No such file in queue";
         return;
     }
-    fileMap[key].file->close();
-    fileMap.remove(key);
+    // transfers broken by a disconnect are continued once the friend is back
+    if (transferStore && file->status != ToxFile::BROKEN && file->fileKind == TOX_FILE_KIND_DATA) {
+        transferStore->removeTransfer(file->resumeFileId);
+    }
+    if (file->writeBehind) {
+        // the I/O thread owns the file now, it closes it once the buffer is written
+        file->writeBehind->close();
+    } else {
+        file->file->close();
+    }
+    if (file->readAhead) {
+        file->readAhead->close();
+    }
+    activeFiles.remove(key);
+    pendingChunks.remove(key);
+    throttledFiles.remove(key);
+    finishingFiles.remove(key);
+}
+
+/**
+ * @brief Remembers a data transfer, so it can be continued after a disconnect or restart.
+ */
+void CoreFile::rememberTransfer(Core* core, const ToxFile& file)
+{
+    if (!transferStore) {
+        return;
+    }
+
+    TransferStore::Transfer transfer;
+    transfer.fileId = file.resumeFileId;
+    transfer.friendPk = core->getFriendPublicKey(file.friendId);
+    transfer.direction = file.direction;
+    transfer.fileName = file.fileName;
+    transfer.filePath = file.filePath;
+    transfer.filesize = file.filesize;
+    transfer.bytesDone = 0;
+    transferStore->addTransfer(transfer);
 }
 
 QString CoreFile::getCleanFileName(QString filename)
@@ -331,6 +638,9 @@ void CoreFile::onFileReceiveCallback(Tox*, uint32_t friendId, uint32_t fileId, u
     file.resumeFileId.resize(TOX_FILE_ID_LENGTH);
     tox_file_get_file_id(core->tox.get(), friendId, fileId, (uint8_t*)file.resumeFileId.data(),
                          nullptr);
+    if (kind == TOX_FILE_KIND_DATA && resumeFileRecv(core, file)) {
+        return;
+    }
     addFile(friendId, fileId, file);
     if (kind != TOX_FILE_KIND_AVATAR)
         emit core->fileReceiveRequested(file);
@@ -341,6 +651,8 @@ void CoreFile::handleAvatarOffer(uint32_t friendId, uint32_t fileId, bool accept
 {
     // TODO(sudden6): evil evil evil
     auto core = Core::getInstance();
+    // called from the GUI thread, unlike the rest of CoreFile
+    QMutexLocker ml{core->coreLoopLock.get()};
     if (!accept) {
         // If it's an avatar but we already have it cached, cancel
         qDebug() << QString("Received avatar request %1:%2, reject, since we have it in cache.")
@@ -369,7 +681,7 @@ void CoreFile::handleAvatarOffer(uint32_t friendId, uint32_t fileId, bool accept
 void CoreFile::onFileControlCallback(Tox*, uint32_t friendId, uint32_t fileId,
                                      TOX_FILE_CONTROL control, void* core)
 {
-    ToxFile* file = findFile(friendId, fileId);
+    TransferRegistry::Handle file = findFile(friendId, fileId);
     if (!file) {
         qWarning("onFileControlCallback: No such file in queue");
         return;
@@ -382,14 +694,14 @@ void CoreFile::onFileControlCallback(Tox*, uint32_t friendId, uint32_t fileId,
         removeFile(friendId, fileId);
     } else if (control == TOX_FILE_CONTROL_PAUSE) {
         qDebug() << "onFileControlCallback: Received pause for file " << friendId << ":" << fileId;
-        file->status = ToxFile::PAUSED;
+        setStatus(file.get(), ToxFile::PAUSED);
         emit static_cast<Core*>(core)->fileTransferRemotePausedUnpaused(*file, true);
     } else if (control == TOX_FILE_CONTROL_RESUME) {
         if (file->direction == ToxFile::SENDING && file->fileKind == TOX_FILE_KIND_AVATAR)
             qDebug() << "Avatar transfer" << fileId << "to friend" << friendId << "accepted";
         else
             qDebug() << "onFileControlCallback: Received resume for file " << friendId << ":" << fileId;
-        file->status = ToxFile::TRANSMITTING;
+        setStatus(file.get(), ToxFile::TRANSMITTING);
         emit static_cast<Core*>(core)->fileTransferRemotePausedUnpaused(*file, false);
     } else {
         qWarning() << "Unhandled file control " << control << " for file " << friendId << ':' << fileId;
@@ -400,7 +712,7 @@ void CoreFile::onFileDataCallback(Tox* tox, uint32_t friendId, uint32_t fileId,
                                   size_t length, void* core)
 {
 
-    ToxFile* file = findFile(friendId, fileId);
+    TransferRegistry::Handle file = findFile(friendId, fileId);
     if (!file) {
         qWarning("onFileDataCallback: No such file in queue");
         return;
@@ -416,39 +728,100 @@ void CoreFile::onFileDataCallback(Tox* tox, uint32_t friendId, uint32_t fileId,
         return;
     }
 
-    unique_ptr<uint8_t[]> data(new uint8_t[length]);
-    int64_t nread;
-
     if (file->fileKind == TOX_FILE_KIND_AVATAR) {
-        QByteArray chunk = file->avatarData.mid(pos, length);
-        nread = chunk.size();
-        memcpy(data.get(), chunk.data(), nread);
-    } else {
-        file->file->seek(pos);
-        nread = file->file->read((char*)data.get(), length);
-        if (nread <= 0) {
-            qWarning("onFileDataCallback: Failed to read from file");
-            emit static_cast<Core*>(core)->fileTransferCancelled(*file);
-            tox_file_send_chunk(tox, friendId, fileId, pos, nullptr, 0, nullptr);
-            removeFile(friendId, fileId);
-            return;
+        // all transfers share the avatar buffer, send straight from it
+        const uint64_t size = static_cast<uint64_t>(file->avatarData.size());
+        const size_t nread =
+            pos < size ? static_cast<size_t>(qMin<uint64_t>(length, size - pos)) : 0;
+        const uint8_t* data = reinterpret_cast<const uint8_t*>(file->avatarData.constData()) + pos;
+        if (!tox_file_send_chunk(tox, friendId, fileId, pos, nread ? data : nullptr, nread,
+                                 nullptr)) {
+            qWarning("onFileDataCallback: Failed to send data chunk");
         }
-        file->bytesSent += length;
+        return;
     }
 
-    if (!tox_file_send_chunk(tox, friendId, fileId, pos, data.get(), nread, nullptr)) {
-        qWarning("onFileDataCallback: Failed to send data chunk");
+    // chunks have to be sent in order, queue behind the ones still waiting for the disk
+    const uint64_t key = getFriendKey(friendId, fileId);
+    auto pending = pendingChunks.find(key);
+    if (pending != pendingChunks.end()) {
+        pending->enqueue({pos, length});
         return;
     }
-    if (file->fileKind != TOX_FILE_KIND_AVATAR)
-        emit static_cast<Core*>(core)->fileTransferInfo(*file);
+
+    if (sendFileChunk(static_cast<Core*>(core), file.get(), pos, length) == ChunkStatus::PENDING) {
+        pendingChunks[key].enqueue({pos, length});
+    }
+}
+
+/**
+ * @brief Sends a chunk of a data file from its read-ahead buffer.
+ * @return PENDING if the chunk isn't buffered yet, FAILED if the transfer was cancelled because
+ * the file couldn't be read.
+ */
+CoreFile::ChunkStatus CoreFile::sendFileChunk(Core* core, ToxFile* file, uint64_t pos, size_t length)
+{
+    Tox* tox = core->tox.get();
+    const uint8_t* data = nullptr;
+    const int64_t nread = file->readAhead->read(pos, length, &data);
+    if (nread == 0) {
+        return ChunkStatus::PENDING;
+    }
+
+    if (nread < 0) {
+        qWarning("onFileDataCallback: Failed to read from file");
+        emit core->fileTransferCancelled(*file);
+        tox_file_send_chunk(tox, file->friendId, file->fileNum, pos, nullptr, 0, nullptr);
+        removeFile(file->friendId, file->fileNum);
+        return ChunkStatus::FAILED;
+    }
+
+    file->bytesSent += nread;
+    if (tox_file_send_chunk(tox, file->friendId, file->fileNum, pos, data, nread, nullptr)) {
+        scheduler.addBytes(nread);
+    } else {
+        qWarning("onFileDataCallback: Failed to send data chunk");
+    }
+
+    return ChunkStatus::SENT;
+}
+
+/**
+ * @brief Sends the chunks that toxcore requested before they were read from disk.
+ */
+void CoreFile::flushPendingChunks(Core* core)
+{
+    for (uint64_t key : pendingChunks.keys()) {
+        TransferRegistry::Handle file = registry.find(key);
+        if (!file) {
+            pendingChunks.remove(key);
+            continue;
+        }
+
+        QQueue<ChunkRequest>& queue = pendingChunks[key];
+        ChunkStatus status = ChunkStatus::SENT;
+        while (!queue.isEmpty()) {
+            const ChunkRequest request = queue.head();
+            status = sendFileChunk(core, file.get(), request.pos, request.length);
+            if (status != ChunkStatus::SENT) {
+                break;
+            }
+
+            queue.dequeue();
+        }
+
+        // a failed transfer already removed itself
+        if (status == ChunkStatus::SENT) {
+            pendingChunks.remove(key);
+        }
+    }
 }
 
 void CoreFile::onFileRecvChunkCallback(Tox* tox, uint32_t friendId, uint32_t fileId, uint64_t position,
                                        const uint8_t* data, size_t length, void* vCore)
 {
     Core* core = static_cast<Core*>(vCore);
-    ToxFile* file = findFile(friendId, fileId);
+    TransferRegistry::Handle file = findFile(friendId, fileId);
     if (!file) {
         qWarning("onFileRecvChunkCallback: No such file in queue");
         tox_file_control(tox, friendId, fileId, TOX_FILE_CONTROL_CANCEL, nullptr);
@@ -475,6 +848,11 @@ void CoreFile::onFileRecvChunkCallback(Tox* tox, uint32_t friendId, uint32_t fil
                 // TODO(sudden6): signal below is deprecated
                 emit core->friendAvatarChangedDeprecated(friendId, pic);
             }
+        } else if (file->writeBehind) {
+            // report the transfer as finished once the file is completely on disk
+            file->writeBehind->close();
+            finishingFiles.insert(getFriendKey(friendId, fileId));
+            return;
         } else {
             emit core->fileTransferFinished(*file);
             emit core->fileDownloadFinished(file->filePath);
@@ -483,30 +861,98 @@ void CoreFile::onFileRecvChunkCallback(Tox* tox, uint32_t friendId, uint32_t fil
         return;
     }
 
-    if (file->fileKind == TOX_FILE_KIND_AVATAR)
+    if (file->fileKind == TOX_FILE_KIND_AVATAR) {
         file->avatarData.append((char*)data, length);
-    else
-        file->file->write((char*)data, length);
+    } else if (!file->writeBehind || !file->writeBehind->write(data, length)) {
+        failFileRecv(core, file.get());
+        return;
+    }
     file->bytesSent += length;
+    scheduler.addBytes(length);
+
+    if (file->fileKind != TOX_FILE_KIND_AVATAR
+        && file->writeBehind->pending() > FileWriteBehind::HIGH_WATERMARK) {
+        const uint64_t key = getFriendKey(friendId, fileId);
+        if (!throttledFiles.contains(key)) {
+            qDebug() << "onFileRecvChunkCallback: Disk is too slow, pausing file" << friendId << ':'
+                     << fileId;
+            tox_file_control(tox, friendId, fileId, TOX_FILE_CONTROL_PAUSE, nullptr);
+            throttledFiles.insert(key);
+        }
+    }
+}
 
-    if (file->fileKind != TOX_FILE_KIND_AVATAR)
-        emit static_cast<Core*>(core)->fileTransferInfo(*file);
+/**
+ * @brief Cancels an incoming transfer whose file can't be written.
+ */
+void CoreFile::failFileRecv(Core* core, ToxFile* file)
+{
+    qWarning() << "Failed to write file transfer" << file->friendId << ':' << file->fileNum
+               << "to disk, aborting transfer";
+    setStatus(file, ToxFile::STOPPED);
+    emit core->fileTransferCancelled(*file);
+    tox_file_control(core->tox.get(), file->friendId, file->fileNum, TOX_FILE_CONTROL_CANCEL,
+                     nullptr);
+    removeFile(file->friendId, file->fileNum);
+}
+
+/**
+ * @brief Follows the write-behind buffers of incoming transfers.
+ *
+ * Resumes transfers paused because the disk couldn't keep up once their buffer drained, and
+ * reports transfers as finished once their last byte is written.
+ */
+void CoreFile::updateWriteBehind(Core* core)
+{
+    for (uint64_t key : throttledFiles.values()) {
+        TransferRegistry::Handle file = registry.find(key);
+        if (!file) {
+            throttledFiles.remove(key);
+            continue;
+        }
+
+        if (file->writeBehind->hasFailed()) {
+            failFileRecv(core, file.get());
+            continue;
+        }
+
+        if (file->writeBehind->pending() > FileWriteBehind::LOW_WATERMARK) {
+            continue;
+        }
+
+        throttledFiles.remove(key);
+        // the user may have paused the transfer in the meantime
+        if (file->status == ToxFile::TRANSMITTING) {
+            tox_file_control(core->tox.get(), file->friendId, file->fileNum,
+                             TOX_FILE_CONTROL_RESUME, nullptr);
+        }
+    }
+
+    for (uint64_t key : finishingFiles.values()) {
+        TransferRegistry::Handle file = registry.find(key);
+        if (!file) {
+            finishingFiles.remove(key);
+            continue;
+        }
+
+        if (file->writeBehind->hasFailed()) {
+            failFileRecv(core, file.get());
+        } else if (file->writeBehind->isFinished()) {
+            file->hash = file->writeBehind->digest();
+            emit core->fileTransferFinished(*file);
+            emit core->fileDownloadFinished(file->filePath);
+            removeFile(file->friendId, file->fileNum);
+        }
+    }
 }
 
 void CoreFile::onConnectionStatusChanged(Core* core, uint32_t friendId, bool online)
 {
-    // TODO: Actually resume broken file transfers
-    // We need to:
-    // - Start a new file transfer with the same 32byte file ID with toxcore
-    // - Seek to the correct position again
-    // - Update the fileNum in our ToxFile
-    // - Update the users of our signals to check the 32byte tox file ID, not the uint32_t file_num
-    // (fileId)
+    // toxcore drops the transfers of an offline friend, resumeFileSends() starts new ones with
+    // the same file ID once the friend is back and resumeFileRecv() continues them
     ToxFile::FileStatus status = online ? ToxFile::TRANSMITTING : ToxFile::BROKEN;
-    for (uint64_t key : fileMap.keys()) {
-        if (key >> 32 != friendId)
-            continue;
-        fileMap[key].status = status;
-        emit core->fileTransferBrokenUnbroken(fileMap[key], !online);
+    for (const TransferRegistry::Handle& file : registry.filesOf(friendId)) {
+        setStatus(file.get(), status);
+        emit core->fileTransferBrokenUnbroken(*file, !online);
     }
 }
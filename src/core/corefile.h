@@ -26,14 +26,21 @@
 #include <memory>
 #include <tox/tox.h>
 
+#include "memoryusage.h"
 #include "toxfile.h"
+#include "transferregistry.h"
+#include "transferscheduler.h"
 
+#include <QElapsedTimer>
 #include <QHash>
-#include <QMutex>
+#include <QQueue>
+#include <QSet>
 #include <QString>
 
 struct Tox;
 class Core;
+class ToxPk;
+class TransferStore;
 
 class CoreFile
 {
@@ -42,6 +49,7 @@ class CoreFile
 
 public:
     static void handleAvatarOffer(uint32_t friendId, uint32_t fileId, bool accept);
+    static MemoryUsage::Entry getMemoryUsage();
 
 private:
     CoreFile() = delete;
@@ -57,15 +65,41 @@ private:
     static void cancelFileRecv(Core* core, uint32_t friendId, uint32_t fileId);
     static void rejectFileRecvRequest(Core* core, uint32_t friendId, uint32_t fileId);
     static void acceptFileRecvRequest(Core* core, uint32_t friendId, uint32_t fileId, QString path);
-    static ToxFile* findFile(uint32_t friendId, uint32_t fileId);
+    static TransferRegistry::Handle findFile(uint32_t friendId, uint32_t fileId);
     static void addFile(uint32_t friendId, uint32_t fileId, const ToxFile& file);
     static void removeFile(uint32_t friendId, uint32_t fileId);
     static unsigned corefileIterationInterval();
+    static void setStatus(ToxFile* file, ToxFile::FileStatus status);
+    static void publishProgress(Core* core);
+    static void flushPendingChunks(Core* core);
+    static void updateWriteBehind(Core* core);
+    static void setTransferStore(std::shared_ptr<TransferStore> store);
+    static void forgetTransfers(const ToxPk& friendPk);
+    static void resumeFileSends(Core* core, uint32_t friendId);
+    static bool resumeFileRecv(Core* core, ToxFile& file);
+    static void rememberTransfer(Core* core, const ToxFile& file);
     static constexpr uint64_t getFriendKey(uint32_t friendId, uint32_t fileId)
     {
-        return (static_cast<std::uint64_t>(friendId) << 32) + fileId;
+        return TransferRegistry::makeKey(friendId, fileId);
     }
 
+private:
+    enum class ChunkStatus
+    {
+        SENT,
+        PENDING,
+        FAILED
+    };
+
+    struct ChunkRequest
+    {
+        uint64_t pos;
+        size_t length;
+    };
+
+    static ChunkStatus sendFileChunk(Core* core, ToxFile* file, uint64_t pos, size_t length);
+    static void failFileRecv(Core* core, ToxFile* file);
+
 private:
     static void onFileReceiveCallback(Tox*, uint32_t friendId, uint32_t fileId, uint32_t kind,
                                       uint64_t filesize, const uint8_t* fname, size_t fnameLen,
@@ -79,8 +113,18 @@ private:
     static void onConnectionStatusChanged(Core* core, uint32_t friendId, bool online);
 
 private:
-    static QMutex fileSendMutex;
-    static QHash<uint64_t, ToxFile> fileMap;
+    static TransferRegistry registry;
+    static QHash<uint64_t, QQueue<ChunkRequest>> pendingChunks;
+    static QSet<uint64_t> throttledFiles;
+    static QSet<uint64_t> finishingFiles;
+    static QSet<uint64_t> activeFiles;
+    static TransferScheduler scheduler;
+    static QElapsedTimer progressTimer;
+    static std::shared_ptr<TransferStore> transferStore;
+    static QByteArray hashedAvatar;
+    static QByteArray avatarHash;
+    static constexpr qint64 PROGRESS_INTERVAL = 1000;
+    static constexpr quint64 PROGRESS_STORE_INTERVAL = 16 * 1024 * 1024;
     static QString getCleanFileName(QString filename);
 };
 
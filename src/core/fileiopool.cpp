@@ -0,0 +1,47 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "fileiopool.h"
+
+#include <QThreadPool>
+
+/**
+ * @class FileIoPool
+ * @brief Thread pool running the disk I/O of all file transfers.
+ *
+ * Kept separate from QThreadPool::globalInstance() so slow disks can't starve other users of
+ * it, and small since the tasks are I/O bound.
+ */
+
+/**
+ * @brief Returns the pool, created on first use.
+ */
+QThreadPool* FileIoPool::instance()
+{
+    struct Pool : QThreadPool
+    {
+        Pool()
+        {
+            setMaxThreadCount(2);
+        }
+    };
+
+    static Pool pool;
+    return &pool;
+}
@@ -0,0 +1,299 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "filereadahead.h"
+#include "fileiopool.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QMutex>
+#include <QRunnable>
+#include <QVector>
+
+#include <atomic>
+#include <cstring>
+
+/**
+ * @class FileReadAhead
+ * @brief Serves the chunks of a file that is being sent from memory.
+ *
+ * The file is read sequentially in blocks of BLOCK_SIZE bytes by a task on the FileIoPool, up
+ * to MAX_BLOCKS blocks ahead of the position last requested. read() never touches the file
+ * itself: it either hands out buffered data or reports that the data isn't there yet and lets
+ * the caller retry later. A request outside of the buffered window (e.g.
+ * after toxcore seeked) drops the buffer and restarts reading at the requested position.
+ *
+ * @note read() must always be called from the same thread.
+ *
+ * @var FileReadAhead::BLOCK_SIZE
+ * @brief Size of a single read from the file.
+ *
+ * @var FileReadAhead::MAX_BLOCKS
+ * @brief Number of blocks buffered ahead at most.
+ */
+
+constexpr int FileReadAhead::BLOCK_SIZE;
+constexpr int FileReadAhead::MAX_BLOCKS;
+
+namespace {
+// buffered bytes of all instances, for MemoryUsage
+std::atomic<qint64> allBuffered{0};
+} // namespace
+
+struct FileReadAhead::State
+{
+    explicit State(const QString& path)
+        : file(path)
+    {
+    }
+
+    ~State()
+    {
+        allBuffered -= buffered;
+    }
+
+    void addBuffered(qint64 bytes)
+    {
+        buffered += bytes;
+        allBuffered += bytes;
+    }
+
+    QMutex mutex;
+    // only used by the single FillTask running at a time
+    QFile file;
+    QVector<QByteArray> blocks;
+    // file offset of the first buffered block
+    quint64 windowStart = 0;
+    // file offset the next block is read from
+    quint64 readOffset = 0;
+    qint64 buffered = 0;
+    // bumped when the window is moved, to discard blocks read for the old position
+    int generation = 0;
+    bool filling = false;
+    bool eof = false;
+    bool failed = false;
+    bool closed = false;
+};
+
+class FileReadAhead::FillTask : public QRunnable
+{
+public:
+    explicit FillTask(std::shared_ptr<State> state)
+        : state{state}
+    {
+    }
+
+    void run() override
+    {
+        while (true) {
+            quint64 offset;
+            int generation;
+            {
+                QMutexLocker locker{&state->mutex};
+                if (state->closed) {
+                    state->file.close();
+                    state->filling = false;
+                    return;
+                }
+
+                if (state->eof || state->failed
+                    || state->buffered + BLOCK_SIZE > MAX_BLOCKS * BLOCK_SIZE) {
+                    state->filling = false;
+                    return;
+                }
+
+                offset = state->readOffset;
+                generation = state->generation;
+            }
+
+            QByteArray block;
+            qint64 nread = -1;
+            if (!state->file.isOpen() && !state->file.open(QIODevice::ReadOnly)) {
+                qWarning() << "FileReadAhead: Can't open file, error:" << state->file.errorString();
+            } else if (state->file.seek(offset)) {
+                block.resize(BLOCK_SIZE);
+                nread = state->file.read(block.data(), BLOCK_SIZE);
+            }
+
+            QMutexLocker locker{&state->mutex};
+            if (generation != state->generation) {
+                continue;
+            }
+
+            if (nread < 0) {
+                qWarning() << "FileReadAhead: Failed to read from file";
+                state->failed = true;
+                state->filling = false;
+                return;
+            }
+
+            if (nread == 0) {
+                state->eof = true;
+                state->filling = false;
+                return;
+            }
+
+            block.resize(static_cast<int>(nread));
+            state->blocks.append(block);
+            state->readOffset += nread;
+            state->addBuffered(nread);
+        }
+    }
+
+private:
+    std::shared_ptr<State> state;
+};
+
+/**
+ * @brief Starts buffering the file from its beginning.
+ * @param path File to read, it is opened by the I/O thread.
+ */
+FileReadAhead::FileReadAhead(const QString& path)
+    : state{std::make_shared<State>(path)}
+{
+    QMutexLocker locker{&state->mutex};
+    scheduleFill();
+}
+
+FileReadAhead::~FileReadAhead()
+{
+    close();
+}
+
+/**
+ * @brief Returns the number of bytes buffered by all instances together.
+ */
+qint64 FileReadAhead::totalBuffered()
+{
+    return allBuffered.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Drops the buffer and lets the I/O thread close the file.
+ *
+ * Copies of a ToxFile may keep this object alive long after the transfer ended, so this is
+ * called when the transfer is removed instead of relying on the destructor.
+ */
+void FileReadAhead::close()
+{
+    QMutexLocker locker{&state->mutex};
+    if (state->closed) {
+        return;
+    }
+
+    state->closed = true;
+    state->blocks.clear();
+    state->addBuffered(-state->buffered);
+    // a block being read right now is dropped too
+    ++state->generation;
+    if (!state->filling) {
+        state->filling = true;
+        FileIoPool::instance()->start(new FillTask(state));
+    }
+}
+
+/**
+ * @brief Returns buffered file data without blocking.
+ * @param pos File offset of the data.
+ * @param length Number of bytes wanted.
+ * @param data Set to the data, stays valid until the next call.
+ * @return Number of bytes available at data, 0 if they aren't buffered yet and -1 on a read
+ * error, after close() or when pos is beyond the end of the file.
+ */
+qint64 FileReadAhead::read(quint64 pos, size_t length, const uint8_t** data)
+{
+    QMutexLocker locker{&state->mutex};
+    if (state->failed || state->closed) {
+        return -1;
+    }
+
+    if (pos < state->windowStart || pos > state->windowStart + state->buffered) {
+        state->blocks.clear();
+        state->addBuffered(-state->buffered);
+        state->windowStart = pos;
+        state->readOffset = pos;
+        state->eof = false;
+        ++state->generation;
+        scheduleFill();
+        return 0;
+    }
+
+    // release the blocks that have been handed out completely
+    while (!state->blocks.isEmpty()
+           && state->windowStart + state->blocks.first().size() <= pos) {
+        const int size = state->blocks.first().size();
+        state->windowStart += size;
+        state->addBuffered(-size);
+        state->blocks.removeFirst();
+    }
+
+    scheduleFill();
+
+    const quint64 available = state->windowStart + state->buffered - pos;
+    if (available < length) {
+        if (!state->eof) {
+            return 0;
+        }
+
+        if (!available) {
+            return -1;
+        }
+
+        length = available;
+    }
+
+    const QByteArray& first = state->blocks.first();
+    const int offset = static_cast<int>(pos - state->windowStart);
+    if (offset + length <= static_cast<size_t>(first.size())) {
+        *data = reinterpret_cast<const uint8_t*>(first.constData() + offset);
+        return static_cast<qint64>(length);
+    }
+
+    // the chunk spans blocks, collect it
+    scratch.resize(static_cast<int>(length));
+    int copied = 0;
+    int blockOffset = offset;
+    for (const QByteArray& block : state->blocks) {
+        const int n = qMin(block.size() - blockOffset, static_cast<int>(length) - copied);
+        memcpy(scratch.data() + copied, block.constData() + blockOffset, n);
+        copied += n;
+        blockOffset = 0;
+        if (copied == static_cast<int>(length)) {
+            break;
+        }
+    }
+
+    *data = reinterpret_cast<const uint8_t*>(scratch.constData());
+    return static_cast<qint64>(length);
+}
+
+/**
+ * @brief Starts a FillTask unless one is running or the buffer is full.
+ * @note The state mutex must be held.
+ */
+void FileReadAhead::scheduleFill()
+{
+    if (state->filling || state->eof || state->failed || state->closed
+        || state->buffered + BLOCK_SIZE > MAX_BLOCKS * BLOCK_SIZE) {
+        return;
+    }
+
+    state->filling = true;
+    FileIoPool::instance()->start(new FillTask(state));
+}
@@ -0,0 +1,58 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FILEREADAHEAD_H
+#define FILEREADAHEAD_H
+
+#include <QByteArray>
+#include <QString>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+class FileReadAhead
+{
+public:
+    explicit FileReadAhead(const QString& path);
+    ~FileReadAhead();
+    FileReadAhead(const FileReadAhead&) = delete;
+    FileReadAhead& operator=(const FileReadAhead&) = delete;
+
+    qint64 read(quint64 pos, size_t length, const uint8_t** data);
+    void close();
+
+    static qint64 totalBuffered();
+
+public:
+    static constexpr int BLOCK_SIZE = 256 * 1024;
+    static constexpr int MAX_BLOCKS = 8;
+
+private:
+    struct State;
+    class FillTask;
+
+    void scheduleFill();
+
+private:
+    std::shared_ptr<State> state;
+    QByteArray scratch;
+};
+
+#endif // FILEREADAHEAD_H
@@ -0,0 +1,356 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "filewritebehind.h"
+#include "fileiopool.h"
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QFile>
+#include <QMutex>
+#include <QRunnable>
+
+#include <atomic>
+#include <sodium.h>
+
+/**
+ * @class FileWriteBehind
+ * @brief Writes the chunks of a file that is being received on the FileIoPool.
+ *
+ * write() only appends to a memory buffer. A task on the I/O pool takes everything buffered so
+ * far and writes it in one go, so the slower the disk, the larger the writes get. The caller
+ * is expected to throttle the sender once pending() exceeds HIGH_WATERMARK and to let it
+ * continue once it dropped below LOW_WATERMARK; write() itself never refuses data.
+ *
+ * The file has to be opened for writing before, and must not be used by anyone else
+ * afterwards. close() writes out what's left and closes it, isFinished() tells when that's done.
+ *
+ * checkpoint() tells how much of the file is written out, together with a checksum of the last
+ * CHECKSUM_WINDOW bytes before that offset. Comparing it with the checksum of readTail() later
+ * shows if a partial file can be continued.
+ *
+ * With enableHash(), a BLAKE2b digest of the data is computed while it's written, so the
+ * complete file doesn't need to be read again to verify it.
+ *
+ * @note All methods must be called from the same thread.
+ *
+ * @var FileWriteBehind::HIGH_WATERMARK
+ * @brief Amount of unwritten data at which the sender should be paused.
+ *
+ * @var FileWriteBehind::LOW_WATERMARK
+ * @brief Amount of unwritten data at which a paused sender may continue.
+ *
+ * @var FileWriteBehind::CHECKSUM_WINDOW
+ * @brief Number of bytes before a checkpoint covered by its checksum.
+ */
+
+constexpr qint64 FileWriteBehind::HIGH_WATERMARK;
+constexpr qint64 FileWriteBehind::LOW_WATERMARK;
+constexpr int FileWriteBehind::CHECKSUM_WINDOW;
+
+namespace {
+// pending bytes of all instances, for MemoryUsage
+std::atomic<qint64> allPending{0};
+} // namespace
+
+struct FileWriteBehind::State
+{
+    State(std::shared_ptr<QFile> file, quint64 offset, const QByteArray& tail)
+        : file{file}
+        , tail{tail}
+        , written{offset}
+        , checkpointTail{tail}
+        , checkpoint{offset, {}}
+    {
+    }
+
+    ~State()
+    {
+        // data left behind after a failure
+        allPending -= pending;
+    }
+
+    void addPending(qint64 bytes)
+    {
+        pending += bytes;
+        allPending += bytes;
+    }
+
+    mutable QMutex mutex;
+    // only used by the single FlushTask running at a time once constructed
+    std::shared_ptr<QFile> file;
+    QByteArray incoming;
+    // last CHECKSUM_WINDOW bytes written, only used by the FlushTask too
+    QByteArray tail;
+    quint64 written;
+    // tail at checkpoint.offset, the checksum is only computed once checkpoint() asks for it
+    QByteArray checkpointTail;
+    Checkpoint checkpoint;
+    // only used by the FlushTask once the first write was queued
+    crypto_generichash_state hashState;
+    bool hashing = false;
+    QByteArray digest;
+    // bytes in incoming plus bytes currently being written
+    qint64 pending = 0;
+    bool flushing = false;
+    bool closing = false;
+    bool finished = false;
+    bool failed = false;
+};
+
+class FileWriteBehind::FlushTask : public QRunnable
+{
+public:
+    explicit FlushTask(std::shared_ptr<State> state)
+        : state{state}
+    {
+    }
+
+    void run() override
+    {
+        QByteArray writing;
+        QMutexLocker locker{&state->mutex};
+        while (!state->failed && !state->incoming.isEmpty()) {
+            // swap instead of copying, both buffers keep their capacity for the next round
+            writing.swap(state->incoming);
+            locker.unlock();
+
+            const bool written =
+                state->file->write(writing) == writing.size() && state->file->flush();
+            if (written) {
+                state->written += writing.size();
+                if (writing.size() >= CHECKSUM_WINDOW) {
+                    state->tail = writing.right(CHECKSUM_WINDOW);
+                } else {
+                    state->tail = (state->tail + writing).right(CHECKSUM_WINDOW);
+                }
+                if (state->hashing) {
+                    crypto_generichash_update(&state->hashState,
+                                              reinterpret_cast<const uint8_t*>(writing.constData()),
+                                              writing.size());
+                }
+            }
+
+            locker.relock();
+            state->addPending(-writing.size());
+            writing.resize(0);
+            if (written) {
+                // the tail is implicitly shared, publishing it doesn't copy
+                state->checkpointTail = state->tail;
+                state->checkpoint = {state->written, {}};
+            } else {
+                qWarning() << "FileWriteBehind: Failed to write to file, error:"
+                           << state->file->errorString();
+                state->failed = true;
+            }
+        }
+
+        if (state->closing || state->failed) {
+            state->file->close();
+            state->finished = state->closing;
+            if (state->finished && !state->failed && state->hashing) {
+                QByteArray digest(crypto_generichash_BYTES, '\0');
+                crypto_generichash_final(&state->hashState,
+                                         reinterpret_cast<uint8_t*>(digest.data()), digest.size());
+                state->digest = digest;
+            }
+        }
+
+        state->flushing = false;
+    }
+
+private:
+    std::shared_ptr<State> state;
+};
+
+/**
+ * @param file File opened for writing, positioned where the first chunk goes.
+ * @param offset Position of file, when continuing a partial file.
+ * @param tail Data right before offset as returned by readTail(), when continuing a partial file.
+ */
+FileWriteBehind::FileWriteBehind(std::shared_ptr<QFile> file, quint64 offset,
+                                 const QByteArray& tail)
+    : state{std::make_shared<State>(file, offset, tail)}
+{
+}
+
+FileWriteBehind::~FileWriteBehind()
+{
+    close();
+}
+
+/**
+ * @brief Queues data to be appended to the file.
+ * @return False if writing to the file failed before, the data is discarded then.
+ */
+bool FileWriteBehind::write(const uint8_t* data, size_t length)
+{
+    QMutexLocker locker{&state->mutex};
+    if (state->failed || state->closing) {
+        return false;
+    }
+
+    state->incoming.append(reinterpret_cast<const char*>(data), static_cast<int>(length));
+    state->addPending(static_cast<qint64>(length));
+    scheduleFlush();
+    return true;
+}
+
+/**
+ * @brief Returns the number of bytes queued but not written to the file yet.
+ */
+qint64 FileWriteBehind::pending() const
+{
+    QMutexLocker locker{&state->mutex};
+    return state->pending;
+}
+
+/**
+ * @brief Returns the number of bytes queued by all instances together.
+ */
+qint64 FileWriteBehind::totalPending()
+{
+    return allPending.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Writes out the queued data in the background and closes the file.
+ */
+void FileWriteBehind::close()
+{
+    QMutexLocker locker{&state->mutex};
+    if (state->closing) {
+        return;
+    }
+
+    state->closing = true;
+    scheduleFlush();
+}
+
+/**
+ * @brief Checks if close() was called and the file is completely written and closed.
+ */
+bool FileWriteBehind::isFinished() const
+{
+    QMutexLocker locker{&state->mutex};
+    return state->finished;
+}
+
+/**
+ * @brief Checks if writing to the file failed, the transfer can't complete then.
+ */
+bool FileWriteBehind::hasFailed() const
+{
+    QMutexLocker locker{&state->mutex};
+    return state->failed;
+}
+
+/**
+ * @brief Returns how much of the file is written out, and the checksum of the data before that.
+ *
+ * The checksum is computed here rather than after every write, and only if the file grew since
+ * the last call.
+ */
+FileWriteBehind::Checkpoint FileWriteBehind::checkpoint() const
+{
+    QMutexLocker locker{&state->mutex};
+    if (!state->checkpoint.checksum.isEmpty()) {
+        return state->checkpoint;
+    }
+
+    Checkpoint checkpoint = state->checkpoint;
+    const QByteArray tail = state->checkpointTail;
+    // don't hold up the FlushTask while hashing
+    locker.unlock();
+    checkpoint.checksum = checksum(tail);
+    locker.relock();
+
+    if (state->checkpoint.offset == checkpoint.offset) {
+        state->checkpoint = checkpoint;
+    }
+    return checkpoint;
+}
+
+/**
+ * @brief Computes a BLAKE2b digest of everything written, must be called before the first write.
+ * @return False if the file doesn't start at offset 0 or data was written already, the data
+ * before can't be included in the digest then.
+ */
+bool FileWriteBehind::enableHash()
+{
+    QMutexLocker locker{&state->mutex};
+    if (state->written != 0 || state->pending != 0 || state->closing) {
+        return false;
+    }
+
+    crypto_generichash_init(&state->hashState, nullptr, 0, crypto_generichash_BYTES);
+    state->hashing = true;
+    return true;
+}
+
+/**
+ * @brief Returns the digest of the complete file once isFinished(), if enableHash() was called.
+ * @return The digest, or an empty QByteArray if it isn't available.
+ */
+QByteArray FileWriteBehind::digest() const
+{
+    QMutexLocker locker{&state->mutex};
+    return state->digest;
+}
+
+/**
+ * @brief Reads the CHECKSUM_WINDOW bytes before offset, or less at the start of the file.
+ * @return The data, or an empty QByteArray if the file is shorter than offset.
+ */
+QByteArray FileWriteBehind::readTail(QFile& file, quint64 offset)
+{
+    if (static_cast<quint64>(file.size()) < offset) {
+        return {};
+    }
+
+    const quint64 window = CHECKSUM_WINDOW;
+    const quint64 start = offset > window ? offset - window : 0;
+    if (!file.seek(start)) {
+        return {};
+    }
+
+    return file.read(offset - start);
+}
+
+/**
+ * @brief Checksum of the data returned by readTail().
+ */
+QByteArray FileWriteBehind::checksum(const QByteArray& tail)
+{
+    return QCryptographicHash::hash(tail, QCryptographicHash::Sha256);
+}
+
+/**
+ * @brief Starts a FlushTask unless one is running already.
+ * @note The state mutex must be held.
+ */
+void FileWriteBehind::scheduleFlush()
+{
+    if (state->flushing) {
+        return;
+    }
+
+    state->flushing = true;
+    FileIoPool::instance()->start(new FlushTask(state));
+}
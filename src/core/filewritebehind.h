@@ -0,0 +1,75 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FILEWRITEBEHIND_H
+#define FILEWRITEBEHIND_H
+
+#include <QByteArray>
+#include <QtGlobal>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+class QFile;
+
+class FileWriteBehind
+{
+public:
+    struct Checkpoint
+    {
+        quint64 offset;
+        QByteArray checksum;
+    };
+
+    explicit FileWriteBehind(std::shared_ptr<QFile> file, quint64 offset = 0,
+                             const QByteArray& tail = {});
+    ~FileWriteBehind();
+    FileWriteBehind(const FileWriteBehind&) = delete;
+    FileWriteBehind& operator=(const FileWriteBehind&) = delete;
+
+    bool write(const uint8_t* data, size_t length);
+    qint64 pending() const;
+    void close();
+    bool isFinished() const;
+    bool hasFailed() const;
+    Checkpoint checkpoint() const;
+    bool enableHash();
+    QByteArray digest() const;
+
+    static QByteArray readTail(QFile& file, quint64 offset);
+    static QByteArray checksum(const QByteArray& tail);
+    static qint64 totalPending();
+
+public:
+    static constexpr qint64 HIGH_WATERMARK = 4 * 1024 * 1024;
+    static constexpr qint64 LOW_WATERMARK = 1024 * 1024;
+    static constexpr int CHECKSUM_WINDOW = 64 * 1024;
+
+private:
+    struct State;
+    class FlushTask;
+
+    void scheduleFlush();
+
+private:
+    std::shared_ptr<State> state;
+};
+
+#endif // FILEWRITEBEHIND_H
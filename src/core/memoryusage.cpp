@@ -0,0 +1,187 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "memoryusage.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QIcon>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QMutex>
+
+/**
+ * @class MemoryUsage
+ * @brief Collects how much memory the caches and buffers of qTox hold.
+ *
+ * Every object holding memory worth knowing about registers a Source with addSource() when it's
+ * created and removes it again with removeSource() before it's destroyed. collect() asks all
+ * registered sources, so the numbers are only computed when someone looks at them.
+ *
+ * The byte counts are estimates of the payload, i.e. the text, pixels or file data, not of the
+ * allocator overhead around them.
+ *
+ * @note Sources are called on the thread calling collect(), which is the GUI thread, and must
+ * not add or remove sources themselves.
+ *
+ * @struct MemoryUsage::Entry
+ * @brief What a single source holds.
+ *
+ * @var QString MemoryUsage::Entry::subsystem
+ * @brief Part of qTox holding the memory, e.g. "chatlog".
+ *
+ * @var QString MemoryUsage::Entry::name
+ * @brief Instance within the subsystem, e.g. the chat the chat log belongs to.
+ *
+ * @var qint64 MemoryUsage::Entry::count
+ * @brief Number of items held, like lines or cached icons.
+ *
+ * @var qint64 MemoryUsage::Entry::bytes
+ * @brief Estimated size of the items.
+ */
+
+namespace {
+struct Registry
+{
+    QMutex mutex;
+    QMap<int, MemoryUsage::Source> sources;
+    int nextId = 0;
+};
+
+Registry& registry()
+{
+    static Registry registry;
+    return registry;
+}
+} // namespace
+
+/**
+ * @brief Registers a source of memory usage.
+ * @return ID to pass to removeSource().
+ */
+int MemoryUsage::addSource(const Source& source)
+{
+    Registry& reg = registry();
+    QMutexLocker locker{&reg.mutex};
+    const int id = reg.nextId++;
+    reg.sources.insert(id, source);
+    return id;
+}
+
+/**
+ * @brief Unregisters a source, it isn't called anymore afterwards.
+ */
+void MemoryUsage::removeSource(int id)
+{
+    Registry& reg = registry();
+    QMutexLocker locker{&reg.mutex};
+    reg.sources.remove(id);
+}
+
+/**
+ * @brief Asks all sources what they hold, in the order they were registered.
+ */
+QVector<MemoryUsage::Entry> MemoryUsage::collect()
+{
+    Registry& reg = registry();
+    QMutexLocker locker{&reg.mutex};
+    QVector<Entry> entries;
+    entries.reserve(reg.sources.size());
+    for (const Source& source : reg.sources) {
+        entries.append(source());
+    }
+
+    return entries;
+}
+
+/**
+ * @brief Formats entries as JSON, together with the totals per subsystem.
+ */
+QByteArray MemoryUsage::toJson(const QVector<Entry>& entries)
+{
+    QJsonArray list;
+    QMap<QString, qint64> subsystems;
+    qint64 total = 0;
+    for (const Entry& entry : entries) {
+        list.append(QJsonObject{{"subsystem", entry.subsystem},
+                                {"name", entry.name},
+                                {"count", entry.count},
+                                {"bytes", entry.bytes}});
+        subsystems[entry.subsystem] += entry.bytes;
+        total += entry.bytes;
+    }
+
+    QJsonObject totals;
+    for (auto it = subsystems.constBegin(); it != subsystems.constEnd(); ++it) {
+        totals.insert(it.key(), it.value());
+    }
+
+    return QJsonDocument{
+        QJsonObject{{"time", QDateTime::currentDateTimeUtc().toString(Qt::ISODate)},
+                    {"totalBytes", total},
+                    {"subsystems", totals},
+                    {"entries", list}}}
+        .toJson();
+}
+
+/**
+ * @brief Collects the memory usage and writes it as JSON.
+ * @param path File to write to, it's replaced if it exists.
+ * @return False if the file couldn't be written.
+ */
+bool MemoryUsage::writeJson(const QString& path)
+{
+    const QByteArray json = toJson(collect());
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QFile file{path};
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(json) != json.size()) {
+        qWarning() << "Failed to write the memory usage to" << path << file.errorString();
+        return false;
+    }
+
+    qDebug() << "Wrote the memory usage to" << path;
+    return true;
+}
+
+/**
+ * @brief Estimates the memory held by an icon loaded from a file.
+ *
+ * Icons from raster images keep their pixmaps, scalable icons keep the file data and render
+ * it on demand.
+ */
+qint64 MemoryUsage::estimateIcon(const QIcon& icon, const QString& file)
+{
+    const QList<QSize> sizes = icon.availableSizes();
+    if (sizes.isEmpty()) {
+        return QFileInfo(file).size();
+    }
+
+    qint64 bytes = 0;
+    for (const QSize& size : sizes) {
+        // 32 bit per pixel
+        bytes += static_cast<qint64>(size.width()) * size.height() * 4;
+    }
+
+    return bytes;
+}
@@ -0,0 +1,56 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MEMORYUSAGE_H
+#define MEMORYUSAGE_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+#include <functional>
+
+class QIcon;
+
+class MemoryUsage
+{
+public:
+    struct Entry
+    {
+        QString subsystem;
+        QString name;
+        qint64 count;
+        qint64 bytes;
+    };
+
+    using Source = std::function<Entry()>;
+
+    MemoryUsage() = delete;
+
+    static int addSource(const Source& source);
+    static void removeSource(int id);
+
+    static QVector<Entry> collect();
+    static QByteArray toJson(const QVector<Entry>& entries);
+    static bool writeJson(const QString& path);
+
+    static qint64 estimateIcon(const QIcon& icon, const QString& file);
+};
+
+#endif // MEMORYUSAGE_H
@@ -0,0 +1,107 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+/**
+ * @brief Bounded, lock-free single producer / single consumer ring buffer.
+ *
+ * Slots are preallocated and reused, the producer fills a slot in place with writeSlot() and
+ * publishes it with push(), the consumer reads it with front() and releases it with pop().
+ * Neither side ever blocks, a full or empty queue is reported by a nullptr slot.
+ *
+ * @note Exactly one thread may produce and exactly one thread may consume at any time.
+ * @tparam T Slot type, must be default constructible.
+ * @tparam Capacity Number of slots, must be a power of two.
+ */
+template <typename T, size_t Capacity>
+class SpscQueue
+{
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                  "SpscQueue capacity must be a power of two");
+
+public:
+    SpscQueue() = default;
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    /**
+     * @brief Returns the next free slot to fill, or nullptr if the queue is full.
+     * @note Producer side only.
+     */
+    T* writeSlot()
+    {
+        const size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == Capacity) {
+            return nullptr;
+        }
+        return &slots[h & (Capacity - 1)];
+    }
+
+    /**
+     * @brief Publishes the slot returned by writeSlot() to the consumer.
+     * @note Producer side only.
+     */
+    void push()
+    {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Returns the oldest published slot, or nullptr if the queue is empty.
+     * @note Consumer side only.
+     */
+    T* front()
+    {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &slots[t & (Capacity - 1)];
+    }
+
+    /**
+     * @brief Hands the slot returned by front() back to the producer.
+     * @note Consumer side only.
+     */
+    void pop()
+    {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Checks if there is anything left for the consumer, safe to call from both sides.
+     */
+    bool isEmpty() const
+    {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+private:
+    std::array<T, Capacity> slots;
+    std::atomic<size_t> head{0};
+    std::atomic<size_t> tail{0};
+};
+
+#endif // SPSCQUEUE_H
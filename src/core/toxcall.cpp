@@ -1,5 +1,6 @@
 #include "src/core/toxcall.h"
 #include "src/audio/audio.h"
+#include "src/audio/audiomixer.h"
 #include "src/core/coreav.h"
 #include "src/persistence/settings.h"
 #include "src/video/camerasource.h"
@@ -24,8 +25,20 @@
  * @var TOXAV_FRIEND_CALL_STATE ToxFriendCall::state
  * @brief State of the peer (not ours!)
  *
- * @var QMap ToxGroupCall::peers
- * @brief Keeps sources for users in group calls.
+ * @var ToxGroupCall::alSource
+ * @brief Single audio source playing the mixed audio of all peers of the group call.
+ *
+ * @var ToxGroupCall::mixer
+ * @brief Mixes the audio of the peers in software before it is handed to OpenAL.
+ *
+ * @var ToxFriendCall::audioQueue
+ * @brief Audio frames the capture thread couldn't hand to toxav because it was busy iterating.
+ *
+ * @var ToxFriendCall::videoQueue
+ * @brief Video frames the camera thread couldn't hand to toxav because it was busy iterating.
+ *
+ * Both queues are drained by the CoreAV thread right after toxav_iterate, they are heap allocated
+ * so their address stays stable when the call is moved.
  */
 
 ToxCall::ToxCall(bool VideoEnabled, CoreAV& av)
@@ -164,8 +177,20 @@ void ToxFriendCall::setAlSource(const quint32& value)
     alSource = value;
 }
 
+OutboundAudioQueue& ToxFriendCall::getAudioQueue()
+{
+    return *audioQueue;
+}
+
+OutboundVideoQueue& ToxFriendCall::getVideoQueue()
+{
+    return *videoQueue;
+}
+
 ToxFriendCall::ToxFriendCall(uint32_t FriendNum, bool VideoEnabled, CoreAV& av)
     : ToxCall(VideoEnabled, av)
+    , audioQueue{new OutboundAudioQueue}
+    , videoQueue{new OutboundVideoQueue}
 {
     // register audio
     Audio& audio = Audio::getInstance();
@@ -204,6 +229,8 @@ ToxFriendCall::ToxFriendCall(uint32_t FriendNum, bool VideoEnabled, CoreAV& av)
 ToxFriendCall::ToxFriendCall(ToxFriendCall &&other) noexcept
     : ToxCall(std::move(other))
     , alSource{other.alSource}
+    , audioQueue{std::move(other.audioQueue)}
+    , videoQueue{std::move(other.videoQueue)}
 {
     other.alSource = 0;
 }
@@ -213,6 +240,8 @@ ToxFriendCall& ToxFriendCall::operator=(ToxFriendCall &&other) noexcept
     ToxCall::operator=(std::move(other));
     alSource = other.alSource;
     other.alSource = 0;
+    audioQueue = std::move(other.audioQueue);
+    videoQueue = std::move(other.videoQueue);
 
     return *this;
 }
@@ -258,6 +287,7 @@ void ToxFriendCall::setState(const TOXAV_FRIEND_CALL_STATE& value)
 
 ToxGroupCall::ToxGroupCall(int GroupNum, CoreAV& av)
     : ToxCall(false, av)
+    , mixer{new AudioMixer}
 {
     // register audio
     Audio& audio = Audio::getInstance();
@@ -274,74 +304,78 @@ ToxGroupCall::ToxGroupCall(int GroupNum, CoreAV& av)
 }
 
 ToxGroupCall::ToxGroupCall(ToxGroupCall&& other) noexcept
-    : ToxCall(std::move(other)), peers{other.peers}
+    : ToxCall(std::move(other))
+    , alSource{other.alSource}
+    , mixer{std::move(other.mixer)}
 {
-    // all peers were moved, this ensures audio output is unsubscribed only once
-    other.peers.clear();
+    // the source was moved, this ensures audio output is unsubscribed only once
+    other.alSource = 0;
 }
 
 ToxGroupCall::~ToxGroupCall()
 {
-    Audio& audio = Audio::getInstance();
-
-    for (quint32 v : peers) {
-        audio.unsubscribeOutput(v);
+    if (alSource) {
+        Audio::getInstance().unsubscribeOutput(alSource);
     }
 }
 
 ToxGroupCall& ToxGroupCall::operator=(ToxGroupCall&& other) noexcept
 {
     ToxCall::operator=(std::move(other));
-    peers = other.peers;
-    other.peers.clear();
+    alSource = other.alSource;
+    other.alSource = 0;
+    mixer = std::move(other.mixer);
 
     return *this;
 }
 
 void ToxGroupCall::removePeer(int peerId)
 {
-    auto& audio = Audio::getInstance();
-    const auto& sourceId = peers.find(peerId);
-    if(sourceId == peers.constEnd()) {
-        qDebug() << "Peer:" << peerId << "does not have a source, can't remove";
-        return;
-    }
-
-    audio.unsubscribeOutput(sourceId.value());
-    peers.remove(peerId);
+    mixer->removePeer(peerId);
 }
 
-void ToxGroupCall::addPeer(int peerId)
+/**
+ * @brief Forgets all peers and releases the audio source, e.g. after the output device changed.
+ */
+void ToxGroupCall::clearPeers()
 {
-    auto& audio = Audio::getInstance();
-    uint sourceId = 0;
-    audio.subscribeOutput(sourceId);
-    peers.insert(peerId, sourceId);
+    mixer->clear();
+
+    if (alSource) {
+        Audio::getInstance().unsubscribeOutput(alSource);
+    }
 }
 
-bool ToxGroupCall::havePeer(int peerId)
+/**
+ * @brief Sets the linear gain applied to a peer's audio.
+ * @param peerId Peer number in the group.
+ * @param gain Linear gain, 1 leaves the audio unchanged.
+ */
+void ToxGroupCall::setPeerGain(int peerId, qreal gain)
 {
-    const auto& sourceId = peers.find(peerId);
-    return sourceId != peers.constEnd();
+    mixer->setPeerGain(peerId, gain);
 }
 
-void ToxGroupCall::clearPeers()
+/**
+ * @brief Feeds a peer's audio to the mixer and plays all frames that became ready.
+ * @param peerId Peer number in the group.
+ * @param data Interleaved samples.
+ * @param samples Number of samples per channel.
+ * @param channels Number of channels.
+ * @param rate Sample rate.
+ */
+void ToxGroupCall::playPeerAudio(int peerId, const int16_t* data, unsigned samples,
+                                 uint8_t channels, uint32_t rate)
 {
-    Audio& audio = Audio::getInstance();
-
-    for (quint32 v : peers) {
-        audio.unsubscribeOutput(v);
-    }
+    mixer->addPeerFrame(peerId, data, samples, channels, rate);
 
-    peers.clear();
-}
+    Audio& audio = Audio::getInstance();
+    while (mixer->mixFrame()) {
+        if (!alSource) {
+            audio.subscribeOutput(alSource);
+        }
 
-quint32 ToxGroupCall::getAlSource(int peer)
-{
-    if(!havePeer(peer)) {
-        qWarning() << "Getting alSource for non-existant peer";
-        return 0;
+        audio.playAudioBuffer(alSource, mixer->frameData(), mixer->frameSamples(),
+                              mixer->frameChannels(), mixer->frameRate());
     }
-
-    return peers[peer];
 }
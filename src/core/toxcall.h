@@ -1,18 +1,39 @@
 #ifndef TOXCALL_H
 #define TOXCALL_H
 
+#include "src/core/spscqueue.h"
+
 #include <memory>
 #include <QMap>
 #include <QMetaObject>
 #include <QtGlobal>
 #include <cstdint>
+#include <vector>
 
 #include <tox/toxav.h>
 
 class QTimer;
 class AudioFilterer;
+class AudioMixer;
 class CoreVideoSource;
 class CoreAV;
+class VideoFrame;
+
+struct OutboundAudioFrame
+{
+    std::vector<int16_t> pcm;
+    size_t samples{0};
+    uint8_t chans{0};
+    uint32_t rate{0};
+};
+
+struct OutboundVideoFrame
+{
+    std::shared_ptr<VideoFrame> frame;
+};
+
+using OutboundAudioQueue = SpscQueue<OutboundAudioFrame, 16>;
+using OutboundVideoQueue = SpscQueue<OutboundVideoFrame, 4>;
 
 class ToxCall
 {
@@ -77,6 +98,9 @@ public:
     quint32 getAlSource() const;
     void setAlSource(const quint32& value);
 
+    OutboundAudioQueue& getAudioQueue();
+    OutboundVideoQueue& getVideoQueue();
+
 protected:
     std::unique_ptr<QTimer> timeoutTimer;
 
@@ -84,6 +108,8 @@ private:
     TOXAV_FRIEND_CALL_STATE state{TOXAV_FRIEND_CALL_STATE_NONE};
     static constexpr int CALL_TIMEOUT = 45000;
     quint32 alSource{0};
+    std::unique_ptr<OutboundAudioQueue> audioQueue;
+    std::unique_ptr<OutboundVideoQueue> videoQueue;
 };
 
 class ToxGroupCall : public ToxCall
@@ -97,14 +123,15 @@ public:
     ToxGroupCall& operator=(ToxGroupCall&& other) noexcept;
 
     void removePeer(int peerId);
-    void addPeer(int peerId);
-    bool havePeer(int peerId);
     void clearPeers();
+    void setPeerGain(int peerId, qreal gain);
 
-    quint32 getAlSource(int peer);
+    void playPeerAudio(int peerId, const int16_t* data, unsigned samples, uint8_t channels,
+                       uint32_t rate);
 
 private:
-    QMap<int, quint32> peers;
+    quint32 alSource{0};
+    std::unique_ptr<AudioMixer> mixer;
 
     // If you add something here, don't forget to override the ctors and move operators!
 };
@@ -13,6 +13,27 @@
  *
  * @var uint8_t ToxFile::fileKind
  * @brief Data file (default) or avatar
+ *
+ * @var std::shared_ptr<FileReadAhead> ToxFile::readAhead
+ * @brief Buffers the file of an outgoing data transfer, the core thread never reads it itself
+ *
+ * @var std::shared_ptr<FileWriteBehind> ToxFile::writeBehind
+ * @brief Buffers the file of an accepted incoming data transfer, it owns the file once set
+ *
+ * @var quint64 ToxFile::bytesReported
+ * @brief Value of bytesSent in the last progress snapshot published for this transfer
+ *
+ * @var quint64 ToxFile::bytesStored
+ * @brief Offset of an incoming transfer last recorded in the transfer store
+ *
+ * @var QByteArray ToxFile::hash
+ * @brief BLAKE2b digest of a received file, computed while it was written
+ *
+ * Set once the transfer finished. Empty for sent files and for transfers continued after a
+ * restart, since the data written before isn't hashed again.
+ *
+ * @struct ToxFileProgress
+ * @brief Progress snapshot of a running transfer, cheap to pass across threads
  */
 
 /**
@@ -30,6 +51,8 @@ ToxFile::ToxFile(uint32_t fileNum, uint32_t friendId, QByteArray filename, QStri
     , filesize{0}
     , status{STOPPED}
     , direction{Direction}
+    , bytesReported{0}
+    , bytesStored{0}
 {
 }
 
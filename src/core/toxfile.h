@@ -4,6 +4,8 @@
 #include <QString>
 #include <memory>
 
+class FileReadAhead;
+class FileWriteBehind;
 class QFile;
 class QTimer;
 
@@ -42,12 +44,26 @@ struct ToxFile
     QByteArray fileName;
     QString filePath;
     std::shared_ptr<QFile> file;
+    std::shared_ptr<FileReadAhead> readAhead;
+    std::shared_ptr<FileWriteBehind> writeBehind;
     quint64 bytesSent;
     quint64 filesize;
     FileStatus status;
     FileDirection direction;
     QByteArray avatarData;
     QByteArray resumeFileId;
+    quint64 bytesReported;
+    quint64 bytesStored;
+    QByteArray hash;
+};
+
+struct ToxFileProgress
+{
+    uint32_t friendId;
+    uint32_t fileNum;
+    ToxFile::FileDirection direction;
+    quint64 bytesSent;
+    quint64 filesize;
 };
 
 #endif // CORESTRUCTS_H
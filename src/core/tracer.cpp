@@ -0,0 +1,191 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tracer.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QThread>
+#include <QVector>
+
+/**
+ * @class Tracer
+ * @brief Records how long the phases of the startup take, on which thread.
+ *
+ * Code to measure creates a Tracer::Span on the stack, which records the time until it goes out
+ * of scope. Unless start() was called, a Span only checks an atomic flag, so spans can stay in
+ * code that runs often.
+ *
+ * finish() writes everything recorded as Chrome trace JSON, which can be opened in
+ * chrome://tracing or https://ui.perfetto.dev.
+ *
+ * @class Tracer::Span
+ * @brief Records the time from its construction to its destruction while tracing is enabled.
+ *
+ * The name must be a string literal, it's only converted when the trace is written.
+ */
+
+std::atomic<bool> Tracer::enabled{false};
+
+namespace {
+struct Event
+{
+    const char* name;
+    qint64 start;
+    qint64 end;
+    int thread;
+};
+
+struct TraceState
+{
+    QMutex mutex;
+    QElapsedTimer timer;
+    QVector<Event> events;
+    QHash<Qt::HANDLE, int> threadIds;
+    QVector<QString> threadNames;
+};
+
+TraceState& state()
+{
+    static TraceState state;
+    return state;
+}
+
+/**
+ * @brief Returns a small number identifying the current thread in the trace.
+ * @note The state mutex must be held.
+ */
+int currentThread(TraceState& trace)
+{
+    const Qt::HANDLE handle = QThread::currentThreadId();
+    auto it = trace.threadIds.constFind(handle);
+    if (it != trace.threadIds.constEnd()) {
+        return *it;
+    }
+
+    const int id = trace.threadNames.size();
+    QString name = QThread::currentThread()->objectName();
+    if (name.isEmpty()) {
+        name = id == 0 ? QStringLiteral("main") : QStringLiteral("Thread %1").arg(id);
+    }
+
+    trace.threadIds.insert(handle, id);
+    trace.threadNames.append(name);
+    return id;
+}
+} // namespace
+
+/**
+ * @brief Starts recording spans, the trace starts at 0 now.
+ * @note Must be called from the main thread.
+ */
+void Tracer::start()
+{
+    TraceState& trace = state();
+    QMutexLocker locker{&trace.mutex};
+    trace.events.clear();
+    trace.threadIds.clear();
+    trace.threadNames.clear();
+    currentThread(trace);
+    trace.timer.start();
+    enabled.store(true);
+}
+
+/**
+ * @brief Stops recording spans and writes the trace.
+ * @param path File to write the Chrome trace JSON to.
+ * @return False if tracing wasn't enabled or the file couldn't be written.
+ */
+bool Tracer::finish(const QString& path)
+{
+    if (!enabled.exchange(false)) {
+        return false;
+    }
+
+    const qint64 pid = QCoreApplication::applicationPid();
+    QJsonArray events;
+    {
+        TraceState& trace = state();
+        QMutexLocker locker{&trace.mutex};
+        for (int i = 0; i < trace.threadNames.size(); ++i) {
+            events.append(QJsonObject{{"name", "thread_name"},
+                                      {"ph", "M"},
+                                      {"pid", pid},
+                                      {"tid", i},
+                                      {"args", QJsonObject{{"name", trace.threadNames[i]}}}});
+        }
+
+        for (const Event& event : trace.events) {
+            // Chrome traces count in microseconds
+            events.append(QJsonObject{{"name", QString::fromUtf8(event.name)},
+                                      {"cat", "startup"},
+                                      {"ph", "X"},
+                                      {"ts", event.start / 1000.0},
+                                      {"dur", (event.end - event.start) / 1000.0},
+                                      {"pid", pid},
+                                      {"tid", event.thread}});
+        }
+
+        trace.events.clear();
+        trace.events.squeeze();
+    }
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QFile file{path};
+    const QByteArray json =
+        QJsonDocument{QJsonObject{{"traceEvents", events}, {"displayTimeUnit", "ms"}}}.toJson(
+            QJsonDocument::Compact);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(json) != json.size()) {
+        qWarning() << "Failed to write the startup trace to" << path << file.errorString();
+        return false;
+    }
+
+    qDebug() << "Wrote the startup trace to" << path;
+    return true;
+}
+
+/**
+ * @brief Returns the time since start() in nanoseconds.
+ */
+qint64 Tracer::now()
+{
+    return state().timer.nsecsElapsed();
+}
+
+void Tracer::record(const char* name, qint64 start)
+{
+    TraceState& trace = state();
+    const qint64 end = trace.timer.nsecsElapsed();
+    QMutexLocker locker{&trace.mutex};
+    // spans ending after finish() aren't part of the trace anymore
+    if (!isEnabled()) {
+        return;
+    }
+
+    trace.events.append(Event{name, start, end, currentThread(trace)});
+}
@@ -0,0 +1,74 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QtGlobal>
+
+#include <atomic>
+
+class QString;
+
+class Tracer
+{
+public:
+    class Span
+    {
+    public:
+        explicit Span(const char* name)
+            : name{Tracer::isEnabled() ? name : nullptr}
+            , start{this->name ? Tracer::now() : 0}
+        {
+        }
+
+        ~Span()
+        {
+            if (name) {
+                Tracer::record(name, start);
+            }
+        }
+
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+
+    private:
+        const char* name;
+        qint64 start;
+    };
+
+    Tracer() = delete;
+
+    static void start();
+    static bool finish(const QString& path);
+
+    static bool isEnabled()
+    {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+private:
+    static qint64 now();
+    static void record(const char* name, qint64 start);
+
+private:
+    static std::atomic<bool> enabled;
+};
+
+#endif // TRACER_H
@@ -0,0 +1,168 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "transferregistry.h"
+
+/**
+ * @class TransferRegistry
+ * @brief Holds the running file transfers, looked up by friend ID and file number.
+ *
+ * Threading model: the registry itself is safe to use from any thread. It is split into
+ * SHARD_COUNT shards by friend ID, each with its own mutex, which is only held for the map
+ * access itself. The ToxFile behind a Handle is not protected by the registry, it's only read
+ * and modified on the core thread, with Core's loop lock held.
+ *
+ * Other threads use progress(), which returns the snapshot last passed to publish() instead of
+ * touching the ToxFile.
+ *
+ * Handles stay valid after the transfer was removed from the registry, so a transfer can still
+ * be used after removing it, e.g. to emit a last signal.
+ *
+ * @var TransferRegistry::SHARD_COUNT
+ * @brief Number of independently locked parts of the registry.
+ */
+
+constexpr int TransferRegistry::SHARD_COUNT;
+
+namespace {
+ToxFileProgress makeProgress(const ToxFile& file)
+{
+    return {file.friendId, file.fileNum, file.direction, file.bytesSent, file.filesize};
+}
+} // namespace
+
+/**
+ * @brief Looks up a transfer.
+ * @return The transfer, or nullptr if there's none with these IDs.
+ */
+TransferRegistry::Handle TransferRegistry::find(uint32_t friendId, uint32_t fileNum) const
+{
+    const Shard& shard = shardOf(friendId);
+    QMutexLocker locker{&shard.mutex};
+    auto it = shard.entries.constFind(makeKey(friendId, fileNum));
+    return it == shard.entries.constEnd() ? nullptr : it->file;
+}
+
+/**
+ * @brief Looks up a transfer by the key returned by makeKey().
+ * @return The transfer, or nullptr if there's none with this key.
+ */
+TransferRegistry::Handle TransferRegistry::find(uint64_t key) const
+{
+    return find(static_cast<uint32_t>(key >> 32), static_cast<uint32_t>(key));
+}
+
+/**
+ * @brief Adds a copy of a transfer, replacing a transfer with the same IDs.
+ * @return The added transfer.
+ */
+TransferRegistry::Handle TransferRegistry::insert(const ToxFile& file)
+{
+    Entry entry{std::make_shared<ToxFile>(file), makeProgress(file)};
+    Shard& shard = shardOf(file.friendId);
+    QMutexLocker locker{&shard.mutex};
+    shard.entries.insert(makeKey(file.friendId, file.fileNum), entry);
+    return entry.file;
+}
+
+/**
+ * @brief Removes a transfer.
+ * @return The removed transfer, or nullptr if there's none with these IDs.
+ */
+TransferRegistry::Handle TransferRegistry::take(uint32_t friendId, uint32_t fileNum)
+{
+    Shard& shard = shardOf(friendId);
+    QMutexLocker locker{&shard.mutex};
+    return shard.entries.take(makeKey(friendId, fileNum)).file;
+}
+
+/**
+ * @brief Returns all transfers, changing the registry afterwards doesn't affect the result.
+ */
+QVector<TransferRegistry::Handle> TransferRegistry::files() const
+{
+    QVector<Handle> result;
+    for (const Shard& shard : shards) {
+        QMutexLocker locker{&shard.mutex};
+        for (const Entry& entry : shard.entries) {
+            result.append(entry.file);
+        }
+    }
+
+    return result;
+}
+
+/**
+ * @brief Returns the transfers with one friend, changing the registry afterwards doesn't affect
+ * the result.
+ */
+QVector<TransferRegistry::Handle> TransferRegistry::filesOf(uint32_t friendId) const
+{
+    QVector<Handle> result;
+    const Shard& shard = shardOf(friendId);
+    QMutexLocker locker{&shard.mutex};
+    for (const Entry& entry : shard.entries) {
+        if (entry.file->friendId == friendId) {
+            result.append(entry.file);
+        }
+    }
+
+    return result;
+}
+
+/**
+ * @brief Updates the progress snapshot of a transfer that other threads can query.
+ */
+void TransferRegistry::publish(const ToxFile& file)
+{
+    Shard& shard = shardOf(file.friendId);
+    QMutexLocker locker{&shard.mutex};
+    auto it = shard.entries.find(makeKey(file.friendId, file.fileNum));
+    if (it != shard.entries.end()) {
+        it->progress = makeProgress(file);
+    }
+}
+
+/**
+ * @brief Returns the progress snapshot of a transfer, can be used from any thread.
+ * @return False if there's no transfer with these IDs.
+ */
+bool TransferRegistry::progress(uint32_t friendId, uint32_t fileNum,
+                                ToxFileProgress& progress) const
+{
+    const Shard& shard = shardOf(friendId);
+    QMutexLocker locker{&shard.mutex};
+    auto it = shard.entries.constFind(makeKey(friendId, fileNum));
+    if (it == shard.entries.constEnd()) {
+        return false;
+    }
+
+    progress = it->progress;
+    return true;
+}
+
+TransferRegistry::Shard& TransferRegistry::shardOf(uint32_t friendId)
+{
+    return shards[friendId % SHARD_COUNT];
+}
+
+const TransferRegistry::Shard& TransferRegistry::shardOf(uint32_t friendId) const
+{
+    return shards[friendId % SHARD_COUNT];
+}
@@ -0,0 +1,80 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TRANSFERREGISTRY_H
+#define TRANSFERREGISTRY_H
+
+#include "toxfile.h"
+
+#include <QHash>
+#include <QMutex>
+#include <QVector>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+
+class TransferRegistry
+{
+public:
+    using Handle = std::shared_ptr<ToxFile>;
+
+    TransferRegistry() = default;
+    TransferRegistry(const TransferRegistry&) = delete;
+    TransferRegistry& operator=(const TransferRegistry&) = delete;
+
+    Handle find(uint32_t friendId, uint32_t fileNum) const;
+    Handle find(uint64_t key) const;
+    Handle insert(const ToxFile& file);
+    Handle take(uint32_t friendId, uint32_t fileNum);
+    QVector<Handle> files() const;
+    QVector<Handle> filesOf(uint32_t friendId) const;
+
+    void publish(const ToxFile& file);
+    bool progress(uint32_t friendId, uint32_t fileNum, ToxFileProgress& progress) const;
+
+    static constexpr uint64_t makeKey(uint32_t friendId, uint32_t fileNum)
+    {
+        return (static_cast<uint64_t>(friendId) << 32) + fileNum;
+    }
+
+public:
+    static constexpr int SHARD_COUNT = 16;
+
+private:
+    struct Entry
+    {
+        Handle file;
+        ToxFileProgress progress;
+    };
+
+    struct Shard
+    {
+        mutable QMutex mutex;
+        QHash<uint64_t, Entry> entries;
+    };
+
+    Shard& shardOf(uint32_t friendId);
+    const Shard& shardOf(uint32_t friendId) const;
+
+private:
+    std::array<Shard, SHARD_COUNT> shards;
+};
+
+#endif // TRANSFERREGISTRY_H
@@ -0,0 +1,91 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "transferscheduler.h"
+
+#include <algorithm>
+
+/**
+ * @class TransferScheduler
+ * @brief Decides how long the core loop may sleep while files are transferred.
+ *
+ * Chunks are only exchanged while toxcore iterates, so the sleep between iterations limits the
+ * throughput. As long as every iteration moves data, the interval is halved down to
+ * MIN_INTERVAL. Once an iteration moves nothing, because the friend paused or the connection is
+ * congested, it is doubled up to MAX_INTERVAL.
+ *
+ * @var TransferScheduler::MIN_INTERVAL
+ * @brief Shortest sleep in ms, used while transfers keep up with the loop.
+ *
+ * @var TransferScheduler::START_INTERVAL
+ * @brief Sleep in ms when a transfer starts.
+ *
+ * @var TransferScheduler::MAX_INTERVAL
+ * @brief Longest sleep in ms while transfers are running but stalled.
+ *
+ * @var TransferScheduler::IDLE_INTERVAL
+ * @brief Sleep in ms without running transfers.
+ */
+
+constexpr unsigned TransferScheduler::MIN_INTERVAL;
+constexpr unsigned TransferScheduler::START_INTERVAL;
+constexpr unsigned TransferScheduler::MAX_INTERVAL;
+constexpr unsigned TransferScheduler::IDLE_INTERVAL;
+
+/**
+ * @brief Counts bytes sent or received during the current iteration.
+ */
+void TransferScheduler::addBytes(quint64 bytes)
+{
+    this->bytes += bytes;
+}
+
+/**
+ * @brief Adapts the interval to the bytes moved since the last call, must be called once per
+ * iteration.
+ * @param active True if any transfer is running.
+ * @param waiting True if chunks are waiting for the disk, the interval is kept as it is then.
+ * @return Time in ms until the next iteration.
+ */
+unsigned TransferScheduler::nextInterval(bool active, bool waiting)
+{
+    const bool moved = bytes != 0;
+    bytes = 0;
+
+    if (!active) {
+        interval = START_INTERVAL;
+        return IDLE_INTERVAL;
+    }
+
+    if (moved) {
+        interval = std::max(MIN_INTERVAL, interval / 2);
+    } else if (!waiting) {
+        interval = std::min(MAX_INTERVAL, interval * 2);
+    }
+
+    return interval;
+}
+
+/**
+ * @brief Returns the interval last returned for running transfers.
+ */
+unsigned TransferScheduler::currentInterval() const
+{
+    return interval;
+}
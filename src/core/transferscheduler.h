@@ -0,0 +1,43 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TRANSFERSCHEDULER_H
+#define TRANSFERSCHEDULER_H
+
+#include <QtGlobal>
+
+class TransferScheduler
+{
+public:
+    void addBytes(quint64 bytes);
+    unsigned nextInterval(bool active, bool waiting);
+    unsigned currentInterval() const;
+
+public:
+    static constexpr unsigned MIN_INTERVAL = 1;
+    static constexpr unsigned START_INTERVAL = 10;
+    static constexpr unsigned MAX_INTERVAL = 50;
+    static constexpr unsigned IDLE_INTERVAL = 1000;
+
+private:
+    unsigned interval = START_INTERVAL;
+    quint64 bytes = 0;
+};
+
+#endif // TRANSFERSCHEDULER_H
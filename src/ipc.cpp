@@ -20,7 +20,9 @@
 #include "src/ipc.h"
 #include <QCoreApplication>
 #include <QDebug>
+#include <QLocalSocket>
 #include <QThread>
+#include <QTimer>
 #include <ctime>
 #include <random>
 #include <unistd.h>
@@ -31,11 +33,19 @@
  *
  * @var time_t IPC::lastProcessed
  * @brief When processEvents() ran last time
+ *
+ * @var uint64_t IPC::instances
+ * @brief Global IDs of the running instances, 0 for unused entries.
  */
 
 /**
  * @class IPC
  * @brief Inter-process communication
+ *
+ * Events are passed in shared memory. Every instance listens on a local socket named after its
+ * global ID, and registers that ID in the shared memory. Posting an event connects to the sockets
+ * of the other instances, which makes them process events right away. Idle instances don't do any
+ * periodic work.
  */
 
 IPC::IPC(uint32_t profileId)
@@ -44,15 +54,10 @@ IPC::IPC(uint32_t profileId)
 {
     qRegisterMetaType<IPCEventHandler>("IPCEventHandler");
 
-    timer.setInterval(EVENT_TIMER_MS);
-    timer.setSingleShot(true);
-    connect(&timer, &QTimer::timeout, this, &IPC::processEvents);
-
     // The first started instance gets to manage the shared memory by taking ownership
-    // Every time it processes events it updates the global shared timestamp "lastProcessed"
-    // If the timestamp isn't updated, that's a timeout and someone else can take ownership
+    // If the owner's socket doesn't accept connections anymore, someone else can take ownership
     // This is a safety measure, in case one of the clients crashes
-    // If the owner exits normally, it can set the timestamp to 0 first to immediately give
+    // If the owner exits normally, it sets the global ID to 0 first to immediately give
     // ownership
 
     std::default_random_engine randEngine((std::random_device())());
@@ -77,14 +82,25 @@ IPC::IPC(uint32_t profileId)
         return; // We won't be able to do any IPC without being attached, let's get outta here
     }
 
+    listen();
     processEvents();
 }
 
 IPC::~IPC()
 {
+    if (!isAttached()) {
+        return;
+    }
+
     if (globalMemory.lock()) {
+        IPCMemory* mem = global();
         if (isCurrentOwnerNoLock()) {
-            global()->globalId = 0;
+            mem->globalId = 0;
+        }
+        for (uint64_t& id : mem->instances) {
+            if (id == globalId) {
+                id = 0;
+            }
         }
         globalMemory.unlock();
     } else {
@@ -114,7 +130,8 @@ time_t IPC::postEvent(const QString& name, const QByteArray& data, uint32_t dest
         time_t result = 0;
 
         for (uint32_t i = 0; !evt && i < EVENT_QUEUE_SIZE; ++i) {
-            if (mem->events[i].posted == 0)
+            // nobody may process events for a while, reuse expired ones
+            if (mem->events[i].posted == 0 || isExpired(mem->events[i]))
                 evt = &mem->events[i];
         }
 
@@ -128,6 +145,9 @@ time_t IPC::postEvent(const QString& name, const QByteArray& data, uint32_t dest
             qDebug() << "postEvent " << name << "to" << dest;
         }
         globalMemory.unlock();
+        if (result) {
+            notifyInstances();
+        }
         return result;
     } else
         qDebug() << "Failed to lock in postEvent()";
@@ -154,6 +174,8 @@ bool IPC::isCurrentOwner()
 void IPC::registerEventHandler(const QString& name, IPCEventHandler handler)
 {
     eventHandlers[name] = handler;
+    // events for it may have arrived already, handle them once the event loop runs
+    QTimer::singleShot(0, this, &IPC::processEvents);
 }
 
 bool IPC::isEventAccepted(time_t time)
@@ -210,11 +232,7 @@ IPC::IPCEvent* IPC::fetchEvent()
     for (uint32_t i = 0; i < EVENT_QUEUE_SIZE; ++i) {
         IPCEvent* evt = &mem->events[i];
 
-        // Garbage-collect events that were not processed in EVENT_GC_TIMEOUT
-        // and events that were processed and EVENT_GC_TIMEOUT passed after
-        // so sending instance has time to react to those events.
-        if ((evt->processed && difftime(time(nullptr), evt->processed) > EVENT_GC_TIMEOUT)
-            || (!evt->processed && difftime(time(nullptr), evt->posted) > EVENT_GC_TIMEOUT))
+        if (isExpired(*evt))
             memset(evt, 0, sizeof(IPCEvent));
 
         if (evt->posted && !evt->processed && evt->sender != getpid()
@@ -225,6 +243,23 @@ IPC::IPCEvent* IPC::fetchEvent()
     return nullptr;
 }
 
+/**
+ * @brief Only called when global memory IS LOCKED.
+ * @return True if there are global events left that only the owner can process.
+ */
+bool IPC::hasGlobalEventsNoLock()
+{
+    const IPCMemory* mem = global();
+    for (const IPCEvent& evt : mem->events) {
+        if (evt.posted && !evt.processed && evt.sender != getpid() && evt.dest == 0
+            && !isExpired(evt)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 bool IPC::runEventHandler(IPCEventHandler handler, const QByteArray& arg)
 {
     bool result = false;
@@ -240,47 +275,173 @@ bool IPC::runEventHandler(IPCEventHandler handler, const QByteArray& arg)
 
 void IPC::processEvents()
 {
-    if (globalMemory.lock()) {
-        IPCMemory* mem = global();
+    if (!globalMemory.lock()) {
+        return;
+    }
 
-        if (mem->globalId == globalId) {
-            // We're the owner, let's process those events
-            mem->lastProcessed = time(nullptr);
-        } else {
-            // Only the owner processes events. But if the previous owner's dead, we can take
-            // ownership now
-            if (difftime(time(nullptr), mem->lastProcessed) >= OWNERSHIP_TIMEOUT_S) {
-                qDebug() << "Previous owner timed out, taking ownership" << mem->globalId << "->"
-                         << globalId;
-                // Ignore events that were not meant for this instance
-                memset(mem, 0, sizeof(IPCMemory));
-                mem->globalId = globalId;
-                mem->lastProcessed = time(nullptr);
-            }
-            // Non-main instance is limited to events destined for specific profile it runs
+    IPCMemory* mem = global();
+    const uint64_t owner = mem->globalId;
+    if (owner != globalId && hasGlobalEventsNoLock()) {
+        // Only the owner processes global events. But if the previous owner's gone, we can take
+        // ownership now, including the global events posted to it. Probing its socket can take
+        // up to NOTIFY_TIMEOUT_MS, so other instances mustn't wait for the lock meanwhile.
+        globalMemory.unlock();
+        const bool ownerRunning = isInstanceRunning(owner);
+        if (!globalMemory.lock()) {
+            return;
+        }
+
+        mem = global();
+        // someone else could have taken ownership while we weren't looking
+        if (!ownerRunning && mem->globalId == owner) {
+            qDebug() << "Previous owner is gone, taking ownership" << owner << "->" << globalId;
+            mem->globalId = globalId;
         }
+    }
 
-        while (IPCEvent* evt = fetchEvent()) {
-            QString name = QString::fromUtf8(evt->name);
-            auto it = eventHandlers.find(name);
-            if (it != eventHandlers.end()) {
-                qDebug() << "Processing event: " << name << ":" << evt->posted << "=" << evt->accepted;
-                evt->accepted = runEventHandler(it.value(), evt->data);
-                if (evt->dest == 0) {
-                    // Global events should be processed only by instance that accepted event.
-                    // Otherwise global
-                    // event would be consumed by very first instance that gets to check it.
-                    if (evt->accepted)
-                        evt->processed = time(nullptr);
-                } else {
+    // Non-main instance is limited to events destined for specific profile it runs
+    while (IPCEvent* evt = fetchEvent()) {
+        QString name = QString::fromUtf8(evt->name);
+        auto it = eventHandlers.find(name);
+        if (it != eventHandlers.end()) {
+            qDebug() << "Processing event: " << name << ":" << evt->posted << "=" << evt->accepted;
+            evt->accepted = runEventHandler(it.value(), evt->data);
+            if (evt->dest == 0) {
+                // Global events should be processed only by instance that accepted event.
+                // Otherwise global
+                // event would be consumed by very first instance that gets to check it.
+                if (evt->accepted)
                     evt->processed = time(nullptr);
-                }
+            } else {
+                evt->processed = time(nullptr);
             }
         }
+    }
 
-        globalMemory.unlock();
+    // isEventAccepted() needs this to be later than the events processed, their posting time
+    // can be ahead of the clock
+    mem->lastProcessed = qMax(time(nullptr), mem->lastEvent + 1);
+    globalMemory.unlock();
+}
+
+void IPC::onNotified()
+{
+    while (QLocalSocket* socket = server.nextPendingConnection()) {
+        socket->deleteLater();
     }
-    timer.start();
+
+    processEvents();
+}
+
+/**
+ * @brief Starts listening for notifications and registers us as running instance.
+ * @return False if other instances won't be able to notify us.
+ */
+bool IPC::listen()
+{
+    const QString name = serverName(globalId);
+    // a crashed instance with the same ID could have left its socket behind
+    QLocalServer::removeServer(name);
+    connect(&server, &QLocalServer::newConnection, this, &IPC::onNotified);
+    if (!server.listen(name)) {
+        qWarning() << "Failed to listen for IPC notifications:" << server.errorString();
+        return false;
+    }
+
+    if (!globalMemory.lock()) {
+        qWarning() << "Failed to lock to register for IPC notifications";
+        return false;
+    }
+
+    bool registered = false;
+    for (uint64_t& id : global()->instances) {
+        if (id == 0) {
+            id = globalId;
+            registered = true;
+            break;
+        }
+    }
+
+    globalMemory.unlock();
+    if (!registered) {
+        qWarning() << "Too many running instances, we won't be notified of IPC events";
+    }
+
+    return registered;
+}
+
+/**
+ * @brief Makes the other instances process the events, forgets instances that are gone.
+ */
+void IPC::notifyInstances()
+{
+    QVector<uint64_t> others;
+    if (!globalMemory.lock()) {
+        qDebug() << "Failed to lock in notifyInstances()";
+        return;
+    }
+
+    for (uint64_t id : global()->instances) {
+        if (id != 0 && id != globalId) {
+            others.append(id);
+        }
+    }
+
+    globalMemory.unlock();
+
+    // connecting is the notification, don't hold the lock the notified instances need
+    QVector<uint64_t> gone;
+    for (uint64_t id : others) {
+        if (!isInstanceRunning(id)) {
+            gone.append(id);
+        }
+    }
+
+    if (gone.isEmpty() || !globalMemory.lock()) {
+        return;
+    }
+
+    for (uint64_t& id : global()->instances) {
+        if (gone.contains(id)) {
+            id = 0;
+        }
+    }
+
+    globalMemory.unlock();
+}
+
+QString IPC::serverName(uint64_t id)
+{
+    return QStringLiteral("qtox-ipc-" IPC_PROTOCOL_VERSION "-%1").arg(id);
+}
+
+/**
+ * @brief Checks if an instance is running by connecting to its socket, which also notifies it.
+ */
+bool IPC::isInstanceRunning(uint64_t id)
+{
+    if (id == 0) {
+        return false;
+    }
+
+    QLocalSocket socket;
+    socket.connectToServer(serverName(id));
+    const bool connected = socket.waitForConnected(NOTIFY_TIMEOUT_MS);
+    socket.abort();
+    return connected;
+}
+
+/**
+ * @brief Checks if an event can be garbage-collected.
+ *
+ * That's the case for events that were not processed in EVENT_GC_TIMEOUT, and for events that
+ * were processed and EVENT_GC_TIMEOUT passed after, so the sending instance had time to react.
+ */
+bool IPC::isExpired(const IPCEvent& evt)
+{
+    return (evt.processed && difftime(time(nullptr), evt.processed) > EVENT_GC_TIMEOUT)
+           || (!evt.processed && evt.posted
+               && difftime(time(nullptr), evt.posted) > EVENT_GC_TIMEOUT);
 }
 
 /**
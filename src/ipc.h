@@ -21,27 +21,27 @@
 #ifndef IPC_H
 #define IPC_H
 
+#include <QLocalServer>
 #include <QMap>
 #include <QObject>
 #include <QSharedMemory>
-#include <QTimer>
 #include <QVector>
 #include <ctime>
 #include <functional>
 
 using IPCEventHandler = std::function<bool(const QByteArray&)>;
 
-#define IPC_PROTOCOL_VERSION "2"
+#define IPC_PROTOCOL_VERSION "3"
 
 class IPC : public QObject
 {
     Q_OBJECT
 
 protected:
-    static const int EVENT_TIMER_MS = 1000;
     static const int EVENT_GC_TIMEOUT = 5;
     static const int EVENT_QUEUE_SIZE = 32;
-    static const int OWNERSHIP_TIMEOUT_S = 5;
+    static const int MAX_INSTANCES = 32;
+    static const int NOTIFY_TIMEOUT_MS = 100;
 
 public:
     IPC(uint32_t profileId);
@@ -66,6 +66,7 @@ public:
         time_t lastEvent;
         time_t lastProcessed;
         IPCEvent events[IPC::EVENT_QUEUE_SIZE];
+        uint64_t instances[IPC::MAX_INSTANCES];
     };
 
     time_t postEvent(const QString& name, const QByteArray& data = QByteArray(), uint32_t dest = 0);
@@ -78,15 +79,25 @@ public:
 public slots:
     void setProfileId(uint32_t profileId);
 
+private slots:
+    void onNotified();
+
 private:
     IPCMemory* global();
     bool runEventHandler(IPCEventHandler handler, const QByteArray& arg);
     IPCEvent* fetchEvent();
+    bool hasGlobalEventsNoLock();
     void processEvents();
     bool isCurrentOwnerNoLock();
+    bool listen();
+    void notifyInstances();
+
+    static QString serverName(uint64_t id);
+    static bool isInstanceRunning(uint64_t id);
+    static bool isExpired(const IPCEvent& evt);
 
 private:
-    QTimer timer;
+    QLocalServer server;
     uint64_t globalId;
     uint32_t profileId;
     QSharedMemory globalMemory;
@@ -18,6 +18,8 @@
 */
 
 #include "persistence/settings.h"
+#include "src/core/memoryusage.h"
+#include "src/core/tracer.h"
 #include "src/ipc.h"
 #include "src/net/autoupdate.h"
 #include "src/net/toxuri.h"
@@ -34,6 +36,7 @@
 #include <QDebug>
 #include <QDir>
 #include <QFile>
+#include <QFileInfo>
 #include <QFontDatabase>
 #include <QMutex>
 #include <QMutexLocker>
@@ -80,6 +83,15 @@ void cleanup()
 #endif
 }
 
+/**
+ * @brief Writes the memory usage of this instance for a qTox started with --dump-memory.
+ * @param data Absolute path of the JSON file to write.
+ */
+bool memoryDumpEventHandler(const QByteArray& data)
+{
+    return MemoryUsage::writeJson(QString::fromUtf8(data));
+}
+
 void logMessageHandler(QtMsgType type, const QMessageLogContext& ctxt, const QString& msg)
 {
     // Silence qWarning spam due to bug in QTextBrowser (trying to open a file for base64 images)
@@ -149,6 +161,13 @@ void logMessageHandler(QtMsgType type, const QMessageLogContext& ctxt, const QSt
 
 int main(int argc, char* argv[])
 {
+    // before anything else, so the whole startup is in the trace
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "--trace-startup") == 0) {
+            Tracer::start();
+        }
+    }
+
 #if (QT_VERSION >= QT_VERSION_CHECK(5, 6, 0))
     QGuiApplication::setAttribute(Qt::AA_EnableHighDpiScaling);
     QGuiApplication::setAttribute(Qt::AA_UseHighDpiPixmaps);
@@ -159,7 +178,11 @@ int main(int argc, char* argv[])
     // initialize random number generator
     qsrand(time(nullptr));
 
-    std::unique_ptr<QApplication> a(new QApplication(argc, argv));
+    std::unique_ptr<QApplication> a;
+    {
+        Tracer::Span span{"QApplication"};
+        a.reset(new QApplication(argc, argv));
+    }
 
 #if defined(Q_OS_UNIX)
     // PosixSignalNotifier is used only for terminating signals,
@@ -191,9 +214,15 @@ int main(int argc, char* argv[])
 #endif
 
     qsrand(time(nullptr));
-    Settings::getInstance();
-    QString locale = Settings::getInstance().getTranslation();
-    Translator::translate(locale);
+    {
+        Tracer::Span span{"Settings::getInstance"};
+        Settings::getInstance();
+    }
+    {
+        Tracer::Span span{"Translator::translate"};
+        QString locale = Settings::getInstance().getTranslation();
+        Translator::translate(locale);
+    }
 
     // Process arguments
     QCommandLineParser parser;
@@ -210,6 +239,14 @@ int main(int argc, char* argv[])
         QCommandLineOption(QStringList() << "l"
                                          << "login",
                            QObject::tr("Starts new instance and opens the login screen.")));
+    parser.addOption(QCommandLineOption(
+        QStringList() << "trace-startup",
+        QObject::tr("Writes a timeline of the startup to startup-trace.json in the cache "
+                    "directory.")));
+    parser.addOption(QCommandLineOption(
+        QStringList() << "dump-memory",
+        QObject::tr("Asks the running instance to write its memory usage as JSON to the file."),
+        QObject::tr("file")));
     parser.process(*a);
 
     uint32_t profileId = Settings::getInstance().getCurrentProfileId();
@@ -284,6 +321,7 @@ int main(int argc, char* argv[])
     ipc.registerEventHandler("uri", &toxURIEventHandler);
     ipc.registerEventHandler("save", &toxSaveEventHandler);
     ipc.registerEventHandler("activate", &toxActivateEventHandler);
+    ipc.registerEventHandler("memory", &memoryDumpEventHandler);
 
     uint32_t ipcDest = 0;
     bool doIpc = true;
@@ -323,6 +361,24 @@ int main(int argc, char* argv[])
         }
     }
 
+    if (parser.isSet("dump-memory")) {
+        // the running instance may have another working directory
+        const QString path = QFileInfo(parser.value("dump-memory")).absoluteFilePath();
+        if (ipc.isCurrentOwner()) {
+            qCritical() << "No running qTox instance to dump the memory usage of";
+            return EXIT_FAILURE;
+        }
+
+        const time_t event = ipc.postEvent("memory", path.toUtf8(), ipcDest);
+        if (!event || !ipc.waitUntilAccepted(event, 5)) {
+            qCritical() << "The running qTox instance didn't write the memory usage to" << path;
+            return EXIT_FAILURE;
+        }
+
+        qDebug() << "The running qTox instance wrote its memory usage to" << path;
+        return EXIT_SUCCESS;
+    }
+
     if (doIpc && !ipc.isCurrentOwner()) {
         time_t event = ipc.postEvent(eventType, firstParam.toUtf8(), ipcDest);
         // If someone else processed it, we're done here, no need to actually start qTox
@@ -345,6 +401,7 @@ int main(int argc, char* argv[])
     if (autoLogin && Profile::exists(profileName) && !Profile::isEncrypted(profileName)) {
         profile = Profile::loadProfile(profileName);
     } else {
+        Tracer::Span span{"LoginScreen"};
         LoginScreen loginScreen{profileName};
         loginScreen.exec();
         profile = loginScreen.getProfile();
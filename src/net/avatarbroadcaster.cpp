@@ -27,16 +27,19 @@
  * @class AvatarBroadcaster
  *
  * Takes care of broadcasting avatar changes to our friends in a smart way
- * Cache a copy of our current avatar and friends who have received it
+ * Cache a copy of our current avatar and the hash of the last avatar each friend received,
  * so we don't spam avatar transfers to a friend who already has it.
  */
 
 QByteArray AvatarBroadcaster::avatarData;
-QMap<uint32_t, bool> AvatarBroadcaster::friendsSentTo;
+QByteArray AvatarBroadcaster::avatarHash;
+QHash<uint32_t, QByteArray> AvatarBroadcaster::friendsSentTo;
 
 static QMetaObject::Connection autoBroadcastConn;
-static auto autoBroadcast = [](uint32_t friendId, Status) {
-    AvatarBroadcaster::sendAvatarTo(friendId);
+static auto autoBroadcast = [](const FriendEvents& events) {
+    for (const QPair<uint32_t, Status>& status : events.statuses) {
+        AvatarBroadcaster::sendAvatarTo(status.first);
+    }
 };
 
 /**
@@ -49,7 +52,9 @@ void AvatarBroadcaster::setAvatar(QByteArray data)
         return;
 
     avatarData = data;
-    friendsSentTo.clear();
+    avatarHash.resize(TOX_HASH_LENGTH);
+    tox_hash(reinterpret_cast<uint8_t*>(avatarHash.data()),
+             reinterpret_cast<const uint8_t*>(avatarData.constData()), avatarData.size());
 
     QVector<uint32_t> friends = Core::getInstance()->getFriendList();
     for (uint32_t friendId : friends)
@@ -57,17 +62,19 @@ void AvatarBroadcaster::setAvatar(QByteArray data)
 }
 
 /**
- * @brief Send our current avatar to this friend, if not already sent
+ * @brief Send our current avatar to this friend, unless it's the last avatar they got from us
  * @param friendId Id of friend to send avatar.
  */
 void AvatarBroadcaster::sendAvatarTo(uint32_t friendId)
 {
-    if (friendsSentTo.contains(friendId) && friendsSentTo[friendId])
+    // friends show the last avatar they received, so going back to an earlier avatar has to send
+    // it again, only the most recent hash tells what they have
+    if (friendsSentTo.value(friendId) == avatarHash)
         return;
     if (!Core::getInstance()->isFriendOnline(friendId))
         return;
     Core::getInstance()->sendAvatarFile(friendId, avatarData);
-    friendsSentTo[friendId] = true;
+    friendsSentTo[friendId] = avatarHash;
 }
 
 /**
@@ -79,5 +86,5 @@ void AvatarBroadcaster::enableAutoBroadcast(bool state)
     QObject::disconnect(autoBroadcastConn);
     if (state)
         autoBroadcastConn =
-            QObject::connect(Core::getInstance(), &Core::friendStatusChanged, autoBroadcast);
+            QObject::connect(Core::getInstance(), &Core::friendEventsReceived, autoBroadcast);
 }
@@ -22,7 +22,7 @@
 #define AVATARBROADCASTER_H
 
 #include <QByteArray>
-#include <QMap>
+#include <QHash>
 
 class AvatarBroadcaster
 {
@@ -36,7 +36,8 @@ public:
 
 private:
     static QByteArray avatarData;
-    static QMap<uint32_t, bool> friendsSentTo;
+    static QByteArray avatarHash;
+    static QHash<uint32_t, QByteArray> friendsSentTo;
 };
 
 #endif // AVATARBROADCASTER_H
@@ -22,8 +22,12 @@
 #include "persistence/settings.h"
 #include "src/core/core.h"
 #include "src/core/coreav.h"
+#include "src/core/corefile.h"
+#include "src/core/memoryusage.h"
+#include "src/core/tracer.h"
 #include "src/model/groupinvite.h"
 #include "src/persistence/profile.h"
+#include "src/video/videoframe.h"
 #include "src/widget/widget.h"
 #include "video/camerasource.h"
 #include "widget/gui.h"
@@ -83,6 +87,7 @@ Nexus::~Nexus()
  */
 void Nexus::start()
 {
+    Tracer::Span span{"Nexus::start"};
     qDebug() << "Starting up";
 
     // Setup the environment
@@ -99,6 +104,9 @@ void Nexus::start()
     qRegisterMetaType<ToxAV*>("ToxAV*");
     qRegisterMetaType<ToxFile>("ToxFile");
     qRegisterMetaType<ToxFile::FileDirection>("ToxFile::FileDirection");
+    qRegisterMetaType<QVector<ToxFileProgress>>("QVector<ToxFileProgress>");
+    qRegisterMetaType<FriendEvents>("FriendEvents");
+    qRegisterMetaType<QVector<FriendInfo>>("QVector<FriendInfo>");
     qRegisterMetaType<std::shared_ptr<VideoFrame>>("std::shared_ptr<VideoFrame>");
     qRegisterMetaType<ToxPk>("ToxPk");
     qRegisterMetaType<ToxId>("ToxId");
@@ -106,6 +114,10 @@ void Nexus::start()
 
     qApp->setQuitOnLastWindowClosed(false);
 
+    // static subsystems, the others register themselves when they are created
+    MemoryUsage::addSource(&VideoFrame::getMemoryUsage);
+    MemoryUsage::addSource(&CoreFile::getMemoryUsage);
+
 #ifdef Q_OS_MAC
     // TODO: still needed?
     globalMenuBar = new QMenuBar(0);
@@ -170,6 +182,7 @@ void Nexus::showLogin()
 
 void Nexus::showMainGUI()
 {
+    Tracer::Span span{"Nexus::showMainGUI"};
     assert(profile);
 
     // Create GUI
@@ -200,12 +213,16 @@ void Nexus::showMainGUI()
     connect(core, &Core::usernameSet, widget, &Widget::setUsername);
     connect(core, &Core::statusMessageSet, widget, &Widget::setStatusMessage);
     connect(core, &Core::friendAdded, widget, &Widget::addFriend);
+    connect(core, &Core::friendsLoaded, widget, &Widget::addFriends);
     connect(core, &Core::failedToAddFriend, widget, &Widget::addFriendFailed);
-    connect(core, &Core::friendUsernameChanged, widget, &Widget::onFriendUsernameChanged);
-    connect(core, &Core::friendStatusChanged, widget, &Widget::onFriendStatusChanged);
-    connect(core, &Core::friendStatusMessageChanged, widget, &Widget::onFriendStatusMessageChanged);
+    connect(core, &Core::friendEventsReceived, widget, &Widget::onFriendEventsReceived);
     connect(core, &Core::friendRequestReceived, widget, &Widget::onFriendRequestReceived);
     connect(core, &Core::friendMessageReceived, widget, &Widget::onFriendMessageReceived);
+    connect(core, &Core::fileReceiveRequested, widget, &Widget::onFileReceiveRequested);
+    connect(core, &Core::fileSendStarted, widget, &Widget::onFileSendStarted);
+    connect(core, &Core::fileSendFailed, widget, &Widget::onFileSendFailed);
+    connect(core, &Core::fileNameChanged, widget, &Widget::onFileNameChanged);
+    connect(core->getAv(), &CoreAV::avInvite, widget, &Widget::onAvInvite);
     connect(core, &Core::groupInviteReceived, widget, &Widget::onGroupInviteReceived);
     connect(core, &Core::groupMessageReceived, widget, &Widget::onGroupMessageReceived);
     connect(core, &Core::groupNamelistChanged, widget,
@@ -215,7 +232,6 @@ void Nexus::showMainGUI()
     connect(core, &Core::groupTitleChanged, widget, &Widget::onGroupTitleChanged);
     connect(core, &Core::groupPeerAudioPlaying, widget, &Widget::onGroupPeerAudioPlaying);
     connect(core, &Core::emptyGroupCreated, widget, &Widget::onEmptyGroupCreated);
-    connect(core, &Core::friendTypingChanged, widget, &Widget::onFriendTypingChanged);
     connect(core, &Core::messageSentResult, widget, &Widget::onMessageSendResult);
     connect(core, &Core::groupSentFailed, widget, &Widget::onGroupSendFailed);
 
@@ -223,6 +239,13 @@ void Nexus::showMainGUI()
     connect(widget, &Widget::friendRequested, core, &Core::requestFriendship);
     connect(widget, &Widget::friendRequestAccepted, core, &Core::acceptFriendRequest);
 
+    if (Tracer::isEnabled()) {
+        // queued after the friends Core loaded on start, so their widgets are in the trace
+        connect(core, &Core::avReady, this, [] {
+            Tracer::finish(Settings::getInstance().getAppCacheDirPath() + "startup-trace.json");
+        }, Qt::QueuedConnection);
+    }
+
     profile->startCore();
 
     GUI::setEnabled(true);
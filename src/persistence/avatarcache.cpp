@@ -0,0 +1,145 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "avatarcache.h"
+
+#include <QtConcurrent/QtConcurrentRun>
+
+/**
+ * @class AvatarCache
+ * @brief Keeps decoded avatars in memory and loads missing ones in the background.
+ *
+ * Avatars are cached as full size QPixmaps by the owner's public key, the least recently used
+ * ones are dropped once they take more than MAX_COST KiB. load() reads and decodes an avatar on
+ * a thread pool and emits avatarLoaded() once it's in the cache.
+ *
+ * @note All methods must be called from the thread the cache lives in.
+ *
+ * @var AvatarCache::MAX_COST
+ * @brief Memory in KiB the cached pixmaps may take.
+ */
+
+constexpr int AvatarCache::MAX_COST;
+
+namespace {
+int pixmapCost(const QPixmap& pixmap)
+{
+    // size in KiB, so large avatars are dropped before many small ones
+    const qint64 bytes = static_cast<qint64>(pixmap.width()) * pixmap.height() * pixmap.depth() / 8;
+    return qMax(1, static_cast<int>(bytes / 1024));
+}
+} // namespace
+
+AvatarCache::AvatarCache(QObject* parent)
+    : QObject{parent}
+    , pixmaps{MAX_COST}
+{
+}
+
+AvatarCache::~AvatarCache()
+{
+    // loaders may use data of the owner, which is gone after this
+    waitForDone();
+}
+
+/**
+ * @brief Looks up a cached avatar.
+ * @param owner Public key of the avatar's owner.
+ * @param pixmap Set to the avatar, if cached. It may be null if the owner has no avatar.
+ * @return True if the avatar is cached.
+ */
+bool AvatarCache::find(const ToxPk& owner, QPixmap& pixmap) const
+{
+    const QPixmap* cached = pixmaps.object(owner.getKey());
+    if (!cached) {
+        return false;
+    }
+
+    pixmap = *cached;
+    return true;
+}
+
+/**
+ * @brief Caches an avatar, replacing the one cached before.
+ */
+void AvatarCache::insert(const ToxPk& owner, const QPixmap& pixmap)
+{
+    pixmaps.insert(owner.getKey(), new QPixmap(pixmap), pixmapCost(pixmap));
+}
+
+/**
+ * @brief Loads an avatar in the background, unless it's being loaded already.
+ * @param owner Public key of the avatar's owner.
+ * @param loader Reads and decodes the avatar, runs on another thread.
+ */
+void AvatarCache::load(const ToxPk& owner, Loader loader)
+{
+    const QByteArray key = owner.getKey();
+    if (loading.contains(key)) {
+        return;
+    }
+
+    const int request = ++lastRequest;
+    loading.insert(key, request);
+    QtConcurrent::run(&pool, [this, loader, key, request]() {
+        // QPixmaps can only be created on the GUI thread, convert the image there
+        QMetaObject::invokeMethod(this, "onLoaded", Qt::QueuedConnection, Q_ARG(QByteArray, key),
+                                  Q_ARG(QImage, loader()), Q_ARG(int, request));
+    });
+}
+
+/**
+ * @brief Drops a cached avatar after it changed, a running load of it is discarded.
+ */
+void AvatarCache::invalidate(const ToxPk& owner)
+{
+    const QByteArray key = owner.getKey();
+    pixmaps.remove(key);
+    loading.remove(key);
+}
+
+/**
+ * @brief Drops all cached avatars.
+ */
+void AvatarCache::clear()
+{
+    pixmaps.clear();
+}
+
+/**
+ * @brief Waits until all loaders finished.
+ */
+void AvatarCache::waitForDone()
+{
+    pool.waitForDone();
+}
+
+void AvatarCache::onLoaded(const QByteArray& key, const QImage& image, int request)
+{
+    // the avatar changed while it was loaded
+    if (loading.value(key) != request) {
+        return;
+    }
+
+    loading.remove(key);
+    const ToxPk owner{key};
+    const QPixmap pixmap = QPixmap::fromImage(image);
+    insert(owner, pixmap);
+    emit avatarLoaded(owner, pixmap);
+}
@@ -0,0 +1,68 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef AVATARCACHE_H
+#define AVATARCACHE_H
+
+#include "src/core/toxpk.h"
+
+#include <QByteArray>
+#include <QCache>
+#include <QHash>
+#include <QImage>
+#include <QObject>
+#include <QPixmap>
+#include <QThreadPool>
+
+#include <functional>
+
+class AvatarCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    using Loader = std::function<QImage()>;
+
+    explicit AvatarCache(QObject* parent = nullptr);
+    ~AvatarCache();
+
+    bool find(const ToxPk& owner, QPixmap& pixmap) const;
+    void insert(const ToxPk& owner, const QPixmap& pixmap);
+    void load(const ToxPk& owner, Loader loader);
+    void invalidate(const ToxPk& owner);
+    void clear();
+    void waitForDone();
+
+signals:
+    void avatarLoaded(const ToxPk& owner, const QPixmap& pixmap);
+
+private slots:
+    void onLoaded(const QByteArray& key, const QImage& image, int request);
+
+public:
+    static constexpr int MAX_COST = 32 * 1024;
+
+private:
+    QCache<QByteArray, QPixmap> pixmaps;
+    QHash<QByteArray, int> loading;
+    int lastRequest = 0;
+    QThreadPool pool;
+};
+
+#endif // AVATARCACHE_H
@@ -18,6 +18,7 @@
 */
 
 #include "rawdatabase.h"
+#include "src/core/memoryusage.h"
 
 #include <cassert>
 #include <tox/tox.h>  // TOX_VERSION_IS_API_COMPATIBLE
@@ -95,6 +96,11 @@ RawDatabase::RawDatabase(const QString& path, const QString& password, const QBy
     moveToThread(workerThread.get());
     workerThread->start();
 
+    memoryUsageId = MemoryUsage::addSource([this]() {
+        return MemoryUsage::Entry{"sqlite", "page cache", isOpen() ? 1 : 0,
+                                  pageCacheUsed.load(std::memory_order_relaxed)};
+    });
+
     // first try with the new salt
     if (open(path, currentHexKey)) {
         return;
@@ -129,6 +135,7 @@ RawDatabase::RawDatabase(const QString& path, const QString& password, const QBy
 
 RawDatabase::~RawDatabase()
 {
+    MemoryUsage::removeSource(memoryUsageId);
     close();
     workerThread->exit(0);
     while (workerThread->isRunning())
@@ -202,10 +209,12 @@ void RawDatabase::close()
     // We assume we're in the ctor or dtor, so we just need to finish processing our transactions
     process();
 
-    if (sqlite3_close(sqlite) == SQLITE_OK)
+    if (sqlite3_close(sqlite) == SQLITE_OK) {
         sqlite = nullptr;
-    else
+        pageCacheUsed.store(0, std::memory_order_relaxed);
+    } else {
         qWarning() << "Error closing database:" << sqlite3_errmsg(sqlite);
+    }
 }
 
 /**
@@ -555,7 +564,7 @@ void RawDatabase::process()
         {
             QMutexLocker locker{&transactionsMutex};
             if (pendingTransactions.isEmpty())
-                return;
+                break;
             trans = pendingTransactions.dequeue();
         }
 
@@ -668,6 +677,14 @@ void RawDatabase::process()
         if (trans.done != nullptr)
             trans.done->store(true, std::memory_order_release);
     }
+
+    // the page cache only grows while queries run, so it's enough to look at it here
+    int cacheUsed = 0;
+    int cacheHighwater = 0;
+    if (sqlite3_db_status(sqlite, SQLITE_DBSTATUS_CACHE_USED, &cacheUsed, &cacheHighwater, 0)
+        == SQLITE_OK) {
+        pageCacheUsed.store(cacheUsed, std::memory_order_relaxed);
+    }
 }
 
 /**
@@ -112,6 +112,8 @@ private:
     QString path;
     QByteArray currentSalt;
     QString currentHexKey;
+    std::atomic<qint64> pageCacheUsed{0};
+    int memoryUsageId;
 };
 
 #endif // RAWDATABASE_H
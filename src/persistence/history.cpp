@@ -418,6 +418,25 @@ QDateTime History::getStartDateChatHistory(const QString &friendPk)
     return result;
 }
 
+/**
+ * @brief Finds the friends that have messages waiting to be sent to them.
+ * @return Public keys of the friends.
+ */
+QSet<QString> History::getUndeliveredChats()
+{
+    QSet<QString> result;
+    auto rowCallback = [&result](const QVector<QVariant>& row) {
+        result.insert(row[0].toString());
+    };
+
+    db->execNow({"SELECT DISTINCT chat.public_key FROM faux_offline_pending "
+                 "JOIN history ON faux_offline_pending.id = history.id "
+                 "JOIN peers chat ON chat_id = chat.id;",
+                 rowCallback});
+
+    return result;
+}
+
 /**
  * @brief Marks a message as sent.
  * Removing message from the faux-offline pending messages list.
@@ -22,6 +22,7 @@
 
 #include <QDateTime>
 #include <QHash>
+#include <QSet>
 #include <QVector>
 
 #include <cstdint>
@@ -85,6 +86,7 @@ public:
     QList<DateMessages> getChatHistoryCounts(const ToxPk& friendPk, const QDate& from, const QDate& to);
     QDateTime getDateWhereFindPhrase(const QString& friendPk, const QDateTime& from, QString phrase, const ParameterSearch &parameter);
     QDateTime getStartDateChatHistory(const QString& friendPk);
+    QSet<QString> getUndeliveredChats();
 
     void markAsSent(qint64 messageId);
 
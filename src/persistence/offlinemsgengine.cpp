@@ -63,6 +63,15 @@ void OfflineMsgEngine::registerReceipt(int receipt, int64_t messageID, ChatMessa
     processReceipt(receipt);
 }
 
+/**
+ * @brief Checks if messages are waiting to be sent or for their receipt.
+ */
+bool OfflineMsgEngine::hasUndeliveredMsgs() const
+{
+    QMutexLocker ml(&mutex);
+    return !undeliveredMsgs.isEmpty();
+}
+
 void OfflineMsgEngine::deliverOfflineMsgs()
 {
     QMutexLocker ml(&mutex);
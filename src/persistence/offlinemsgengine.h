@@ -39,6 +39,7 @@ public:
     void dischargeReceipt(int receipt);
     void registerReceipt(int receipt, int64_t messageID, ChatMessage::Ptr msg);
     void deliverOfflineMsgs();
+    bool hasUndeliveredMsgs() const;
 
 public slots:
     void removeAllReceipts();
@@ -58,7 +59,7 @@ private:
         ChatMessage::Ptr msg;
         int receipt;
     };
-    QMutex mutex;
+    mutable QMutex mutex;
     Friend* f;
     QHash<int, Receipt> receipts;
     QMap<int64_t, MsgPtr> undeliveredMsgs;
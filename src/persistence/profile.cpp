@@ -24,6 +24,7 @@
 #include <QObject>
 #include <QSaveFile>
 #include <QThread>
+#include <QtConcurrent/QtConcurrentRun>
 
 #include <cassert>
 #include <sodium.h>
@@ -31,8 +32,10 @@
 #include "profile.h"
 #include "profilelocker.h"
 #include "settings.h"
+#include "transferstore.h"
 #include "src/core/core.h"
 #include "src/core/corefile.h"
+#include "src/core/tracer.h"
 #include "src/net/avatarbroadcaster.h"
 #include "src/nexus.h"
 #include "src/widget/gui.h"
@@ -48,9 +51,71 @@
  *
  * @var bool Profile::isRemoved
  * @brief True if the profile has been removed by remove().
+ *
+ * @var Profile::databaseWatcher
+ * @brief Watches the database being opened in the background, see loadDatabase().
+ *
+ * @var bool Profile::databasePending
+ * @brief True while the database is opened in the background and not taken over yet.
+ *
+ * @var QElapsedTimer Profile::loginTimer
+ * @brief Time since the profile started loading, for the login timings in the log.
+ *
+ * @var Profile::saveScheduler
+ * @brief Coalesces requests to save the tox save file and skips unchanged saves.
+ *
+ * @var Profile::SAVE_DELAY
+ * @brief Time in ms to wait for more changes before saving the tox save file.
+ *
+ * @var Profile::MIN_SAVE_INTERVAL
+ * @brief Minimum time in ms between writes of the tox save file.
  */
 
 QStringList Profile::profiles;
+constexpr int Profile::SAVE_DELAY;
+constexpr qint64 Profile::MIN_SAVE_INTERVAL;
+
+namespace {
+/**
+ * @brief Reads a cached avatar file.
+ * @param path Path of the avatar, encrypted if passkey is set.
+ * @param plainPath Path of the unencrypted avatar, used if the encrypted one doesn't exist.
+ * @param passkey Key to decrypt the avatar, nullptr for unencrypted profiles.
+ */
+QByteArray readAvatar(const QString& path, const QString& plainPath, const ToxEncrypt* passkey)
+{
+    QString readPath = path;
+    // If the encrypted avatar isn't found, try loading the unencrypted one for the same ID
+    if (passkey && !QFile::exists(path)) {
+        passkey = nullptr;
+        readPath = plainPath;
+    }
+
+    QFile file(readPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return {};
+    }
+
+    QByteArray pic = file.readAll();
+    if (passkey && !pic.isEmpty()) {
+        pic = passkey->decrypt(pic);
+    }
+
+    return pic;
+}
+
+/**
+ * @brief Decodes avatar data, falling back to an identicon if there's none and they're enabled.
+ */
+QImage decodeAvatar(const ToxPk& owner, const QByteArray& data, bool showIdenticons)
+{
+    if (data.isEmpty() && showIdenticons) {
+        return Identicon(owner.getKey()).toImage(16);
+    }
+
+    return QImage::fromData(data);
+}
+} // namespace
 
 void Profile::initCore(const QByteArray& toxsave, ICoreSettings& s)
 {
@@ -72,6 +137,10 @@ void Profile::initCore(const QByteArray& toxsave, ICoreSettings& s)
         return;
     }
 
+    if (transferStore) {
+        core->setTransferStore(transferStore);
+    }
+
     // save tox file when Core requests it
     connect(core.get(), &Core::saveRequest, this, &Profile::onSaveToxSave);
     // react to avatar changes
@@ -86,11 +155,34 @@ Profile::Profile(QString name, const QString& password, bool isNewProfile, const
     , newProfile{isNewProfile}
     , isRemoved{false}
 {
+    loginTimer.start();
     Settings& s = Settings::getInstance();
     s.setCurrentProfile(name);
     s.saveGlobal();
 
-    initCore(toxsave, s);
+    connect(&saveScheduler, &SaveScheduler::saveDue, this, &Profile::flushToxSave);
+    if (!toxsave.isEmpty()) {
+        // what's on disk already doesn't need to be written again
+        saveScheduler.markSaved(SaveScheduler::hash(toxsave));
+    }
+
+    connect(&databaseWatcher, &QFutureWatcher<std::shared_ptr<RawDatabase>>::finished, this,
+            &Profile::onDatabaseLoaded);
+    // a null pixmap means there's no avatar, the placeholder stays then
+    connect(&avatarCache, &AvatarCache::avatarLoaded, this,
+            [this](const ToxPk& owner, const QPixmap& pixmap) {
+                if (!pixmap.isNull()) {
+                    emit avatarLoaded(owner, pixmap);
+                }
+            });
+    // identicons replace missing avatars in the cache
+    connect(&s, &Settings::showIdenticonsChanged, &avatarCache, &AvatarCache::clear);
+
+    {
+        Tracer::Span span{"Profile::initCore"};
+        initCore(toxsave, s);
+    }
+    qDebug() << "Creating the Tox instance took" << loginTimer.elapsed() << "ms";
 
     const ToxId& selfId = core->getSelfId();
     loadDatabase(selfId, password);
@@ -106,6 +198,7 @@ Profile::Profile(QString name, const QString& password, bool isNewProfile, const
  */
 Profile* Profile::loadProfile(QString name, const QString& password)
 {
+    Tracer::Span span{"Profile::loadProfile"};
     if (ProfileLocker::hasLock()) {
         qCritical() << "Tried to load profile " << name << ", but another profile is already locked!";
         return nullptr;
@@ -120,6 +213,8 @@ Profile* Profile::loadProfile(QString name, const QString& password)
     QByteArray data = QByteArray();
     Profile* p = nullptr;
     qint64 fileSize = 0;
+    QElapsedTimer phaseTimer;
+    phaseTimer.start();
 
     QString path = Settings::getInstance().getSettingsDirPath() + name + ".tox";
     QFile saveFile(path);
@@ -142,6 +237,7 @@ Profile* Profile::loadProfile(QString name, const QString& password)
     }
 
     data = saveFile.readAll();
+    qDebug() << "Reading the tox save took" << phaseTimer.restart() << "ms";
     if (ToxEncrypt::isEncrypted(data)) {
         if (password.isEmpty()) {
             qCritical() << "The tox save file is encrypted, but we don't have a password!";
@@ -154,11 +250,14 @@ Profile* Profile::loadProfile(QString name, const QString& password)
             goto fail;
         }
 
+        qDebug() << "Deriving the tox save key took" << phaseTimer.restart() << "ms";
         data = tmpKey->decrypt(data);
         if (data.isEmpty()) {
             qCritical() << "Failed to decrypt the tox save file";
             goto fail;
         }
+
+        qDebug() << "Decrypting the tox save took" << phaseTimer.restart() << "ms";
     } else {
         if (!password.isEmpty()) {
             qWarning() << "We have a password, but the tox save file is not encrypted";
@@ -227,8 +326,10 @@ Profile* Profile::createProfile(QString name, QString password)
 
 Profile::~Profile()
 {
+    // don't let the database outlive the profile lock
+    databaseWatcher.waitForFinished();
     if (!isRemoved && core->isReady()) {
-        onSaveToxSave();
+        flushToxSave();
     }
 
     if (!isRemoved) {
@@ -318,14 +419,31 @@ bool Profile::isNewProfile()
 }
 
 /**
- * @brief Saves the profile's .tox save, encrypted if needed.
- * @warning Invalid on deleted profiles.
+ * @brief Schedules saving the tox save file, see SaveScheduler.
  */
 void Profile::onSaveToxSave()
 {
+    saveScheduler.schedule();
+}
+
+/**
+ * @brief Saves the profile's .tox save right away, encrypted if needed.
+ *
+ * Nothing is written if the save didn't change since the last write.
+ * @warning Invalid on deleted profiles.
+ */
+void Profile::flushToxSave()
+{
+    saveScheduler.cancel();
+
     assert(core->isReady());
     QByteArray data = core->getToxSaveData();
     assert(data.size());
+    if (saveScheduler.isSaved(SaveScheduler::hash(data))) {
+        qDebug() << "Tox save didn't change, not saving";
+        return;
+    }
+
     saveToxSave(data);
 }
 
@@ -349,6 +467,7 @@ bool Profile::saveToxSave(QByteArray data)
     ProfileLocker::assertLock();
     assert(ProfileLocker::getCurLockName() == name);
 
+    const QByteArray hash = SaveScheduler::hash(data);
     QString path = Settings::getInstance().getSettingsDirPath() + name + ".tox";
     qDebug() << "Saving tox save to " << path;
     QSaveFile saveFile(path);
@@ -372,6 +491,7 @@ bool Profile::saveToxSave(QByteArray data)
     if (saveFile.flush()) {
         saveFile.commit();
         newProfile = false;
+        saveScheduler.markSaved(hash);
     } else {
         saveFile.cancelWriting();
         qCritical() << "Failed to write, can't save!";
@@ -426,48 +546,49 @@ QPixmap Profile::loadAvatar()
 QPixmap Profile::loadAvatar(const ToxPk& owner)
 {
     QPixmap pic;
-    if (Settings::getInstance().getShowIdenticons()) {
-
-        const QByteArray avataData = loadAvatarData(owner);
-        if (avataData.isEmpty()) {
-            pic = QPixmap::fromImage(Identicon(owner.getKey()).toImage(16));
-        } else {
-            pic.loadFromData(avataData);
-        }
-
-    } else {
-        pic.loadFromData(loadAvatarData(owner));
+    if (avatarCache.find(owner, pic)) {
+        return pic;
     }
 
+    const bool showIdenticons = Settings::getInstance().getShowIdenticons();
+    pic = QPixmap::fromImage(decodeAvatar(owner, loadAvatarData(owner), showIdenticons));
+    avatarCache.insert(owner, pic);
     return pic;
 }
 
 /**
- * @brief Get a contact's avatar from cache.
+ * @brief Get a contact's avatar without waiting for it to be read and decoded.
  * @param owner Friend PK to load avatar.
- * @return Avatar as QByteArray.
+ * @return The avatar if it's cached already, otherwise a placeholder. avatarLoaded() is emitted
+ * once the avatar is available then.
  */
-QByteArray Profile::loadAvatarData(const ToxPk& owner)
+QPixmap Profile::requestAvatar(const ToxPk& owner)
 {
-    QString path = avatarPath(owner);
-    bool avatarEncrypted = encrypted;
-    // If the encrypted avatar isn't found, try loading the unencrypted one for the same ID
-    if (avatarEncrypted && !QFile::exists(path)) {
-        avatarEncrypted = false;
-        path = avatarPath(owner, true);
+    QPixmap pic;
+    if (avatarCache.find(owner, pic)) {
+        return pic;
     }
 
-    QFile file(path);
-    if (!file.open(QIODevice::ReadOnly)) {
-        return {};
-    }
+    const bool showIdenticons = Settings::getInstance().getShowIdenticons();
+    const QString path = avatarPath(owner);
+    const QString plainPath = avatarPath(owner, true);
+    const ToxEncrypt* key = encrypted ? passkey.get() : nullptr;
+    avatarCache.load(owner, [owner, path, plainPath, key, showIdenticons]() {
+        return decodeAvatar(owner, readAvatar(path, plainPath, key), showIdenticons);
+    });
 
-    QByteArray pic = file.readAll();
-    if (avatarEncrypted && !pic.isEmpty()) {
-        pic = passkey->decrypt(pic);
-    }
+    return QPixmap::fromImage(decodeAvatar(owner, {}, showIdenticons));
+}
 
-    return pic;
+/**
+ * @brief Get a contact's avatar from cache.
+ * @param owner Friend PK to load avatar.
+ * @return Avatar as QByteArray.
+ */
+QByteArray Profile::loadAvatarData(const ToxPk& owner)
+{
+    return readAvatar(avatarPath(owner), avatarPath(owner, true),
+                      encrypted ? passkey.get() : nullptr);
 }
 
 void Profile::loadDatabase(const ToxId& id, QString password)
@@ -486,14 +607,58 @@ void Profile::loadDatabase(const ToxId& id, QString password)
     // At this point it's too early to load the personal settings (Nexus will do it), so we always
     // load
     // the history, and if it fails we can't change the setting now, but we keep a nullptr
-    database = std::make_shared<RawDatabase>(getDbPath(name), password, salt);
+
+    // Deriving the key takes about as long as deriving the tox save key, it's salted with our
+    // public key though, so it can only start once the Tox instance exists. Do it in the
+    // background while the GUI and Core start up, waitForDatabase() takes over the result.
+    const QString path = getDbPath(name);
+    databasePending = true;
+    databaseWatcher.setFuture(QtConcurrent::run([path, password, salt]() {
+        Tracer::Span span{"Profile::openDatabase"};
+        QElapsedTimer timer;
+        timer.start();
+        auto db = std::make_shared<RawDatabase>(path, password, salt);
+        qDebug() << "Deriving the database key and opening the database took" << timer.elapsed()
+                 << "ms";
+        return db;
+    }));
+}
+
+/**
+ * @brief Takes over the database as soon as it's opened in the background.
+ */
+void Profile::onDatabaseLoaded()
+{
+    waitForDatabase();
+}
+
+/**
+ * @brief Waits until the database started by loadDatabase() is opened and sets up the history.
+ * @note Must be called before using database, history or transferStore.
+ *
+ * Emits databaseLoaded() once, even if the database couldn't be opened.
+ */
+void Profile::waitForDatabase()
+{
+    if (!databasePending) {
+        return;
+    }
+
+    Tracer::Span span{"Profile::waitForDatabase"};
+    databasePending = false;
+    database = databaseWatcher.result();
     if (database && database->isOpen()) {
         history.reset(new History(database));
+        transferStore = std::make_shared<TransferStore>(database);
+        core->setTransferStore(transferStore);
     } else {
         qWarning() << "Failed to open database for profile" << name;
         GUI::showError(QObject::tr("Error"),
                        QObject::tr("qTox couldn't open your chat logs, they will be disabled."));
     }
+
+    qDebug() << "Profile" << name << "completely loaded after" << loginTimer.elapsed() << "ms";
+    emit databaseLoaded();
 }
 
 /**
@@ -552,6 +717,7 @@ void Profile::onRequestSent(const ToxPk& friendPk, const QString& message)
  */
 void Profile::saveAvatar(const ToxPk& owner, const QByteArray& avatar)
 {
+    avatarCache.invalidate(owner);
     const bool needEncrypt = encrypted && !avatar.isEmpty();
     const QByteArray& pic = needEncrypt ? passkey->encrypt(avatar) : avatar;
 
@@ -591,6 +757,15 @@ void Profile::removeSelfAvatar()
     removeAvatar(core->getSelfId().getPublicKey());
 }
 
+/**
+ * @brief Checks if the database was opened, or failed to open, without waiting for it.
+ * @return False while the database is still being opened in the background.
+ */
+bool Profile::isDatabaseLoaded() const
+{
+    return !databasePending;
+}
+
 /**
  * @brief Checks that the history is enabled in the settings, and loaded successfully for this
  * profile.
@@ -598,6 +773,7 @@ void Profile::removeSelfAvatar()
  */
 bool Profile::isHistoryEnabled()
 {
+    waitForDatabase();
     return Settings::getInstance().getEnableLogging() && history;
 }
 
@@ -607,6 +783,7 @@ bool Profile::isHistoryEnabled()
  */
 History* Profile::getHistory()
 {
+    waitForDatabase();
     return history.get();
 }
 
@@ -616,6 +793,7 @@ History* Profile::getHistory()
  */
 void Profile::removeAvatar(const ToxPk& owner)
 {
+    avatarCache.invalidate(owner);
     QFile::remove(avatarPath(owner));
     if (owner == core->getSelfId().getPublicKey()) {
         setAvatar({});
@@ -672,6 +850,8 @@ QStringList Profile::remove()
         return {};
     }
     isRemoved = true;
+    // a pending save would recreate the tox save file
+    saveScheduler.cancel();
 
     qDebug() << "Removing profile" << name;
     for (int i = 0; i < profiles.size(); ++i) {
@@ -698,12 +878,15 @@ QStringList Profile::remove()
     }
 
     QString dbPath = getDbPath(name);
+    waitForDatabase();
     if (database && database->isOpen() && !database->remove() && QFile::exists(dbPath)) {
         ret.push_back(dbPath);
         qWarning() << "Could not remove file " << dbPath;
     }
 
     history.release();
+    core->setTransferStore(nullptr);
+    transferStore.reset();
     database.reset();
 
     return ret;
@@ -725,6 +908,7 @@ bool Profile::rename(QString newName)
 
     QFile::rename(path + ".tox", newPath + ".tox");
     QFile::rename(path + ".ini", newPath + ".ini");
+    waitForDatabase();
     if (database) {
         database->rename(newName);
     }
@@ -790,17 +974,23 @@ QString Profile::setPassword(const QString& newPassword)
             return tr(
                 "Failed to derive key from password, the profile won't use the new password.");
         }
-        // apply change
+        // apply change, once no avatar is decrypted with the old key anymore
+        avatarCache.waitForDone();
         passkey = std::move(newpasskey);
         encrypted = true;
     }
 
-    // apply new encryption
-    onSaveToxSave();
+    // apply new encryption, even if the data didn't change
+    saveScheduler.forget();
+    flushToxSave();
+    Settings& s = Settings::getInstance();
+    s.forgetPersonalSave();
+    s.savePersonal(this);
 
     bool dbSuccess = false;
 
     // TODO: ensure the database and the tox save file use the same password
+    waitForDatabase();
     if (database) {
         dbSuccess = database->setPassword(newPassword);
     }
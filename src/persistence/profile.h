@@ -25,15 +25,21 @@
 #include "src/core/toxencrypt.h"
 #include "src/core/toxid.h"
 
+#include "src/persistence/avatarcache.h"
 #include "src/persistence/history.h"
+#include "src/persistence/savescheduler.h"
 
 #include <QByteArray>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
 #include <QObject>
 #include <QPixmap>
 #include <QString>
 #include <QVector>
 #include <memory>
 
+class TransferStore;
+
 class Profile : public QObject
 {
     Q_OBJECT
@@ -55,11 +61,13 @@ public:
 
     QPixmap loadAvatar();
     QPixmap loadAvatar(const ToxPk& owner);
+    QPixmap requestAvatar(const ToxPk& owner);
     QByteArray loadAvatarData(const ToxPk& owner);
     void setAvatar(QByteArray pic);
     QByteArray getAvatarHash(const ToxPk& owner);
     void removeSelfAvatar();
 
+    bool isDatabaseLoaded() const;
     bool isHistoryEnabled();
     History* getHistory();
 
@@ -76,6 +84,8 @@ public:
 
 signals:
     void selfAvatarChanged(const QPixmap& pixmap);
+    void avatarLoaded(const ToxPk& owner, const QPixmap& pixmap);
+    void databaseLoaded();
 
     // TODO(sudden6): this doesn't seem to be the right place for Core errors
     void failedToStart();
@@ -86,9 +96,11 @@ public slots:
 
 private slots:
     void loadDatabase(const ToxId& id, QString password);
+    void onDatabaseLoaded();
     void saveAvatar(const ToxPk& owner, const QByteArray& avatar);
     void removeAvatar(const ToxPk& owner);
     void onSaveToxSave();
+    void flushToxSave();
     // TODO(sudden6): use ToxPk instead of friendId
     void onAvatarOfferReceived(uint32_t friendId, uint32_t fileId, const QByteArray& avatarHash);
 
@@ -98,16 +110,26 @@ private:
     QString avatarPath(const ToxPk& owner, bool forceUnencrypted = false);
     bool saveToxSave(QByteArray data);
     void initCore(const QByteArray& toxsave, ICoreSettings& s);
+    void waitForDatabase();
 
 private:
     std::unique_ptr<Core> core = nullptr;
     QString name;
     std::unique_ptr<ToxEncrypt> passkey = nullptr;
+    // destroyed before passkey, which its loaders use
+    AvatarCache avatarCache;
     std::shared_ptr<RawDatabase> database;
+    QFutureWatcher<std::shared_ptr<RawDatabase>> databaseWatcher;
+    bool databasePending = false;
+    QElapsedTimer loginTimer;
+    std::shared_ptr<TransferStore> transferStore;
     std::unique_ptr<History> history;
     bool newProfile;
     bool isRemoved;
     bool encrypted = false;
+    SaveScheduler saveScheduler{SAVE_DELAY, MIN_SAVE_INTERVAL};
+    static constexpr int SAVE_DELAY = 500;
+    static constexpr qint64 MIN_SAVE_INTERVAL = 5000;
     static QStringList profiles;
 };
 
@@ -0,0 +1,115 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "savescheduler.h"
+
+#include <QTimer>
+
+#include <sodium.h>
+
+/**
+ * @class SaveScheduler
+ * @brief Coalesces save requests and skips writes of unchanged data.
+ *
+ * Requests arriving in short succession are coalesced into a single save: saveDue() is emitted
+ * delay ms after the first request, but not earlier than minInterval ms after the last save.
+ * The receiver is expected to call cancel() when it saves earlier on its own, and markSaved()
+ * with the hash of the data once it's written, so the same data isn't written again.
+ *
+ * The timer is a child of the scheduler, the scheduler has to live in the thread that saves.
+ *
+ * @fn void SaveScheduler::saveDue()
+ * @brief Emitted when the data should be saved now.
+ */
+
+/**
+ * @param delay Time in ms to wait for more requests before saving.
+ * @param minInterval Minimum time in ms between two saves.
+ * @param parent Parent object, the scheduler moves between threads with it.
+ */
+SaveScheduler::SaveScheduler(int delay, qint64 minInterval, QObject* parent)
+    : QObject{parent}
+    , timer{new QTimer(this)}
+    , delay{delay}
+    , minInterval{minInterval}
+{
+    timer->setSingleShot(true);
+    connect(timer, &QTimer::timeout, this, &SaveScheduler::saveDue);
+}
+
+/**
+ * @brief Requests a save, unless one is pending already.
+ */
+void SaveScheduler::schedule()
+{
+    if (timer->isActive()) {
+        return;
+    }
+
+    qint64 wait = delay;
+    if (lastSave.isValid()) {
+        wait = qMax(wait, minInterval - lastSave.elapsed());
+    }
+
+    timer->start(static_cast<int>(wait));
+}
+
+/**
+ * @brief Drops a pending request, because the data is saved right away or not anymore at all.
+ */
+void SaveScheduler::cancel()
+{
+    timer->stop();
+}
+
+/**
+ * @brief Checks if data with this hash() was the last data saved.
+ */
+bool SaveScheduler::isSaved(const QByteArray& hash) const
+{
+    return !lastHash.isEmpty() && hash == lastHash;
+}
+
+/**
+ * @brief Records that data with this hash() was written, or is on disk already.
+ */
+void SaveScheduler::markSaved(const QByteArray& hash)
+{
+    lastHash = hash;
+    lastSave.start();
+}
+
+/**
+ * @brief Makes the next save write the data even if it didn't change, e.g. with a new key.
+ */
+void SaveScheduler::forget()
+{
+    lastHash.clear();
+}
+
+/**
+ * @brief BLAKE2b hash of the unencrypted data, to pass to isSaved() and markSaved().
+ */
+QByteArray SaveScheduler::hash(const QByteArray& data)
+{
+    QByteArray hash(crypto_generichash_BYTES, '\0');
+    crypto_generichash(reinterpret_cast<uint8_t*>(hash.data()), hash.size(),
+                       reinterpret_cast<const uint8_t*>(data.constData()), data.size(), nullptr, 0);
+    return hash;
+}
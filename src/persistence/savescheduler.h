@@ -0,0 +1,54 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SAVESCHEDULER_H
+#define SAVESCHEDULER_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QObject>
+
+class QTimer;
+
+class SaveScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    SaveScheduler(int delay, qint64 minInterval, QObject* parent = nullptr);
+
+    void schedule();
+    void cancel();
+    bool isSaved(const QByteArray& hash) const;
+    void markSaved(const QByteArray& hash);
+    void forget();
+
+    static QByteArray hash(const QByteArray& data);
+
+signals:
+    void saveDue();
+
+private:
+    QTimer* timer;
+    QElapsedTimer lastSave;
+    QByteArray lastHash;
+    const int delay;
+    const qint64 minInterval;
+};
+
+#endif // SAVESCHEDULER_H
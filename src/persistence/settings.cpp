@@ -24,6 +24,7 @@
 #include "src/nexus.h"
 #include "src/persistence/profile.h"
 #include "src/persistence/profilelocker.h"
+#include "src/persistence/savescheduler.h"
 #include "src/persistence/settingsserializer.h"
 #include "src/persistence/smileypack.h"
 #include "src/widget/gui.h"
@@ -55,12 +56,39 @@
  *
  * @var QString Settings::toxmeInfo
  * @brief Toxme info like name@server
+ *
+ * @var Settings::personalGeneration
+ * @brief Incremented by every savePersonal() request.
+ *
+ * @var Settings::savedPersonalGeneration
+ * @brief Value of personalGeneration when the personal settings were last saved.
+ *
+ * @var Settings::personalSaveScheduler
+ * @brief Coalesces requests to save the personal settings and skips unchanged saves.
+ *
+ * @var Settings::lastPersonalPath
+ * @brief Path the personal settings were last written to, a different profile is always saved.
+ *
+ * @var Settings::PERSONAL_SAVE_DELAY
+ * @brief Time in ms to wait for more changes before saving the personal settings.
+ *
+ * @var Settings::MIN_PERSONAL_SAVE_INTERVAL
+ * @brief Minimum time in ms between saves of the personal settings.
+ *
+ * @struct Settings::Snapshot
+ * @brief Immutable copy of the settings read on hot paths by several threads.
+ *
+ * Getters of these settings read the current snapshot without taking bigLock. Setters change the
+ * member under bigLock as usual and call publishSnapshot() before emitting the change signal, so
+ * a slot reading the setting already sees the new value.
  */
 
 const QString Settings::globalSettingsFile = "qtox.ini";
 Settings* Settings::settings{nullptr};
 QMutex Settings::bigLock{QMutex::Recursive};
 QThread* Settings::settingsThread{nullptr};
+constexpr int Settings::PERSONAL_SAVE_DELAY;
+constexpr qint64 Settings::MIN_PERSONAL_SAVE_INTERVAL;
 
 Settings::Settings()
     : loaded(false)
@@ -68,6 +96,11 @@ Settings::Settings()
     , makeToxPortable{false}
     , currentProfileId(0)
 {
+    // moves to settingsThread together with us
+    personalSaveScheduler =
+        new SaveScheduler(PERSONAL_SAVE_DELAY, MIN_PERSONAL_SAVE_INTERVAL, this);
+    connect(personalSaveScheduler, &SaveScheduler::saveDue, this, &Settings::flushPersonalSave);
+
     settingsThread = new QThread();
     settingsThread->setObjectName("qTox Settings");
     settingsThread->start(QThread::LowPriority);
@@ -100,6 +133,55 @@ void Settings::destroyInstance()
     settings = nullptr;
 }
 
+/**
+ * @brief Returns the current snapshot, never blocks on bigLock.
+ */
+std::shared_ptr<const Settings::Snapshot> Settings::getSnapshot() const
+{
+    return std::atomic_load(&snapshot);
+}
+
+/**
+ * @brief Replaces the snapshot with a copy of the current settings.
+ * @note bigLock must be held.
+ */
+void Settings::publishSnapshot()
+{
+    std::shared_ptr<Snapshot> next = std::make_shared<Snapshot>();
+    next->useEmoticons = useEmoticons;
+    next->typingNotification = typingNotification;
+    next->statusChangeNotificationEnabled = statusChangeNotificationEnabled;
+    next->spellCheckingEnabled = spellCheckingEnabled;
+    next->emojiFontPointSize = emojiFontPointSize;
+    next->stylePreference = stylePreference;
+    next->chatMessageFont = chatMessageFont;
+    next->timestampFormat = timestampFormat;
+    next->dateFormat = dateFormat;
+    next->compactLayout = compactLayout;
+    next->fauxOfflineMessaging = fauxOfflineMessaging;
+    next->enableLogging = enableLogging;
+    next->autoSaveEnabled = autoSaveEnabled;
+    next->hashReceivedFiles = hashReceivedFiles;
+    next->globalAutoAcceptDir = globalAutoAcceptDir;
+    next->blackList = blackList;
+
+    next->inDev = inDev;
+    next->audioInDevEnabled = audioInDevEnabled;
+    next->audioInGainDecibel = audioInGainDecibel;
+    next->audioThreshold = audioThreshold;
+    next->outDev = outDev;
+    next->audioOutDevEnabled = audioOutDevEnabled;
+    next->outVolume = outVolume;
+    next->audioBitrate = audioBitrate;
+    next->enableBackend2 = enableBackend2;
+    next->enableTestSound = enableTestSound;
+
+    // implicitly shared, only copied once friendLst changes again
+    next->friendLst = friendLst;
+
+    std::atomic_store(&snapshot, std::shared_ptr<const Snapshot>{std::move(next)});
+}
+
 void Settings::loadGlobal()
 {
     QMutexLocker locker{&bigLock};
@@ -174,11 +256,13 @@ void Settings::loadGlobal()
             currentProfileId = makeProfileId(currentProfile);
         }
         autoAwayTime = s.value("autoAwayTime", 10).toInt();
+        chatIdleTime = s.value("chatIdleTime", 30).toInt();
         checkUpdates = s.value("checkUpdates", true).toBool();
         notifySound = s.value("notifySound", true).toBool(); // note: notifySound and busySound UI elements are now under UI settings
         busySound = s.value("busySound", false).toBool();    // page, but kept under General in settings file to be backwards compatible
         fauxOfflineMessaging = s.value("fauxOfflineMessaging", true).toBool();
         autoSaveEnabled = s.value("autoSaveEnabled", false).toBool();
+        hashReceivedFiles = s.value("hashReceivedFiles", false).toBool();
         globalAutoAcceptDir = s.value("globalAutoAcceptDir",
                                       QStandardPaths::locate(QStandardPaths::HomeLocation, QString(),
                                                              QStandardPaths::LocateDirectory))
@@ -308,6 +392,7 @@ void Settings::loadGlobal()
     }
 
     loaded = true;
+    publishSnapshot();
 }
 
 void Settings::loadPersonal()
@@ -429,6 +514,8 @@ void Settings::loadPersonal(Profile* profile)
         toxmePass = ps.value("pass", "").toString();
     }
     ps.endGroup();
+
+    publishSnapshot();
 }
 
 void Settings::resetToDefault()
@@ -494,11 +581,13 @@ void Settings::saveGlobal()
         s.setValue("closeToTray", closeToTray);
         s.setValue("currentProfile", currentProfile);
         s.setValue("autoAwayTime", autoAwayTime);
+        s.setValue("chatIdleTime", chatIdleTime);
         s.setValue("checkUpdates", checkUpdates);
         s.setValue("notifySound", notifySound);
         s.setValue("busySound", busySound);
         s.setValue("fauxOfflineMessaging", fauxOfflineMessaging);
         s.setValue("autoSaveEnabled", autoSaveEnabled);
+        s.setValue("hashReceivedFiles", hashReceivedFiles);
         s.setValue("globalAutoAcceptDir", globalAutoAcceptDir);
         s.setValue("stylePreference", static_cast<int>(stylePreference));
     }
@@ -594,9 +683,46 @@ void Settings::saveGlobal()
 
 /**
  * @brief Asynchronous, saves the current profile.
+ *
+ * Requests are coalesced, see SaveScheduler. sync() saves a pending request right away.
  */
 void Settings::savePersonal()
 {
+    ++personalGeneration;
+    if (QThread::currentThread() != settingsThread) {
+        QMetaObject::invokeMethod(&getInstance(), "schedulePersonalSave");
+        return;
+    }
+
+    schedulePersonalSave();
+}
+
+void Settings::schedulePersonalSave()
+{
+    personalSaveScheduler->schedule();
+}
+
+/**
+ * @brief Makes the next save write the personal settings even if they didn't change.
+ *
+ * Needed after the profile's key changed, so the file gets encrypted with the new one.
+ */
+void Settings::forgetPersonalSave()
+{
+    QMutexLocker locker{&bigLock};
+    personalSaveScheduler->forget();
+}
+
+/**
+ * @brief Saves the current profile right away, if a save was requested since the last one.
+ */
+void Settings::flushPersonalSave()
+{
+    personalSaveScheduler->cancel();
+    if (savedPersonalGeneration == personalGeneration) {
+        return;
+    }
+
     savePersonal(Nexus::getProfile());
 }
 
@@ -622,9 +748,11 @@ void Settings::savePersonal(QString profileName, const ToxEncrypt* passkey)
     if (!loaded)
         return;
 
-    QString path = getSettingsDirPath() + profileName + ".ini";
+    // requests made while saving need another save
+    personalSaveScheduler->cancel();
+    savedPersonalGeneration = personalGeneration;
 
-    qDebug() << "Saving personal settings at " << path;
+    QString path = getSettingsDirPath() + profileName + ".ini";
 
     SettingsSerializer ps(path, passkey);
     ps.beginGroup("Friends");
@@ -711,7 +839,18 @@ void Settings::savePersonal(QString profileName, const ToxEncrypt* passkey)
     }
     ps.endGroup();
 
-    ps.save();
+    const QByteArray data = ps.serialize();
+    const QByteArray hash = SaveScheduler::hash(data);
+    if (path == lastPersonalPath && personalSaveScheduler->isSaved(hash)) {
+        qDebug() << "Personal settings didn't change, not saving";
+        return;
+    }
+
+    qDebug() << "Saving personal settings at " << path;
+    if (ps.write(data)) {
+        personalSaveScheduler->markSaved(hash);
+        lastPersonalPath = path;
+    }
 }
 
 uint32_t Settings::makeProfileId(const QString& profile)
@@ -825,8 +964,7 @@ void Settings::setDhtServerList(const QList<DhtServer>& servers)
 }
 bool Settings::getEnableTestSound() const
 {
-    QMutexLocker locker{&bigLock};
-    return enableTestSound;
+    return getSnapshot()->enableTestSound;
 }
 
 void Settings::setEnableTestSound(bool newValue)
@@ -835,6 +973,7 @@ void Settings::setEnableTestSound(bool newValue)
 
     if (newValue != enableTestSound) {
         enableTestSound = newValue;
+        publishSnapshot();
         emit enableTestSoundChanged(enableTestSound);
     }
 }
@@ -945,14 +1084,14 @@ void Settings::setUseEmoticons(bool newValue)
 
     if (newValue != useEmoticons) {
         useEmoticons = newValue;
+        publishSnapshot();
         emit useEmoticonsChanged(useEmoticons);
     }
 }
 
 bool Settings::getUseEmoticons() const
 {
-    QMutexLocker locker{&bigLock};
-    return useEmoticons;
+    return getSnapshot()->useEmoticons;
 }
 
 void Settings::setAutoSaveEnabled(bool newValue)
@@ -961,14 +1100,30 @@ void Settings::setAutoSaveEnabled(bool newValue)
 
     if (newValue != autoSaveEnabled) {
         autoSaveEnabled = newValue;
+        publishSnapshot();
         emit autoSaveEnabledChanged(autoSaveEnabled);
     }
 }
 
 bool Settings::getAutoSaveEnabled() const
+{
+    return getSnapshot()->autoSaveEnabled;
+}
+
+void Settings::setHashReceivedFiles(bool newValue)
 {
     QMutexLocker locker{&bigLock};
-    return autoSaveEnabled;
+
+    if (newValue != hashReceivedFiles) {
+        hashReceivedFiles = newValue;
+        publishSnapshot();
+        emit hashReceivedFilesChanged(hashReceivedFiles);
+    }
+}
+
+bool Settings::getHashReceivedFiles() const
+{
+    return getSnapshot()->hashReceivedFiles;
 }
 
 void Settings::setAutostartInTray(bool newValue)
@@ -1031,8 +1186,7 @@ void Settings::setLightTrayIcon(bool newValue)
 
 bool Settings::getStatusChangeNotificationEnabled() const
 {
-    QMutexLocker locker{&bigLock};
-    return statusChangeNotificationEnabled;
+    return getSnapshot()->statusChangeNotificationEnabled;
 }
 
 void Settings::setStatusChangeNotificationEnabled(bool newValue)
@@ -1041,14 +1195,14 @@ void Settings::setStatusChangeNotificationEnabled(bool newValue)
 
     if (newValue != statusChangeNotificationEnabled) {
         statusChangeNotificationEnabled = newValue;
+        publishSnapshot();
         emit statusChangeNotificationEnabledChanged(statusChangeNotificationEnabled);
     }
 }
 
 bool Settings::getSpellCheckingEnabled() const
 {
-    const QMutexLocker locker{&bigLock};
-    return spellCheckingEnabled;
+    return getSnapshot()->spellCheckingEnabled;
 }
 
 void Settings::setSpellCheckingEnabled(bool newValue)
@@ -1057,6 +1211,7 @@ void Settings::setSpellCheckingEnabled(bool newValue)
 
     if (newValue != spellCheckingEnabled) {
         spellCheckingEnabled = newValue;
+        publishSnapshot();
         emit statusChangeNotificationEnabledChanged(statusChangeNotificationEnabled);
     }
 }
@@ -1342,8 +1497,7 @@ void Settings::setCurrentProfile(const QString& profile)
 
 bool Settings::getEnableLogging() const
 {
-    QMutexLocker locker{&bigLock};
-    return enableLogging;
+    return getSnapshot()->enableLogging;
 }
 
 void Settings::setEnableLogging(bool newValue)
@@ -1352,6 +1506,7 @@ void Settings::setEnableLogging(bool newValue)
 
     if (newValue != enableLogging) {
         enableLogging = newValue;
+        publishSnapshot();
         emit enableLoggingChanged(enableLogging);
     }
 }
@@ -1380,12 +1535,35 @@ void Settings::setAutoAwayTime(int newValue)
     }
 }
 
-QString Settings::getAutoAcceptDir(const ToxPk& id) const
+int Settings::getChatIdleTime() const
 {
     QMutexLocker locker{&bigLock};
+    return chatIdleTime;
+}
 
-    auto it = friendLst.find(id.getKey());
-    if (it != friendLst.end())
+/**
+ * @brief Sets how long a chat may stay unused, before its window is freed again.
+ * @param[in] newValue  the idle duration in minutes, 0 keeps chats until logout
+ * @note Values < 0 default to 30 minutes.
+ */
+void Settings::setChatIdleTime(int newValue)
+{
+    QMutexLocker locker{&bigLock};
+
+    if (newValue < 0)
+        newValue = 30;
+
+    if (newValue != chatIdleTime) {
+        chatIdleTime = newValue;
+        emit chatIdleTimeChanged(chatIdleTime);
+    }
+}
+
+QString Settings::getAutoAcceptDir(const ToxPk& id) const
+{
+    const auto current = getSnapshot();
+    auto it = current->friendLst.find(id.getKey());
+    if (it != current->friendLst.end())
         return it->autoAcceptDir;
 
     return QString();
@@ -1404,16 +1582,16 @@ void Settings::setAutoAcceptDir(const ToxPk& id, const QString& dir)
 
     if (it->autoAcceptDir != dir) {
         it->autoAcceptDir = dir;
+        publishSnapshot();
         emit autoAcceptDirChanged(id, dir);
     }
 }
 
 Settings::AutoAcceptCallFlags Settings::getAutoAcceptCall(const ToxPk& id) const
 {
-    QMutexLocker locker{&bigLock};
-
-    auto it = friendLst.find(id.getKey());
-    if (it != friendLst.end())
+    const auto current = getSnapshot();
+    auto it = current->friendLst.find(id.getKey());
+    if (it != current->friendLst.end())
         return it->autoAcceptCall;
 
     return Settings::AutoAcceptCallFlags();
@@ -1432,16 +1610,16 @@ void Settings::setAutoAcceptCall(const ToxPk& id, AutoAcceptCallFlags accept)
 
     if (it->autoAcceptCall != accept) {
         it->autoAcceptCall = accept;
+        publishSnapshot();
         emit autoAcceptCallChanged(id, accept);
     }
 }
 
 bool Settings::getAutoGroupInvite(const ToxPk& id) const
 {
-    QMutexLocker locker{&bigLock};
-
-    auto it = friendLst.find(id.getKey());
-    if (it != friendLst.end()) {
+    const auto current = getSnapshot();
+    auto it = current->friendLst.find(id.getKey());
+    if (it != current->friendLst.end()) {
         return it->autoGroupInvite;
     }
 
@@ -1461,16 +1639,16 @@ void Settings::setAutoGroupInvite(const ToxPk& id, bool accept)
 
     if (it->autoGroupInvite != accept) {
         it->autoGroupInvite = accept;
+        publishSnapshot();
         emit autoGroupInviteChanged(id, accept);
     }
 }
 
 QString Settings::getContactNote(const ToxPk& id) const
 {
-    QMutexLocker locker{&bigLock};
-
-    auto it = friendLst.find(id.getKey());
-    if (it != friendLst.end())
+    const auto current = getSnapshot();
+    auto it = current->friendLst.find(id.getKey());
+    if (it != current->friendLst.end())
         return it->note;
 
     return QString();
@@ -1489,14 +1667,14 @@ void Settings::setContactNote(const ToxPk& id, const QString& note)
 
     if (it->note != note) {
         it->note = note;
+        publishSnapshot();
         emit contactNoteChanged(id, note);
     }
 }
 
 QString Settings::getGlobalAutoAcceptDir() const
 {
-    QMutexLocker locker{&bigLock};
-    return globalAutoAcceptDir;
+    return getSnapshot()->globalAutoAcceptDir;
 }
 
 void Settings::setGlobalAutoAcceptDir(const QString& newValue)
@@ -1505,14 +1683,14 @@ void Settings::setGlobalAutoAcceptDir(const QString& newValue)
 
     if (newValue != globalAutoAcceptDir) {
         globalAutoAcceptDir = newValue;
+        publishSnapshot();
         emit globalAutoAcceptDirChanged(globalAutoAcceptDir);
     }
 }
 
-const QFont& Settings::getChatMessageFont() const
+QFont Settings::getChatMessageFont() const
 {
-    QMutexLocker locker(&bigLock);
-    return chatMessageFont;
+    return getSnapshot()->chatMessageFont;
 }
 
 void Settings::setChatMessageFont(const QFont& font)
@@ -1521,6 +1699,7 @@ void Settings::setChatMessageFont(const QFont& font)
 
     if (font != chatMessageFont) {
         chatMessageFont = font;
+        publishSnapshot();
         emit chatMessageFontChanged(chatMessageFont);
     }
 }
@@ -1559,8 +1738,7 @@ void Settings::setSmileyPack(const QString& value)
 
 int Settings::getEmojiFontPointSize() const
 {
-    QMutexLocker locker{&bigLock};
-    return emojiFontPointSize;
+    return getSnapshot()->emojiFontPointSize;
 }
 
 void Settings::setEmojiFontPointSize(int value)
@@ -1569,14 +1747,14 @@ void Settings::setEmojiFontPointSize(int value)
 
     if (value != emojiFontPointSize) {
         emojiFontPointSize = value;
+        publishSnapshot();
         emit emojiFontPointSizeChanged(emojiFontPointSize);
     }
 }
 
-const QString& Settings::getTimestampFormat() const
+QString Settings::getTimestampFormat() const
 {
-    QMutexLocker locker{&bigLock};
-    return timestampFormat;
+    return getSnapshot()->timestampFormat;
 }
 
 void Settings::setTimestampFormat(const QString& format)
@@ -1585,14 +1763,14 @@ void Settings::setTimestampFormat(const QString& format)
 
     if (format != timestampFormat) {
         timestampFormat = format;
+        publishSnapshot();
         emit timestampFormatChanged(timestampFormat);
     }
 }
 
-const QString& Settings::getDateFormat() const
+QString Settings::getDateFormat() const
 {
-    QMutexLocker locker{&bigLock};
-    return dateFormat;
+    return getSnapshot()->dateFormat;
 }
 
 void Settings::setDateFormat(const QString& format)
@@ -1601,14 +1779,14 @@ void Settings::setDateFormat(const QString& format)
 
     if (format != dateFormat) {
         dateFormat = format;
+        publishSnapshot();
         emit dateFormatChanged(dateFormat);
     }
 }
 
 Settings::StyleType Settings::getStylePreference() const
 {
-    QMutexLocker locker{&bigLock};
-    return stylePreference;
+    return getSnapshot()->stylePreference;
 }
 
 void Settings::setStylePreference(StyleType newValue)
@@ -1617,6 +1795,7 @@ void Settings::setStylePreference(StyleType newValue)
 
     if (newValue != stylePreference) {
         stylePreference = newValue;
+        publishSnapshot();
         emit stylePreferenceChanged(stylePreference);
     }
 }
@@ -1782,8 +1961,7 @@ void Settings::setMinimizeOnClose(bool newValue)
 
 bool Settings::getTypingNotification() const
 {
-    QMutexLocker locker{&bigLock};
-    return typingNotification;
+    return getSnapshot()->typingNotification;
 }
 
 void Settings::setTypingNotification(bool enabled)
@@ -1792,14 +1970,14 @@ void Settings::setTypingNotification(bool enabled)
 
     if (enabled != typingNotification) {
         typingNotification = enabled;
+        publishSnapshot();
         emit typingNotificationChanged(typingNotification);
     }
 }
 
 QStringList Settings::getBlackList() const
 {
-    QMutexLocker locker{&bigLock};
-    return blackList;
+    return getSnapshot()->blackList;
 }
 
 void Settings::setBlackList(const QStringList& blist)
@@ -1808,14 +1986,14 @@ void Settings::setBlackList(const QStringList& blist)
 
     if (blist != blackList) {
         blackList = blist;
+        publishSnapshot();
         emit blackListChanged(blackList);
     }
 }
 
 QString Settings::getInDev() const
 {
-    QMutexLocker locker{&bigLock};
-    return inDev;
+    return getSnapshot()->inDev;
 }
 
 void Settings::setInDev(const QString& deviceSpecifier)
@@ -1824,14 +2002,14 @@ void Settings::setInDev(const QString& deviceSpecifier)
 
     if (deviceSpecifier != inDev) {
         inDev = deviceSpecifier;
+        publishSnapshot();
         emit inDevChanged(inDev);
     }
 }
 
 bool Settings::getAudioInDevEnabled() const
 {
-    QMutexLocker locker(&bigLock);
-    return audioInDevEnabled;
+    return getSnapshot()->audioInDevEnabled;
 }
 
 void Settings::setAudioInDevEnabled(bool enabled)
@@ -1840,14 +2018,14 @@ void Settings::setAudioInDevEnabled(bool enabled)
 
     if (enabled != audioInDevEnabled) {
         audioInDevEnabled = enabled;
+        publishSnapshot();
         emit audioInDevEnabledChanged(enabled);
     }
 }
 
 qreal Settings::getAudioInGainDecibel() const
 {
-    QMutexLocker locker{&bigLock};
-    return audioInGainDecibel;
+    return getSnapshot()->audioInGainDecibel;
 }
 
 void Settings::setAudioInGainDecibel(qreal dB)
@@ -1856,14 +2034,14 @@ void Settings::setAudioInGainDecibel(qreal dB)
 
     if (dB < audioInGainDecibel || dB > audioInGainDecibel) {
         audioInGainDecibel = dB;
+        publishSnapshot();
         emit audioInGainDecibelChanged(audioInGainDecibel);
     }
 }
 
 qreal Settings::getAudioThreshold() const
 {
-    QMutexLocker locker{&bigLock};
-    return audioThreshold;
+    return getSnapshot()->audioThreshold;
 }
 
 void Settings::setAudioThreshold(qreal percent)
@@ -1872,6 +2050,7 @@ void Settings::setAudioThreshold(qreal percent)
 
     if (percent < audioThreshold || percent > audioThreshold) {
         audioThreshold = percent;
+        publishSnapshot();
         emit audioThresholdChanged(audioThreshold);
     }
 }
@@ -1894,8 +2073,7 @@ void Settings::setVideoDev(const QString& deviceSpecifier)
 
 QString Settings::getOutDev() const
 {
-    QMutexLocker locker{&bigLock};
-    return outDev;
+    return getSnapshot()->outDev;
 }
 
 void Settings::setOutDev(const QString& deviceSpecifier)
@@ -1904,14 +2082,14 @@ void Settings::setOutDev(const QString& deviceSpecifier)
 
     if (deviceSpecifier != outDev) {
         outDev = deviceSpecifier;
+        publishSnapshot();
         emit outDevChanged(outDev);
     }
 }
 
 bool Settings::getAudioOutDevEnabled() const
 {
-    QMutexLocker locker(&bigLock);
-    return audioOutDevEnabled;
+    return getSnapshot()->audioOutDevEnabled;
 }
 
 void Settings::setAudioOutDevEnabled(bool enabled)
@@ -1920,14 +2098,14 @@ void Settings::setAudioOutDevEnabled(bool enabled)
 
     if (enabled != audioOutDevEnabled) {
         audioOutDevEnabled = enabled;
+        publishSnapshot();
         emit audioOutDevEnabledChanged(audioOutDevEnabled);
     }
 }
 
 int Settings::getOutVolume() const
 {
-    QMutexLocker locker{&bigLock};
-    return outVolume;
+    return getSnapshot()->outVolume;
 }
 
 void Settings::setOutVolume(int volume)
@@ -1936,14 +2114,14 @@ void Settings::setOutVolume(int volume)
 
     if (volume != outVolume) {
         outVolume = volume;
+        publishSnapshot();
         emit outVolumeChanged(outVolume);
     }
 }
 
 int Settings::getAudioBitrate() const
 {
-    const QMutexLocker locker{&bigLock};
-    return audioBitrate;
+    return getSnapshot()->audioBitrate;
 }
 
 void Settings::setAudioBitrate(int bitrate)
@@ -1952,14 +2130,14 @@ void Settings::setAudioBitrate(int bitrate)
 
     if (bitrate != audioBitrate) {
         audioBitrate = bitrate;
+        publishSnapshot();
         emit audioBitrateChanged(audioBitrate);
     }
 }
 
 bool Settings::getEnableBackend2() const
 {
-    QMutexLocker locker{&bigLock};
-    return enableBackend2;
+    return getSnapshot()->enableBackend2;
 }
 
 void Settings::setEnableBackend2(bool enabled)
@@ -1968,6 +2146,7 @@ void Settings::setEnableBackend2(bool enabled)
 
     if (enabled != enableBackend2) {
         enableBackend2 = enabled;
+        publishSnapshot();
         emit enableBackend2Changed(enabled);
     }
 }
@@ -2064,13 +2243,15 @@ void Settings::updateFriendAddress(const QString& newAddr)
         fp.autoAcceptDir = "";
         friendLst[key] = fp;
     }
+
+    publishSnapshot();
 }
 
 QString Settings::getFriendAlias(const ToxPk& id) const
 {
-    QMutexLocker locker{&bigLock};
-    auto it = friendLst.find(id.getKey());
-    if (it != friendLst.end())
+    const auto current = getSnapshot();
+    auto it = current->friendLst.find(id.getKey());
+    if (it != current->friendLst.end())
         return it->alias;
 
     return QString();
@@ -2090,12 +2271,15 @@ void Settings::setFriendAlias(const ToxPk& id, const QString& alias)
         fp.autoAcceptDir = "";
         friendLst[id.getKey()] = fp;
     }
+
+    publishSnapshot();
 }
 
 int Settings::getFriendCircleID(const ToxPk& id) const
 {
-    auto it = friendLst.find(id.getKey());
-    if (it != friendLst.end())
+    const auto current = getSnapshot();
+    auto it = current->friendLst.find(id.getKey());
+    if (it != current->friendLst.end())
         return it->circleID;
 
     return -1;
@@ -2103,6 +2287,7 @@ int Settings::getFriendCircleID(const ToxPk& id) const
 
 void Settings::setFriendCircleID(const ToxPk& id, int circleID)
 {
+    QMutexLocker locker{&bigLock};
     auto it = friendLst.find(id.getKey());
     if (it != friendLst.end()) {
         it->circleID = circleID;
@@ -2115,12 +2300,15 @@ void Settings::setFriendCircleID(const ToxPk& id, int circleID)
         fp.circleID = circleID;
         friendLst[id.getKey()] = fp;
     }
+
+    publishSnapshot();
 }
 
 QDate Settings::getFriendActivity(const ToxPk& id) const
 {
-    auto it = friendLst.find(id.getKey());
-    if (it != friendLst.end())
+    const auto current = getSnapshot();
+    auto it = current->friendLst.find(id.getKey());
+    if (it != current->friendLst.end())
         return it->activity;
 
     return QDate();
@@ -2128,19 +2316,39 @@ QDate Settings::getFriendActivity(const ToxPk& id) const
 
 void Settings::setFriendActivity(const ToxPk& id, const QDate& activity)
 {
-    auto it = friendLst.find(id.getKey());
-    if (it != friendLst.end()) {
-        it->activity = activity;
-    } else {
-        friendProp fp;
-        fp.addr = id.toString();
-        fp.alias = "";
-        fp.note = "";
-        fp.autoAcceptDir = "";
-        fp.circleID = -1;
-        fp.activity = activity;
-        friendLst[id.getKey()] = fp;
+    setFriendsActivity({id}, activity);
+}
+
+/**
+ * @brief Sets the activity of several friends at once.
+ *
+ * Every change of the friend settings publishes a new snapshot, which copies the friend list.
+ * Setting the activity of all friends one by one would copy it once per friend.
+ */
+void Settings::setFriendsActivity(const QVector<ToxPk>& ids, const QDate& activity)
+{
+    if (ids.isEmpty()) {
+        return;
     }
+
+    QMutexLocker locker{&bigLock};
+    for (const ToxPk& id : ids) {
+        auto it = friendLst.find(id.getKey());
+        if (it != friendLst.end()) {
+            it->activity = activity;
+        } else {
+            friendProp fp;
+            fp.addr = id.toString();
+            fp.alias = "";
+            fp.note = "";
+            fp.autoAcceptDir = "";
+            fp.circleID = -1;
+            fp.activity = activity;
+            friendLst[id.getKey()] = fp;
+        }
+    }
+
+    publishSnapshot();
 }
 
 void Settings::saveFriendSettings(const ToxPk& id)
@@ -2153,12 +2361,12 @@ void Settings::removeFriendSettings(const ToxPk& id)
 {
     QMutexLocker locker{&bigLock};
     friendLst.remove(id.getKey());
+    publishSnapshot();
 }
 
 bool Settings::getFauxOfflineMessaging() const
 {
-    QMutexLocker locker{&bigLock};
-    return fauxOfflineMessaging;
+    return getSnapshot()->fauxOfflineMessaging;
 }
 
 void Settings::setFauxOfflineMessaging(bool value)
@@ -2167,14 +2375,14 @@ void Settings::setFauxOfflineMessaging(bool value)
 
     if (value != fauxOfflineMessaging) {
         fauxOfflineMessaging = value;
+        publishSnapshot();
         emit fauxOfflineMessagingChanged(fauxOfflineMessaging);
     }
 }
 
 bool Settings::getCompactLayout() const
 {
-    QMutexLocker locker{&bigLock};
-    return compactLayout;
+    return getSnapshot()->compactLayout;
 }
 
 void Settings::setCompactLayout(bool value)
@@ -2183,6 +2391,7 @@ void Settings::setCompactLayout(bool value)
 
     if (value != compactLayout) {
         compactLayout = value;
+        publishSnapshot();
         emit compactLayoutChanged(value);
     }
 }
@@ -2443,4 +2652,5 @@ void Settings::sync()
 
     QMutexLocker locker{&bigLock};
     qApp->processEvents();
+    flushPersonalSave();
 }
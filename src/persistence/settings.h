@@ -37,7 +37,11 @@
 #include <QObject>
 #include <QPixmap>
 
+#include <atomic>
+#include <memory>
+
 class Profile;
+class SaveScheduler;
 
 namespace Db {
 enum class syncType;
@@ -141,6 +145,7 @@ public:
     void createPersonal(QString basename);
 
     void savePersonal();
+    void forgetPersonalSave();
 
     void loadGlobal();
     void loadPersonal();
@@ -163,6 +168,7 @@ signals:
     // General
     void autorunChanged(bool enabled);
     void autoSaveEnabledChanged(bool enabled);
+    void hashReceivedFilesChanged(bool enabled);
     void autostartInTrayChanged(bool enabled);
     void closeToTrayChanged(bool enabled);
     void lightTrayIconChanged(bool enabled);
@@ -182,6 +188,7 @@ signals:
     void currentProfileIdChanged(quint32 id);
     void enableLoggingChanged(bool enabled);
     void autoAwayTimeChanged(int minutes);
+    void chatIdleTimeChanged(int minutes);
     void globalAutoAcceptDirChanged(const QString& path);
     void checkUpdatesChanged(bool enabled);
     void widgetDataChanged(const QString& key);
@@ -274,6 +281,9 @@ public:
     void setAutoSaveEnabled(bool newValue);
     bool getAutoSaveEnabled() const;
 
+    void setHashReceivedFiles(bool newValue);
+    bool getHashReceivedFiles() const;
+
     // ICoreSettings
     const QList<DhtServer>& getDhtServerList() const override;
     void setDhtServerList(const QList<DhtServer>& servers) override;
@@ -315,6 +325,9 @@ public:
     int getAutoAwayTime() const;
     void setAutoAwayTime(int newValue);
 
+    int getChatIdleTime() const;
+    void setChatIdleTime(int newValue);
+
     bool getCheckUpdates() const;
     void setCheckUpdates(bool newValue);
 
@@ -433,13 +446,13 @@ public:
     void setAutoGroupInvite(const ToxPk& id, bool accept) override;
 
     // ChatView
-    const QFont& getChatMessageFont() const;
+    QFont getChatMessageFont() const;
     void setChatMessageFont(const QFont& font);
 
-    const QString& getTimestampFormat() const;
+    QString getTimestampFormat() const;
     void setTimestampFormat(const QString& format);
 
-    const QString& getDateFormat() const;
+    QString getDateFormat() const;
     void setDateFormat(const QString& format);
 
     bool getMinimizeOnClose() const;
@@ -487,6 +500,7 @@ public:
 
     QDate getFriendActivity(const ToxPk& id) const override;
     void setFriendActivity(const ToxPk& id, const QDate& date) override;
+    void setFriendsActivity(const QVector<ToxPk>& ids, const QDate& date);
 
     void saveFriendSettings(const ToxPk& id) override;
     void removeFriendSettings(const ToxPk& id) override;
@@ -560,13 +574,27 @@ private:
     Settings(Settings& settings) = delete;
     Settings& operator=(const Settings&) = delete;
     void savePersonal(QString profileName, const ToxEncrypt* passkey);
+    struct Snapshot;
+    std::shared_ptr<const Snapshot> getSnapshot() const;
+    void publishSnapshot();
 
 public slots:
     void savePersonal(Profile* profile);
 
+private slots:
+    void schedulePersonalSave();
+    void flushPersonalSave();
+
 private:
     bool loaded;
 
+    SaveScheduler* personalSaveScheduler;
+    std::atomic<quint64> personalGeneration{0};
+    quint64 savedPersonalGeneration = 0;
+    QString lastPersonalPath;
+    static constexpr int PERSONAL_SAVE_DELAY = 1000;
+    static constexpr qint64 MIN_PERSONAL_SAVE_INTERVAL = 5000;
+
     bool useCustomDhtList;
     QList<DhtServer> dhtServerList;
     int dhtServerId;
@@ -574,7 +602,7 @@ private:
 
     bool autoLogin;
     bool fauxOfflineMessaging;
-    bool compactLayout;
+    bool compactLayout = true;
     bool groupchatPosition;
     bool separateWindow;
     bool dontGroupWindows;
@@ -610,13 +638,15 @@ private:
     bool toxmePriv;
     QString toxmePass;
 
-    bool enableLogging;
+    bool enableLogging = true;
 
     int autoAwayTime;
+    int chatIdleTime;
 
     QHash<QString, QByteArray> widgetSettings;
     QHash<QString, QString> autoAccept;
     bool autoSaveEnabled;
+    bool hashReceivedFiles;
     QString globalAutoAcceptDir;
 
     QList<Request> friendRequests;
@@ -645,7 +675,7 @@ private:
     bool spellCheckingEnabled;
 
     // Privacy
-    bool typingNotification;
+    bool typingNotification = true;
     Db::syncType dbSyncType;
     QStringList blackList;
 
@@ -688,6 +718,41 @@ private:
 
     QHash<QByteArray, friendProp> friendLst;
 
+    struct Snapshot
+    {
+        bool useEmoticons;
+        bool typingNotification;
+        bool statusChangeNotificationEnabled;
+        bool spellCheckingEnabled;
+        int emojiFontPointSize;
+        StyleType stylePreference;
+        QFont chatMessageFont;
+        QString timestampFormat;
+        QString dateFormat;
+        bool compactLayout;
+        bool fauxOfflineMessaging;
+        bool enableLogging;
+        bool autoSaveEnabled;
+        bool hashReceivedFiles;
+        QString globalAutoAcceptDir;
+        QStringList blackList;
+
+        QString inDev;
+        bool audioInDevEnabled;
+        qreal audioInGainDecibel;
+        qreal audioThreshold;
+        QString outDev;
+        bool audioOutDevEnabled;
+        int outVolume;
+        int audioBitrate;
+        bool enableBackend2;
+        bool enableTestSound;
+
+        QHash<QByteArray, friendProp> friendLst;
+    };
+
+    std::shared_ptr<const Snapshot> snapshot;
+
     QVector<circleProp> circleLst;
 
     int themeColor;
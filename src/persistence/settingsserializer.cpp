@@ -38,6 +38,9 @@
  * The file is only written to disk if save() is called, the destructor does not save to disk
  * All member functions are reentrant, but not thread safe.
  *
+ * Values are indexed by group, array, array index and key, so looking one up doesn't depend on
+ * the number of values, and loading a file takes linear time.
+ *
  * @enum SettingsSerializer::RecordTag
  * @var Value
  * Followed by a QString key then a QVariant value
@@ -99,6 +102,21 @@ QDataStream& readStream(QDataStream& dataStream, QByteArray& data)
     return dataStream;
 }
 
+bool SettingsSerializer::ValueKey::operator==(const ValueKey& other) const
+{
+    return group == other.group && array == other.array && arrayIndex == other.arrayIndex
+           && key == other.key;
+}
+
+uint qHash(const SettingsSerializer::ValueKey& key, uint seed)
+{
+    uint hash = qHash(key.key, seed);
+    hash ^= qHash(key.group) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    hash ^= qHash(key.array) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    hash ^= qHash(key.arrayIndex) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
 SettingsSerializer::SettingsSerializer(QString filePath, const ToxEncrypt* passKey)
     : path{filePath}
     , passKey{passKey}
@@ -181,6 +199,7 @@ void SettingsSerializer::setValue(const QString& key, const QVariant& value)
         Value nv{group, array, arrayIndex, key, value};
         if (array >= 0)
             arrays[array].values.append(values.size());
+        index.insert(makeKey(group, array, arrayIndex, key), values.size());
         values.append(nv);
     }
 }
@@ -194,25 +213,24 @@ QVariant SettingsSerializer::value(const QString& key, const QVariant& defaultVa
         return defaultValue;
 }
 
+/**
+ * @brief Builds the index key of a value.
+ *
+ * The array index only matters for values in an array, it's not reset by endArray().
+ */
+SettingsSerializer::ValueKey SettingsSerializer::makeKey(qint64 group, qint64 array,
+                                                         int arrayIndex, const QString& key)
+{
+    return {group, array, array == -1 ? -1 : arrayIndex, key};
+}
+
 const SettingsSerializer::Value* SettingsSerializer::findValue(const QString& key) const
 {
-    if (array != -1) {
-        for (const Array& a : arrays) {
-            if (a.group != group)
-                continue;
+    auto it = index.constFind(makeKey(group, array, arrayIndex, key));
+    if (it == index.constEnd())
+        return nullptr;
 
-            for (int vi : a.values) {
-                const Value& v = values[vi];
-                if (v.arrayIndex == arrayIndex && v.key == key)
-                    return &v;
-            }
-        }
-    } else {
-        for (const Value& v : values)
-            if (v.group == group && v.array == -1 && v.key == key)
-                return &v;
-    }
-    return nullptr;
+    return &values[*it];
 }
 
 SettingsSerializer::Value* SettingsSerializer::findValue(const QString& key)
@@ -220,6 +238,19 @@ SettingsSerializer::Value* SettingsSerializer::findValue(const QString& key)
     return const_cast<Value*>(const_cast<const SettingsSerializer*>(this)->findValue(key));
 }
 
+/**
+ * @brief Indexes all values again, after they were moved or changed their group or array.
+ */
+void SettingsSerializer::rebuildIndex()
+{
+    index.clear();
+    index.reserve(values.size());
+    for (int i = 0; i < values.size(); ++i) {
+        const Value& v = values[i];
+        index.insert(makeKey(v.group, v.array, v.arrayIndex, v.key), i);
+    }
+}
+
 /**
  * @brief Checks if the file is serialized settings.
  * @param filePath Path to file to check.
@@ -252,12 +283,15 @@ void SettingsSerializer::load()
  */
 void SettingsSerializer::save()
 {
-    QSaveFile f(path);
-    if (!f.open(QIODevice::Truncate | QIODevice::WriteOnly)) {
-        qWarning() << "Couldn't open file";
-        return;
-    }
+    write(serialize());
+}
 
+/**
+ * @brief Serializes the current settings, without encrypting them.
+ * @return The data as write() expects it.
+ */
+QByteArray SettingsSerializer::serialize()
+{
     QByteArray data(magic, 4);
     QDataStream stream(&data, QIODevice::ReadWrite | QIODevice::Append);
     stream.setVersion(QDataStream::Qt_5_0);
@@ -301,6 +335,22 @@ void SettingsSerializer::save()
         }
     }
 
+    return data;
+}
+
+/**
+ * @brief Writes serialized settings to file, encrypted if there's a passkey.
+ * @param data Settings returned by serialize().
+ * @return True on success, false otherwise.
+ */
+bool SettingsSerializer::write(QByteArray data)
+{
+    QSaveFile f(path);
+    if (!f.open(QIODevice::Truncate | QIODevice::WriteOnly)) {
+        qWarning() << "Couldn't open file";
+        return false;
+    }
+
     // Encrypt
     if (passKey) {
         data = passKey->encrypt(data);
@@ -314,7 +364,10 @@ void SettingsSerializer::save()
     } else {
         f.cancelWriting();
         qCritical() << "Failed to write, can't save!";
+        return false;
     }
+
+    return true;
 }
 
 void SettingsSerializer::readSerialized()
@@ -348,10 +401,10 @@ void SettingsSerializer::readSerialized()
         qWarning() << "Bad magic!";
         return;
     }
-    data = data.mid(4);
 
     QDataStream stream(&data, QIODevice::ReadOnly);
     stream.setVersion(QDataStream::Qt_5_0);
+    stream.skipRawData(4);
 
     while (!stream.atEnd()) {
         RecordTag tag;
@@ -525,6 +578,7 @@ void SettingsSerializer::readIni()
         removeGroup(g);
     }
 
+    rebuildIndex();
     group = array = -1;
 }
 
@@ -23,6 +23,7 @@
 #include "src/core/toxencrypt.h"
 
 #include <QDataStream>
+#include <QHash>
 #include <QSettings>
 #include <QString>
 #include <QVector>
@@ -36,6 +37,8 @@ public:
 
     void load();
     void save();
+    QByteArray serialize();
+    bool write(QByteArray data);
 
     void beginGroup(const QString& prefix);
     void endGroup();
@@ -85,6 +88,17 @@ private:
         QVariant value;
     };
 
+    struct ValueKey
+    {
+        qint64 group;
+        qint64 array;
+        int arrayIndex;
+        QString key;
+
+        bool operator==(const ValueKey& other) const;
+    };
+    friend uint qHash(const SettingsSerializer::ValueKey& key, uint seed);
+
     struct Array
     {
         qint64 group;
@@ -94,8 +108,10 @@ private:
     };
 
 private:
+    static ValueKey makeKey(qint64 group, qint64 array, int arrayIndex, const QString& key);
     const Value* findValue(const QString& key) const;
     Value* findValue(const QString& key);
+    void rebuildIndex();
     void readSerialized();
     void readIni();
     void removeValue(const QString& key);
@@ -109,6 +125,7 @@ private:
     QStringList groups;
     QVector<Array> arrays;
     QVector<Value> values;
+    QHash<ValueKey, int> index;
     static const char magic[];
 };
 
@@ -18,6 +18,7 @@
 */
 
 #include "smileypack.h"
+#include "src/core/memoryusage.h"
 #include "src/persistence/settings.h"
 
 #include <QDir>
@@ -113,10 +114,22 @@ SmileyPack::SmileyPack()
             &SmileyPack::onSmileyPackChanged);
     connect(cleanupTimer, &QTimer::timeout, this, &SmileyPack::cleanupIconsCache);
     cleanupTimer->start(CLEANUP_TIMEOUT);
+
+    memoryUsageId = MemoryUsage::addSource([this]() {
+        QMutexLocker locker(&loadingMutex);
+        qint64 bytes = 0;
+        for (const auto& cached : cachedIcon) {
+            bytes += MemoryUsage::estimateIcon(*cached.second, emoticonToPath.value(cached.first));
+        }
+
+        return MemoryUsage::Entry{"smileypack", "icons", static_cast<qint64>(cachedIcon.size()),
+                                  bytes};
+    });
 }
 
 SmileyPack::~SmileyPack()
 {
+    MemoryUsage::removeSource(memoryUsageId);
     delete cleanupTimer;
 }
 
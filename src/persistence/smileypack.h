@@ -58,6 +58,7 @@ private:
     QList<QStringList> emoticons;
     QString path;
     QTimer* cleanupTimer;
+    int memoryUsageId;
     mutable QMutex loadingMutex;
 };
 
@@ -0,0 +1,240 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "transferstore.h"
+#include "db/rawdatabase.h"
+
+#include <QDebug>
+
+/**
+ * @class TransferStore
+ * @brief Remembers unfinished file transfers in the profile database, so they can be resumed.
+ *
+ * All transfers are cached in memory when the store is created, lookups never touch the
+ * database. Changes are written in the background by the database thread, so the store can be
+ * used from the Core thread.
+ *
+ * @struct TransferStore::Transfer
+ * @brief State of an unfinished transfer.
+ *
+ * @var QByteArray TransferStore::Transfer::fileId
+ * @brief Tox file ID, a sender offering a file with the same ID again continues the transfer.
+ *
+ * @var quint64 TransferStore::Transfer::bytesDone
+ * @brief Received bytes known to be on disk, 0 for outgoing transfers.
+ *
+ * @var QByteArray TransferStore::Transfer::checksum
+ * @brief Checksum of the data right before bytesDone, to check the partial file is unchanged.
+ *
+ * Only covers the last FileWriteBehind::CHECKSUM_WINDOW bytes, so checking it costs one small
+ * read no matter how large the partial file is.
+ */
+
+namespace {
+QByteArray copyBlob(const QVariant& value)
+{
+    // blobs point into sqlite's memory, which is only valid during the row callback
+    const QByteArray blob = value.toByteArray();
+    return QByteArray(blob.constData(), blob.size());
+}
+} // namespace
+
+/**
+ * @brief Prepares the database and loads the unfinished transfers.
+ * @param db Database of the profile.
+ */
+TransferStore::TransferStore(std::shared_ptr<RawDatabase> db)
+    : db{db}
+{
+    if (!isValid()) {
+        qWarning() << "Database not open, can't remember file transfers";
+        return;
+    }
+
+    db->execNow("CREATE TABLE IF NOT EXISTS file_transfers (file_id BLOB PRIMARY KEY, "
+                "friend_pk TEXT NOT NULL, direction INTEGER NOT NULL, file_name BLOB NOT NULL, "
+                "file_path BLOB NOT NULL, file_size INTEGER NOT NULL, "
+                "bytes_done INTEGER NOT NULL, checksum BLOB);");
+
+    db->execNow(RawDatabase::Query{
+        "SELECT file_id, friend_pk, direction, file_name, file_path, file_size, bytes_done, "
+        "checksum FROM file_transfers;",
+        [this](const QVector<QVariant>& row) {
+            Transfer transfer;
+            transfer.fileId = copyBlob(row[0]);
+            transfer.friendPk = ToxPk{QByteArray::fromHex(row[1].toString().toLatin1())};
+            transfer.direction = row[2].toInt() ? ToxFile::RECEIVING : ToxFile::SENDING;
+            transfer.fileName = copyBlob(row[3]);
+            transfer.filePath = QString::fromUtf8(copyBlob(row[4]));
+            transfer.filesize = row[5].toULongLong();
+            transfer.bytesDone = row[6].toULongLong();
+            transfer.checksum = copyBlob(row[7]);
+            transfers.insert(transfer.fileId, transfer);
+        }});
+
+    if (!transfers.isEmpty()) {
+        qDebug() << "Found" << transfers.size() << "unfinished file transfers";
+    }
+}
+
+/**
+ * @brief Checks if the database was opened successfully.
+ */
+bool TransferStore::isValid() const
+{
+    return db && db->isOpen();
+}
+
+/**
+ * @brief Remembers a new transfer, replacing a transfer with the same file ID.
+ */
+void TransferStore::addTransfer(const Transfer& transfer)
+{
+    if (!isValid()) {
+        return;
+    }
+
+    {
+        QMutexLocker locker{&mutex};
+        transfers.insert(transfer.fileId, transfer);
+    }
+
+    db->execLater(RawDatabase::Query{
+        QString("INSERT OR REPLACE INTO file_transfers (file_id, friend_pk, direction, file_name, "
+                "file_path, file_size, bytes_done, checksum) "
+                "VALUES (?, '%1', %2, ?, ?, %3, %4, ?);")
+            .arg(transfer.friendPk.toString())
+            .arg(transfer.direction == ToxFile::RECEIVING ? 1 : 0)
+            .arg(transfer.filesize)
+            .arg(transfer.bytesDone),
+        QVector<QByteArray>{transfer.fileId, transfer.fileName, transfer.filePath.toUtf8(),
+                            transfer.checksum}});
+}
+
+/**
+ * @brief Records how much of an incoming transfer is safely on disk.
+ */
+void TransferStore::updateProgress(const QByteArray& fileId, quint64 bytesDone,
+                                   const QByteArray& checksum)
+{
+    if (!isValid()) {
+        return;
+    }
+
+    {
+        QMutexLocker locker{&mutex};
+        auto it = transfers.find(fileId);
+        if (it == transfers.end() || it->bytesDone == bytesDone) {
+            return;
+        }
+
+        it->bytesDone = bytesDone;
+        it->checksum = checksum;
+    }
+
+    db->execLater(RawDatabase::Query{
+        QString("UPDATE file_transfers SET bytes_done = %1, checksum = ? WHERE file_id = ?;")
+            .arg(bytesDone),
+        QVector<QByteArray>{checksum, fileId}});
+}
+
+/**
+ * @brief Forgets a transfer that finished or was cancelled.
+ */
+void TransferStore::removeTransfer(const QByteArray& fileId)
+{
+    if (!isValid()) {
+        return;
+    }
+
+    {
+        QMutexLocker locker{&mutex};
+        if (!transfers.remove(fileId)) {
+            return;
+        }
+    }
+
+    db->execLater(RawDatabase::Query{"DELETE FROM file_transfers WHERE file_id = ?;",
+                                     QVector<QByteArray>{fileId}});
+}
+
+/**
+ * @brief Forgets all transfers with a friend, e.g. because the friend was removed.
+ */
+void TransferStore::removeTransfers(const ToxPk& friendPk)
+{
+    if (!isValid()) {
+        return;
+    }
+
+    {
+        QMutexLocker locker{&mutex};
+        bool found = false;
+        for (auto it = transfers.begin(); it != transfers.end();) {
+            if (it->friendPk == friendPk) {
+                it = transfers.erase(it);
+                found = true;
+            } else {
+                ++it;
+            }
+        }
+
+        if (!found) {
+            return;
+        }
+    }
+
+    db->execLater(QString("DELETE FROM file_transfers WHERE friend_pk = '%1';")
+                      .arg(friendPk.toString()));
+}
+
+/**
+ * @brief Looks up an unfinished transfer.
+ * @param fileId Tox file ID of the transfer.
+ * @param transfer Set to the transfer, if found.
+ * @return True if the transfer is known.
+ */
+bool TransferStore::findTransfer(const QByteArray& fileId, Transfer& transfer) const
+{
+    QMutexLocker locker{&mutex};
+    auto it = transfers.constFind(fileId);
+    if (it == transfers.constEnd()) {
+        return false;
+    }
+
+    transfer = *it;
+    return true;
+}
+
+/**
+ * @brief Returns the unfinished transfers with a friend in one direction.
+ */
+QVector<TransferStore::Transfer> TransferStore::getTransfers(const ToxPk& friendPk,
+                                                             ToxFile::FileDirection direction) const
+{
+    QMutexLocker locker{&mutex};
+    QVector<Transfer> result;
+    for (const Transfer& transfer : transfers) {
+        if (transfer.friendPk == friendPk && transfer.direction == direction) {
+            result.append(transfer);
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,69 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TRANSFERSTORE_H
+#define TRANSFERSTORE_H
+
+#include "src/core/toxfile.h"
+#include "src/core/toxpk.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+#include <memory>
+
+class RawDatabase;
+
+class TransferStore
+{
+public:
+    struct Transfer
+    {
+        QByteArray fileId;
+        ToxPk friendPk;
+        ToxFile::FileDirection direction;
+        QByteArray fileName;
+        QString filePath;
+        quint64 filesize;
+        quint64 bytesDone;
+        QByteArray checksum;
+    };
+
+    explicit TransferStore(std::shared_ptr<RawDatabase> db);
+
+    bool isValid() const;
+
+    void addTransfer(const Transfer& transfer);
+    void updateProgress(const QByteArray& fileId, quint64 bytesDone, const QByteArray& checksum);
+    void removeTransfer(const QByteArray& fileId);
+    void removeTransfers(const ToxPk& friendPk);
+
+    bool findTransfer(const QByteArray& fileId, Transfer& transfer) const;
+    QVector<Transfer> getTransfers(const ToxPk& friendPk, ToxFile::FileDirection direction) const;
+
+private:
+    std::shared_ptr<RawDatabase> db;
+    mutable QMutex mutex;
+    QHash<QByteArray, Transfer> transfers;
+};
+
+#endif // TRANSFERSTORE_H
@@ -24,6 +24,8 @@ extern "C" {
 #include <libswscale/swscale.h>
 }
 
+#include <vector>
+
 /**
  * @struct ToxYUVFrame
  * @brief A simple structure to represent a ToxYUV video frame (corresponds to a frame encoded
@@ -410,6 +412,59 @@ int VideoFrame::getSourcePixelFormat() const
     return sourcePixelFormat;
 }
 
+/**
+ * @brief Sums up the frame buffers of all tracked frames.
+ *
+ * @return the number of tracked frames and the size of their source and converted frames.
+ */
+MemoryUsage::Entry VideoFrame::getMemoryUsage()
+{
+    // Hold references while counting, so no frame is released under the locks taken by its
+    // destructor
+    std::vector<std::shared_ptr<VideoFrame>> frames;
+
+    refsLock.lockForRead();
+
+    for (auto& sourceIterator : refsMap) {
+        QMutex& sourceMutex = mutexMap[sourceIterator.first];
+
+        sourceMutex.lock();
+
+        for (auto& frameIterator : sourceIterator.second) {
+            std::shared_ptr<VideoFrame> frame = frameIterator.second.lock();
+
+            if (frame) {
+                frames.push_back(frame);
+            }
+        }
+
+        sourceMutex.unlock();
+    }
+
+    refsLock.unlock();
+
+    qint64 bytes = 0;
+
+    for (const std::shared_ptr<VideoFrame>& frame : frames) {
+        frame->frameLock.lockForRead();
+
+        for (const auto& frameIterator : frame->frameBuffer) {
+            const FrameBufferKey& key = frameIterator.first;
+            const int size =
+                av_image_get_buffer_size(static_cast<AVPixelFormat>(key.pixelFormat),
+                                         key.frameWidth, key.frameHeight, 1);
+
+            if (size > 0) {
+                bytes += size;
+            }
+        }
+
+        frame->frameLock.unlock();
+    }
+
+    return {"video", "frames", static_cast<qint64>(frames.size()), bytes};
+}
+
 
 /**
  * @brief Constructs a new FrameBufferKey with the given attributes.
@@ -20,6 +20,8 @@
 #ifndef VIDEOFRAME_H
 #define VIDEOFRAME_H
 
+#include "src/core/memoryusage.h"
+
 #include <QImage>
 #include <QMutex>
 #include <QReadWriteLock>
@@ -89,6 +91,8 @@ public:
     QRect getSourceDimensions() const;
     int getSourcePixelFormat() const;
 
+    static MemoryUsage::Entry getMemoryUsage();
+
     static constexpr int dataAlignment = 32;
 
 private:
@@ -458,6 +458,23 @@ void ContentDialog::updateFriendStatusMessage(int friendId, const QString& messa
     std::get<1>(iter.value())->setStatusMsg(message);
 }
 
+/**
+ * @brief Update friend avatar.
+ * @param friendId Id friend, whose avatar was loaded.
+ * @param friendPk Public key of the friend.
+ * @param pic Avatar.
+ */
+void ContentDialog::updateFriendAvatar(int friendId, const ToxPk& friendPk, const QPixmap& pic)
+{
+    auto iter = friendList.find(friendId);
+
+    if (iter == friendList.end()) {
+        return;
+    }
+
+    static_cast<FriendWidget*>(std::get<1>(iter.value()))->onAvatarChange(friendPk, pic);
+}
+
 void ContentDialog::updateGroupStatus(int groupId)
 {
     updateStatus(groupId, groupList);
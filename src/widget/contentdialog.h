@@ -42,8 +42,10 @@ class GenericChatroomWidget;
 class Group;
 class GroupChatroom;
 class GroupWidget;
+class QPixmap;
 class QSplitter;
 class QVBoxLayout;
+class ToxPk;
 
 using ContactInfo = std::tuple<ContentDialog*, GenericChatroomWidget*>;
 
@@ -75,6 +77,7 @@ public:
     static void focusGroup(int groupId);
     static void updateFriendStatus(int friendId);
     static void updateFriendStatusMessage(int friendId, const QString& message);
+    static void updateFriendAvatar(int friendId, const ToxPk& friendPk, const QPixmap& pic);
     static void updateGroupStatus(int groupId);
     static bool isFriendWidgetActive(int friendId);
     static bool isGroupWidgetActive(int groupId);
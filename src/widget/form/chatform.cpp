@@ -125,6 +125,8 @@ ChatForm::ChatForm(Friend* chatFriend, History* history)
     , lastCallIsVideo{false}
 {
     setName(f->getDisplayedName());
+    // identifies the chat in the memory usage without revealing the name
+    chatWidget->setObjectName(QStringLiteral("friend %1").arg(f->getId()));
 
     headWidget->setAvatar(QPixmap(":/img/contact_dark.svg"));
 
@@ -156,22 +158,13 @@ ChatForm::ChatForm(Friend* chatFriend, History* history)
     exportChatAction =
         menu.addAction(QIcon::fromTheme("document-save"), QString(), this, SLOT(onExportChat()));
 
+    // Widget forwards messages, file transfers and calls, the form may not exist when they arrive
     const Core* core = Core::getInstance();
-    connect(core, &Core::fileReceiveRequested, this, &ChatForm::onFileRecvRequest);
     // TODO(sudden6): update slot to new API
     connect(core, &Core::friendAvatarChangedDeprecated, this, &ChatForm::onAvatarChange);
     connect(core, &Core::friendAvatarRemoved, this, &ChatForm::onAvatarRemoved);
-    connect(core, &Core::fileSendStarted, this, &ChatForm::startFileSend);
-    connect(core, &Core::fileSendFailed, this, &ChatForm::onFileSendFailed);
-    connect(core, &Core::receiptRecieved, this, &ChatForm::onReceiptReceived);
-    connect(core, &Core::friendMessageReceived, this, &ChatForm::onFriendMessageReceived);
-    connect(core, &Core::friendTypingChanged, this, &ChatForm::onFriendTypingChanged);
-    connect(core, &Core::friendStatusChanged, this, &ChatForm::onFriendStatusChanged);
-    connect(core, &Core::fileNameChanged, this, &ChatForm::onFileNameChanged);
-
 
     const CoreAV* av = core->getAv();
-    connect(av, &CoreAV::avInvite, this, &ChatForm::onAvInvite);
     connect(av, &CoreAV::avStart, this, &ChatForm::onAvStart);
     connect(av, &CoreAV::avEnd, this, &ChatForm::onAvEnd);
 
@@ -614,13 +607,6 @@ void ChatForm::onFriendStatusChanged(uint32_t friendId, Status status)
     }
 }
 
-void ChatForm::onFriendTypingChanged(quint32 friendId, bool isTyping)
-{
-    if (friendId == f->getId()) {
-        setFriendTyping(isTyping);
-    }
-}
-
 void ChatForm::onFriendNameChanged(const QString& name)
 {
     if (sender() == f) {
@@ -645,13 +631,6 @@ void ChatForm::onStatusMessage(const QString& message)
     }
 }
 
-void ChatForm::onReceiptReceived(quint32 friendId, int receipt)
-{
-    if (friendId == f->getId()) {
-        offlineEngine->dischargeReceipt(receipt);
-    }
-}
-
 void ChatForm::onAvatarChange(uint32_t friendId, const QPixmap& pic)
 {
     if (friendId != f->getId()) {
@@ -1043,6 +1022,24 @@ OfflineMsgEngine* ChatForm::getOfflineMsgEngine()
     return offlineEngine;
 }
 
+/**
+ * @brief Checks if the form holds state that would be lost when it's destroyed.
+ * @return True if there is a draft, an undelivered message, a call or a file transfer, or if
+ * the messages couldn't be loaded again because there's no history.
+ */
+bool ChatForm::hasLiveState() const
+{
+    // isHistoryEnabled() would block until the database is opened, keep the form until then
+    Profile* profile = Nexus::getProfile();
+    if (!profile->isDatabaseLoaded() || !profile->isHistoryEnabled()) {
+        return true;
+    }
+
+    return !msgEdit->toPlainText().isEmpty() || offlineEngine->hasUndeliveredMsgs()
+           || Core::getInstance()->getAv()->isCallStarted(f)
+           || Core::getInstance()->hasFileTransfers(f->getId());
+}
+
 void ChatForm::SendMessageStr(QString msg)
 {
     if (msg.isEmpty()) {
@@ -52,6 +52,7 @@ public:
     void dischargeReceipt(int receipt);
     void setFriendTyping(bool isTyping);
     OfflineMsgEngine* getOfflineMsgEngine();
+    bool hasLiveState() const;
 
     virtual void show(ContentLayout* contentLayout) final override;
 
@@ -75,6 +76,9 @@ public slots:
     void onAvatarChange(uint32_t friendId, const QPixmap& pic);
     void onAvatarRemoved(const ToxPk& friendPk);
     void onFileNameChanged(const ToxPk& friendPk);
+    void onFileSendFailed(uint32_t friendId, const QString& fname);
+    void onFriendStatusChanged(quint32 friendId, Status status);
+    void onFriendMessageReceived(quint32 friendId, const QString& message, bool isAction);
 
 protected slots:
     void searchInBegin(const QString& phrase, const ParameterSearch& parameter) override;
@@ -95,13 +99,8 @@ private slots:
     void onMicMuteToggle();
     void onVolMuteToggle();
 
-    void onFileSendFailed(uint32_t friendId, const QString& fname);
-    void onFriendStatusChanged(quint32 friendId, Status status);
-    void onFriendTypingChanged(quint32 friendId, bool isTyping);
     void onFriendNameChanged(const QString& name);
-    void onFriendMessageReceived(quint32 friendId, const QString& message, bool isAction);
     void onStatusMessage(const QString& message);
-    void onReceiptReceived(quint32 friendId, int receipt);
     void onLoadHistory();
     void onUpdateTime();
     void sendImage(const QPixmap& pixmap);
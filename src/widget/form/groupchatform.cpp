@@ -79,6 +79,9 @@ QString editName(const QString& name)
  *
  * @var QMap<int, QTimer*> GroupChatForm::peerAudioTimers
  * @brief Timeout = peer stopped sending audio.
+ *
+ * @var QMap<ToxPk, qreal> GroupChatForm::peerGains
+ * @brief Volumes chosen for peers in the group call, peers not in here play at full volume.
  */
 
 GroupChatForm::GroupChatForm(Group* chatGroup)
@@ -86,6 +89,7 @@ GroupChatForm::GroupChatForm(Group* chatGroup)
     , group(chatGroup)
     , inCall(false)
 {
+    chatWidget->setObjectName(QStringLiteral("group %1").arg(group->getId()));
     nusersLabel = new QLabel();
 
     tabber = new TabCompleter(msgEdit, group);
@@ -185,6 +189,9 @@ void GroupChatForm::onUserListChanged()
         Core::getInstance()->getAv()->leaveGroupCall(group->getId());
         hideNetcam();
     }
+
+    // peer numbers change when someone leaves
+    applyPeerGains();
 }
 
 void GroupChatForm::onTitleChanged(uint32_t groupId, const QString& author, const QString& title)
@@ -387,6 +394,7 @@ void GroupChatForm::onCallClicked()
         audioInputFlag = true;
         audioOutputFlag = true;
         inCall = true;
+        applyPeerGains();
         showNetcam();
     } else {
         av->leaveGroupCall(group->getId());
@@ -502,6 +510,19 @@ void GroupChatForm::onLabelContextMenuRequested(const QPoint& localPos)
     } else {
         toggleMuteAction = contextMenu->addAction(muteString);
     }
+
+    const QMenu* volumeMenu = nullptr;
+    if (group->isAvGroupchat()) {
+        QMenu* const menu = contextMenu->addMenu(tr("Volume"));
+        const qreal currentGain = peerGains.value(peerPk, 1.0);
+        for (int percent : {25, 50, 100, 150, 200}) {
+            QAction* const action = menu->addAction(tr("%1%").arg(percent));
+            action->setData(percent / 100.0);
+            action->setCheckable(true);
+            action->setChecked(qFuzzyCompare(currentGain, percent / 100.0));
+        }
+        volumeMenu = menu;
+    }
     contextMenu->setStyleSheet(Style::getStylesheet(PEER_LABEL_STYLE_SHEET_PATH));
 
     const QAction* selectedItem = contextMenu->exec(pos);
@@ -516,5 +537,31 @@ void GroupChatForm::onLabelContextMenuRequested(const QPoint& localPos)
         }
 
         s.setBlackList(blackList);
+    } else if (selectedItem && volumeMenu && selectedItem->parent() == volumeMenu) {
+        peerGains[peerPk] = selectedItem->data().toReal();
+        applyPeerGains();
+    }
+}
+
+/**
+ * @brief Sends the volumes chosen for peers to the group call.
+ *
+ * The call knows peers by their number in the group only, so this has to be repeated whenever
+ * the peer list changes.
+ */
+void GroupChatForm::applyPeerGains()
+{
+    if (!inCall || peerGains.isEmpty()) {
+        return;
+    }
+
+    const Core* core = Core::getInstance();
+    const int groupId = group->getId();
+    const int peersCount = group->getPeersCount();
+    for (int peer = 0; peer < peersCount; ++peer) {
+        auto it = peerGains.constFind(core->getGroupPeerPk(groupId, peer));
+        if (it != peerGains.constEnd()) {
+            CoreAV::setGroupCallPeerGain(groupId, peer, it.value());
+        }
     }
 }
@@ -67,11 +67,13 @@ private:
     void retranslateUi();
     void updateUserCount();
     void updateUserNames();
+    void applyPeerGains();
 
 private:
     Group* group;
     QMap<ToxPk, QLabel*> peerLabels;
     QMap<ToxPk, QTimer*> peerAudioTimers;
+    QMap<ToxPk, qreal> peerGains;
     FlowLayout* namesListLayout;
     QLabel* nusersLabel;
     TabCompleter* tabber;
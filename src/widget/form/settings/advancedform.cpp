@@ -29,6 +29,7 @@
 
 #include "src/core/core.h"
 #include "src/core/coreav.h"
+#include "src/core/memoryusage.h"
 #include "src/core/recursivesignalblocker.h"
 #include "src/nexus.h"
 #include "src/persistence/profile.h"
@@ -43,6 +44,13 @@
  * Is also contains "Reset settings" button and "Make portable" checkbox.
  */
 
+namespace {
+QString formatSize(qint64 bytes)
+{
+    return AdvancedForm::tr("%1 KiB", "memory usage").arg(bytes / 1024.0, 0, 'f', 1);
+}
+} // namespace
+
 AdvancedForm::AdvancedForm()
     : GenericForm(QPixmap(":/img/settings/general.png"))
     , bodyUI(new Ui::AdvancedSettings)
@@ -124,6 +132,41 @@ void AdvancedForm::on_btnExportLog_clicked()
         qDebug() << "File was not copied";
 }
 
+/**
+ * @brief Shows what the caches and buffers hold right now.
+ */
+void AdvancedForm::on_btnRefreshMemory_clicked()
+{
+    QString rows;
+    qint64 total = 0;
+    for (const MemoryUsage::Entry& entry : MemoryUsage::collect()) {
+        rows += QString("<tr><td>%1</td><td>%2</td><td align=\"right\">%3</td>"
+                        "<td align=\"right\">%4</td></tr>")
+                    .arg(entry.subsystem.toHtmlEscaped(), entry.name.toHtmlEscaped())
+                    .arg(entry.count)
+                    .arg(formatSize(entry.bytes));
+        total += entry.bytes;
+    }
+
+    const QString header = QString("<tr><th align=\"left\">%1</th><th align=\"left\">%2</th>"
+                                   "<th align=\"right\">%3</th><th align=\"right\">%4</th></tr>")
+                               .arg(tr("Subsystem"), tr("Name"), tr("Items"), tr("Size"));
+    bodyUI->memoryUsageLabel->setText(QString("<table cellspacing=\"4\">%1%2</table><p>%3</p>")
+                                          .arg(header, rows)
+                                          .arg(tr("Total: %1").arg(formatSize(total))));
+}
+
+void AdvancedForm::on_btnCopyMemory_clicked()
+{
+    QClipboard* clipboard = QApplication::clipboard();
+    if (!clipboard) {
+        qDebug() << "Unable to access clipboard";
+        return;
+    }
+
+    clipboard->setText(QString::fromUtf8(MemoryUsage::toJson(MemoryUsage::collect())));
+}
+
 void AdvancedForm::on_btnCopyDebug_clicked()
 {
     QString logFileDir = Settings::getInstance().getAppCacheDirPath();
@@ -154,6 +197,11 @@ void AdvancedForm::on_btnCopyDebug_clicked()
     }
 }
 
+void AdvancedForm::showEvent(QShowEvent*)
+{
+    on_btnRefreshMemory_clicked();
+}
+
 void AdvancedForm::on_resetButton_clicked()
 {
     const QString titile = tr("Reset settings");
@@ -235,4 +283,5 @@ void AdvancedForm::retranslateUi()
     int proxyType = bodyUI->proxyType->currentIndex();
     bodyUI->retranslateUi(this);
     bodyUI->proxyType->setCurrentIndex(proxyType);
+    on_btnRefreshMemory_clicked();
 }
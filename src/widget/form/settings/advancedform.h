@@ -46,6 +46,9 @@ private slots:
     // Debug
     void on_btnCopyDebug_clicked();
     void on_btnExportLog_clicked();
+    // Memory usage
+    void on_btnRefreshMemory_clicked();
+    void on_btnCopyMemory_clicked();
     // Connection
     void on_cbEnableIPv6_stateChanged();
     void on_cbEnableUDP_stateChanged();
@@ -57,6 +60,7 @@ private slots:
 
 private:
     void retranslateUi();
+    void showEvent(QShowEvent*) final override;
 
 private:
     Ui::AdvancedSettings* bodyUI;
@@ -147,8 +147,10 @@ GeneralForm::GeneralForm(SettingsWidget* myParent)
     bodyUI->cbFauxOfflineMessaging->setChecked(s.getFauxOfflineMessaging());
 
     bodyUI->autoAwaySpinBox->setValue(s.getAutoAwayTime());
+    bodyUI->chatIdleSpinBox->setValue(s.getChatIdleTime());
     bodyUI->autoSaveFilesDir->setText(s.getGlobalAutoAcceptDir());
     bodyUI->autoacceptFiles->setChecked(s.getAutoSaveEnabled());
+    bodyUI->hashReceivedFiles->setChecked(s.getHashReceivedFiles());
 
 #ifndef QTOX_PLATFORM_EXT
     bodyUI->autoAwayLabel->setEnabled(
@@ -226,11 +228,22 @@ void GeneralForm::on_autoAwaySpinBox_editingFinished()
     Settings::getInstance().setAutoAwayTime(minutes);
 }
 
+void GeneralForm::on_chatIdleSpinBox_editingFinished()
+{
+    int minutes = bodyUI->chatIdleSpinBox->value();
+    Settings::getInstance().setChatIdleTime(minutes);
+}
+
 void GeneralForm::on_autoacceptFiles_stateChanged()
 {
     Settings::getInstance().setAutoSaveEnabled(bodyUI->autoacceptFiles->isChecked());
 }
 
+void GeneralForm::on_hashReceivedFiles_stateChanged()
+{
+    Settings::getInstance().setHashReceivedFiles(bodyUI->hashReceivedFiles->isChecked());
+}
+
 void GeneralForm::on_autoSaveFilesDir_clicked()
 {
     QString previousDir = Settings::getInstance().getGlobalAutoAcceptDir();
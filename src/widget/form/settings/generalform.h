@@ -48,11 +48,13 @@ private slots:
     void on_closeToTray_stateChanged();
     void on_lightTrayIcon_stateChanged();
     void on_autoAwaySpinBox_editingFinished();
+    void on_chatIdleSpinBox_editingFinished();
     void on_minimizeToTray_stateChanged();
     void on_statusChanges_stateChanged();
     void on_cbFauxOfflineMessaging_stateChanged();
 
     void on_autoacceptFiles_stateChanged();
+    void on_hashReceivedFiles_stateChanged();
     void on_autoSaveFilesDir_clicked();
     void on_checkUpdates_stateChanged();
 
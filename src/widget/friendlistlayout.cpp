@@ -17,6 +17,7 @@
 #include "friendwidget.h"
 #include "src/model/friend.h"
 #include "src/friendlist.h"
+#include <QSet>
 #include <cassert>
 
 FriendListLayout::FriendListLayout()
@@ -59,6 +60,31 @@ void FriendListLayout::addFriendWidget(FriendWidget* w, Status s)
     friendOnlineLayout.addSortedWidget(w);
 }
 
+/**
+ * @brief Moves many widgets to their place at once, by the current status of their friend.
+ *
+ * The widgets may be in this layout already, with a different status or name.
+ */
+void FriendListLayout::addFriendWidgets(const QVector<FriendWidget*>& widgets)
+{
+    QSet<GenericChatItemWidget*> moving;
+    QVector<GenericChatItemWidget*> online;
+    QVector<GenericChatItemWidget*> offline;
+    for (FriendWidget* widget : widgets) {
+        moving.insert(widget);
+        if (widget->getFriend()->getStatus() == Status::Offline) {
+            offline.append(widget);
+        } else {
+            online.append(widget);
+        }
+    }
+
+    friendOfflineLayout.removeSortedWidgets(moving);
+    friendOnlineLayout.removeSortedWidgets(moving);
+    friendOfflineLayout.addSortedWidgets(offline);
+    friendOnlineLayout.addSortedWidgets(online);
+}
+
 void FriendListLayout::removeFriendWidget(FriendWidget* widget, Status s)
 {
     if (s == Status::Offline)
@@ -18,6 +18,7 @@
 #include "genericchatitemlayout.h"
 #include "src/core/core.h"
 #include <QBoxLayout>
+#include <QVector>
 
 class FriendWidget;
 class FriendListWidget;
@@ -30,6 +31,7 @@ public:
     explicit FriendListLayout(QWidget* parent);
 
     void addFriendWidget(FriendWidget* widget, Status s);
+    void addFriendWidgets(const QVector<FriendWidget*>& widgets);
     void removeFriendWidget(FriendWidget* widget, Status s);
     int indexOfFriendWidget(GenericChatItemWidget* widget, bool online) const;
     void moveFriendWidgets(FriendListWidget* listWidget);
@@ -27,12 +27,16 @@
 #include "src/model/friend.h"
 #include "src/model/group.h"
 #include "src/persistence/settings.h"
+#include <QCollator>
 #include <QDragEnterEvent>
 #include <QDragLeaveEvent>
 #include <QGridLayout>
 #include <QMimeData>
 #include <QTimer>
+#include <algorithm>
 #include <cassert>
+#include <utility>
+#include <vector>
 
 enum class Time
 {
@@ -298,6 +302,36 @@ void FriendListWidget::addFriendWidget(FriendWidget* w, Status s, int circleInde
         circleWidget->addFriendWidget(w, s);
 }
 
+/**
+ * @brief Adds many friend widgets at once, each with the status and circle of its friend.
+ *
+ * Sorted up front, every widget is appended to its layout instead of being inserted in the middle.
+ */
+void FriendListWidget::addFriendWidgets(const QVector<FriendWidget*>& widgets)
+{
+    QCollator collator;
+    collator.setNumericMode(true);
+    std::vector<std::pair<QCollatorSortKey, FriendWidget*>> sorted;
+    sorted.reserve(widgets.size());
+    for (FriendWidget* widget : widgets) {
+        sorted.emplace_back(collator.sortKey(widget->getName()), widget);
+    }
+
+    // same order as GenericChatItemLayout, equal names are ordered by address
+    std::sort(sorted.begin(), sorted.end(),
+              [](const std::pair<QCollatorSortKey, FriendWidget*>& a,
+                 const std::pair<QCollatorSortKey, FriendWidget*>& b) {
+                  const int compare = a.first.compare(b.first);
+                  return compare < 0 || (compare == 0 && a.second < b.second);
+              });
+
+    const Settings& s = Settings::getInstance();
+    for (const auto& entry : sorted) {
+        const Friend* f = entry.second->getFriend();
+        addFriendWidget(entry.second, f->getStatus(), s.getFriendCircleID(f->getPublicKey()));
+    }
+}
+
 void FriendListWidget::removeGroupWidget(GroupWidget* w)
 {
     groupLayout.removeSortedWidget(w);
@@ -607,6 +641,41 @@ void FriendListWidget::moveWidget(FriendWidget* widget, Status s, bool add)
     }
 }
 
+/**
+ * @brief Puts many friend widgets in their place at once, e.g. after a batch of status changes.
+ *
+ * Friends outside of circles, usually most of them, are re-sorted in one go. Circles and the
+ * activity categories place their widgets one by one as with moveWidget().
+ */
+void FriendListWidget::moveWidgets(const QVector<FriendWidget*>& widgets)
+{
+    if (mode != Name) {
+        for (FriendWidget* widget : widgets) {
+            moveWidget(widget, widget->getFriend()->getStatus());
+        }
+        return;
+    }
+
+    Settings& s = Settings::getInstance();
+    QVector<FriendWidget*> listed;
+    for (FriendWidget* widget : widgets) {
+        const Friend* f = widget->getFriend();
+        int circleId = s.getFriendCircleID(f->getPublicKey());
+        CircleWidget* circleWidget = CircleWidget::getFromID(circleId);
+        if (circleWidget) {
+            circleWidget->addFriendWidget(widget, f->getStatus());
+            continue;
+        }
+
+        if (circleId != -1)
+            s.setFriendCircleID(f->getPublicKey(), -1);
+
+        listed.append(widget);
+    }
+
+    listLayout->addFriendWidgets(listed);
+}
+
 void FriendListWidget::updateActivityDate(const QDate& date)
 {
     if (mode != Activity)
@@ -22,6 +22,7 @@
 
 #include "genericchatitemlayout.h"
 #include "src/core/core.h"
+#include <QVector>
 #include <QWidget>
 
 class QVBoxLayout;
@@ -51,6 +52,7 @@ public:
 
     void addGroupWidget(GroupWidget* widget);
     void addFriendWidget(FriendWidget* w, Status s, int circleIndex);
+    void addFriendWidgets(const QVector<FriendWidget*>& widgets);
     void removeGroupWidget(GroupWidget* w);
     void removeFriendWidget(FriendWidget* w);
     void addCircleWidget(int id);
@@ -72,6 +74,7 @@ public slots:
     void renameCircleWidget(CircleWidget* circleWidget, const QString& newName);
     void onGroupchatPositionChanged(bool top);
     void moveWidget(FriendWidget* w, Status s, bool add = false);
+    void moveWidgets(const QVector<FriendWidget*>& widgets);
 
 protected:
     void dragEnterEvent(QDragEnterEvent* event) override;
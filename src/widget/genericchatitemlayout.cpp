@@ -16,6 +16,9 @@
 #include "genericchatitemwidget.h"
 #include <QBoxLayout>
 #include <QCollator>
+#include <QSet>
+#include <QVector>
+#include <algorithm>
 #include <cassert>
 
 // As this layout sorts widget, extra care must be taken when inserting widgets.
@@ -23,6 +26,14 @@
 // Inserting widgets other ways would cause this layout to be unable to sort.
 // As such, they are protected using asserts.
 
+namespace {
+bool lessThan(const QCollator& collator, GenericChatItemWidget* a, GenericChatItemWidget* b)
+{
+    const int compareValue = collator.compare(a->getName(), b->getName());
+    return compareValue < 0 || (compareValue == 0 && a < b); // Consistent ordering.
+}
+} // namespace
+
 GenericChatItemLayout::GenericChatItemLayout()
     : layout(new QVBoxLayout())
 {
@@ -83,6 +94,47 @@ void GenericChatItemLayout::removeSortedWidget(GenericChatItemWidget* widget)
         layout->removeWidget(widget);
 }
 
+/**
+ * @brief Adds many widgets at once, e.g. all friends whose status changed in one go.
+ *
+ * The widgets are sorted among themselves first, so each one is only searched for in the part
+ * of the layout after the previous one, and all share a single collator.
+ */
+void GenericChatItemLayout::addSortedWidgets(const QVector<GenericChatItemWidget*>& widgets)
+{
+    QCollator collator;
+    collator.setNumericMode(true);
+    QVector<GenericChatItemWidget*> sorted = widgets;
+    std::sort(sorted.begin(), sorted.end(),
+              [&collator](GenericChatItemWidget* a, GenericChatItemWidget* b) {
+                  return lessThan(collator, a, b);
+              });
+
+    int index = 0;
+    for (GenericChatItemWidget* widget : sorted) {
+        index = indexOfClosestSortedWidget(widget, collator, index);
+        layout->insertWidget(index, widget);
+        ++index;
+    }
+}
+
+/**
+ * @brief Removes many widgets at once in a single pass over the layout.
+ *
+ * Unlike removeSortedWidget(), this also finds widgets whose name changed since they were added.
+ */
+void GenericChatItemLayout::removeSortedWidgets(const QSet<GenericChatItemWidget*>& widgets)
+{
+    for (int index = layout->count() - 1; index >= 0; --index) {
+        GenericChatItemWidget* widgetAt =
+            qobject_cast<GenericChatItemWidget*>(layout->itemAt(index)->widget());
+        assert(widgetAt != nullptr);
+
+        if (widgets.contains(widgetAt))
+            delete layout->takeAt(index);
+    }
+}
+
 void GenericChatItemLayout::search(const QString& searchString, bool hideAll)
 {
     for (int index = 0; index < layout->count(); ++index) {
@@ -100,28 +152,24 @@ QLayout* GenericChatItemLayout::getLayout() const
 }
 
 int GenericChatItemLayout::indexOfClosestSortedWidget(GenericChatItemWidget* widget) const
+{
+    QCollator collator;
+    collator.setNumericMode(true);
+    return indexOfClosestSortedWidget(widget, collator, 0);
+}
+
+int GenericChatItemLayout::indexOfClosestSortedWidget(GenericChatItemWidget* widget,
+                                                      const QCollator& collator, int min) const
 {
     // Binary search: Deferred test of equality.
-    int min = 0, max = layout->count();
+    int max = layout->count();
     while (min < max) {
         int mid = (max - min) / 2 + min;
         GenericChatItemWidget* atMid =
             qobject_cast<GenericChatItemWidget*>(layout->itemAt(mid)->widget());
         assert(atMid != nullptr);
 
-        bool lessThan = false;
-
-        QCollator collator;
-        collator.setNumericMode(true);
-
-        int compareValue = collator.compare(atMid->getName(), widget->getName());
-
-        if (compareValue < 0)
-            lessThan = true;
-        else if (compareValue == 0)
-            lessThan = atMid < widget; // Consistent ordering.
-
-        if (lessThan)
+        if (lessThan(collator, atMid, widget))
             min = mid + 1;
         else
             max = mid;
@@ -16,9 +16,14 @@
 
 #include <Qt>
 
+class QCollator;
 class QLayout;
 class QVBoxLayout;
 class GenericChatItemWidget;
+template <typename T>
+class QSet;
+template <typename T>
+class QVector;
 
 class GenericChatItemLayout
 {
@@ -31,12 +36,16 @@ public:
     int indexOfSortedWidget(GenericChatItemWidget* widget) const;
     bool existsSortedWidget(GenericChatItemWidget* widget) const;
     void removeSortedWidget(GenericChatItemWidget* widget);
+    void addSortedWidgets(const QVector<GenericChatItemWidget*>& widgets);
+    void removeSortedWidgets(const QSet<GenericChatItemWidget*>& widgets);
     void search(const QString& searchString, bool hideAll = false);
 
     QLayout* getLayout() const;
 
 private:
     int indexOfClosestSortedWidget(GenericChatItemWidget* widget) const;
+    int indexOfClosestSortedWidget(GenericChatItemWidget* widget, const QCollator& collator,
+                                   int min) const;
     QVBoxLayout* layout;
 };
 
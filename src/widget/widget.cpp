@@ -51,6 +51,7 @@
 #include "src/audio/audio.h"
 #include "src/core/core.h"
 #include "src/core/coreav.h"
+#include "src/core/tracer.h"
 #include "src/model/chatroom/friendchatroom.h"
 #include "src/model/chatroom/groupchatroom.h"
 #include "src/model/friend.h"
@@ -106,6 +107,7 @@ Widget::Widget(QWidget* parent)
 
 void Widget::init()
 {
+    Tracer::Span span{"Widget::init"};
     ui->setupUi(this);
 
     QIcon themeIcon = QIcon::fromTheme("qtox");
@@ -116,6 +118,10 @@ void Widget::init()
     timer = new QTimer();
     timer->start(1000);
 
+    chatIdleTimer = new QTimer(this);
+    chatIdleTimer->setInterval(60 * 1000);
+    connect(chatIdleTimer, &QTimer::timeout, this, &Widget::releaseIdleChatForms);
+
     icon_size = 15;
 
     actionShow = new QAction(this);
@@ -240,6 +246,10 @@ void Widget::init()
     connect(actionLogout, &QAction::triggered, profileForm, &ProfileForm::onLogoutClicked);
 
     connect(profile, &Profile::selfAvatarChanged, profileForm, &ProfileForm::onSelfAvatarLoaded);
+    connect(profile, &Profile::avatarLoaded, this, &Widget::onAvatarLoaded);
+    // queued, the database can finish loading while a chat form is being created
+    connect(profile, &Profile::databaseLoaded, this, &Widget::loadUndeliveredChats,
+            Qt::QueuedConnection);
 
     const Settings& s = Settings::getInstance();
 
@@ -386,6 +396,7 @@ void Widget::init()
     // settings
     connect(&s, &Settings::showSystemTrayChanged, this, &Widget::onSetShowSystemTray);
     connect(&s, &Settings::separateWindowChanged, this, &Widget::onSeparateWindowClicked);
+    connect(&s, &Settings::chatIdleTimeChanged, this, &Widget::onChatIdleTimeChanged);
     connect(&s, &Settings::compactLayoutChanged, contactListWidget,
             &FriendListWidget::onCompactChanged);
     connect(&s, &Settings::groupchatPositionChanged, contactListWidget,
@@ -938,8 +949,8 @@ void Widget::setStatusMessage(const QString& statusMessage)
 
 void Widget::reloadHistory()
 {
-    for (auto f : FriendList::getAllFriends()) {
-        chatForms[f->getId()]->loadHistoryDefaultNum(true);
+    for (ChatForm* form : chatForms) {
+        form->loadHistoryDefaultNum(true);
     }
 }
 
@@ -973,6 +984,80 @@ void Widget::onStopNotification()
     Audio::getInstance().stopLoop();
 }
 
+/**
+ * @brief Shows an avatar loaded by the avatar cache on the widgets and the form of its owner.
+ *
+ * One connection for all friends, so a loaded avatar isn't offered to every widget.
+ */
+void Widget::onAvatarLoaded(const ToxPk& owner, const QPixmap& pixmap)
+{
+    const Friend* f = FriendList::findFriend(owner);
+    if (!f) {
+        return;
+    }
+
+    const uint32_t friendId = f->getId();
+    if (FriendWidget* widget = friendWidgets.value(friendId)) {
+        widget->onAvatarChange(owner, pixmap);
+    }
+
+    if (ChatForm* form = chatForms.value(friendId)) {
+        form->onAvatarChange(friendId, pixmap);
+    }
+
+    ContentDialog::updateFriendAvatar(friendId, owner, pixmap);
+}
+
+void Widget::onChatIdleTimeChanged(int minutes)
+{
+    if (minutes == 0) {
+        chatIdleTimer->stop();
+    } else if (!chatForms.isEmpty()) {
+        chatIdleTimer->start();
+    }
+}
+
+/**
+ * @brief Destroys the chat forms that weren't used for the configured idle time.
+ *
+ * Forms which are visible or have a draft, undelivered messages, a call or a file transfer are
+ * kept, their idle time starts again once they aren't anymore. Unread messages are tracked by
+ * the Friend, a released form is recreated from the history when it's needed again.
+ */
+void Widget::releaseIdleChatForms()
+{
+    const qint64 idleTime = Settings::getInstance().getChatIdleTime() * 60 * 1000;
+    for (auto it = chatFormsUsed.begin(); it != chatFormsUsed.end();) {
+        const uint32_t friendId = it.key();
+        ChatForm* form = chatForms.value(friendId);
+        if (!form) {
+            it = chatFormsUsed.erase(it);
+            continue;
+        }
+
+        if (idleTime == 0 || !it->hasExpired(idleTime)) {
+            ++it;
+            continue;
+        }
+
+        const bool visible = friendWidgets.value(friendId) == activeChatroomWidget
+                             || ContentDialog::getFriendDialog(friendId);
+        if (visible || form->hasLiveState()) {
+            it->start();
+            ++it;
+            continue;
+        }
+
+        chatForms.remove(friendId);
+        delete form;
+        it = chatFormsUsed.erase(it);
+    }
+
+    if (chatForms.isEmpty() || idleTime == 0) {
+        chatIdleTimer->stop();
+    }
+}
+
 void Widget::onRejectCall(uint32_t friendId)
 {
     CoreAV* const av = Core::getInstance()->getAv();
@@ -980,41 +1065,114 @@ void Widget::onRejectCall(uint32_t friendId)
 }
 
 void Widget::addFriend(uint32_t friendId, const ToxPk& friendPk)
+{
+    Tracer::Span span{"Widget::addFriend"};
+    Settings& s = Settings::getInstance();
+    FriendWidget* widget = createFriendWidget(friendId, friendPk);
+    contactListWidget->addFriendWidget(widget, Status::Offline, s.getFriendCircleID(friendPk));
+
+    FilterCriteria filter = getFilterCriteria();
+    widget->search(ui->searchContactText->text(), filterOffline(filter));
+
+    updateFriendActivity(widget->getFriend());
+}
+
+/**
+ * @brief Adds the friends loaded on startup, the contact list is laid out once for all of them.
+ *
+ * Chat forms are only created for friends with undelivered messages, the others get theirs once
+ * it's needed, see getChatForm().
+ */
+void Widget::addFriends(const QVector<FriendInfo>& friends)
+{
+    Tracer::Span span{"Widget::addFriends"};
+    contactListWidget->setUpdatesEnabled(false);
+
+    Settings& s = Settings::getInstance();
+    const QDate today = QDate::currentDate();
+    QVector<FriendWidget*> widgets;
+    widgets.reserve(friends.size());
+    QVector<ToxPk> inactive;
+    for (const FriendInfo& info : friends) {
+        FriendWidget* widget = createFriendWidget(info.friendId, info.friendPk);
+        widgets.append(widget);
+
+        // the list is sorted by name, so it's set before adding the widget
+        if (!info.username.isEmpty()) {
+            onFriendUsernameChanged(info.friendId, info.username);
+        }
+
+        onFriendStatusMessageChanged(info.friendId, info.statusMessage);
+
+        if (s.getFriendActivity(info.friendPk) != today) {
+            inactive.append(info.friendPk);
+        }
+    }
+
+    // like updateFriendActivity(), but once for all friends and before the widgets are placed
+    s.setFriendsActivity(inactive, today);
+
+    contactListWidget->addFriendWidgets(widgets);
+
+    const QString searchText = ui->searchContactText->text();
+    const bool hideOffline = filterOffline(getFilterCriteria());
+    for (FriendWidget* widget : widgets) {
+        widget->search(searchText, hideOffline);
+    }
+
+    loadUndeliveredChats();
+    contactListWidget->setUpdatesEnabled(true);
+}
+
+/**
+ * @brief Creates the chat forms of friends with undelivered messages, the form sends them when
+ * the friend comes online.
+ *
+ * Does nothing while the database is still being opened, it's called again once it's loaded.
+ */
+void Widget::loadUndeliveredChats()
+{
+    Profile* profile = Nexus::getProfile();
+    if (!profile->isDatabaseLoaded() || !profile->isHistoryEnabled()) {
+        return;
+    }
+
+    const QSet<QString> undelivered = profile->getHistory()->getUndeliveredChats();
+    for (Friend* f : FriendList::getAllFriends()) {
+        if (undelivered.contains(f->getPublicKey().toString())) {
+            getChatForm(f->getId());
+        }
+    }
+}
+
+/**
+ * @brief Creates the model and the contact list widget of a friend.
+ * @return The widget, still to be added to the contact list.
+ */
+FriendWidget* Widget::createFriendWidget(uint32_t friendId, const ToxPk& friendPk)
 {
     Settings& s = Settings::getInstance();
     s.updateFriendAddress(friendPk.toString());
 
     Friend* newfriend = FriendList::addFriend(friendId, friendPk);
     std::shared_ptr<FriendChatroom> chatroom(new FriendChatroom(newfriend));
-    const auto compact = Settings::getInstance().getCompactLayout();
+    const auto compact = s.getCompactLayout();
     auto widget = new FriendWidget(chatroom, compact);
-    auto history = Nexus::getProfile()->getHistory();
-    auto friendForm = new ChatForm(newfriend, history);
 
     friendChatrooms[friendId] = chatroom;
     friendWidgets[friendId] = widget;
-    chatForms[friendId] = friendForm;
-
-    QDate activityDate = s.getFriendActivity(friendPk);
-    QDate chatDate = friendForm->getLatestDate();
-    if (chatDate > activityDate && chatDate.isValid()) {
-        s.setFriendActivity(friendPk, chatDate);
-    }
-
-    contactListWidget->addFriendWidget(widget, Status::Offline, s.getFriendCircleID(friendPk));
 
     connect(newfriend, &Friend::aliasChanged, this, &Widget::onFriendAliasChanged);
     connect(newfriend, &Friend::displayedNameChanged, this, &Widget::onFriendDisplayedNameChanged);
 
-    connect(friendForm, &ChatForm::incomingNotification, this, &Widget::incomingNotification);
-    connect(friendForm, &ChatForm::outgoingNotification, this, &Widget::outgoingNotification);
-    connect(friendForm, &ChatForm::stopNotification, this, &Widget::onStopNotification);
-    connect(friendForm, &ChatForm::endCallNotification, this, &Widget::onCallEnd);
-    connect(friendForm, &ChatForm::rejectCall, this, &Widget::onRejectCall);
-
     connect(widget, &FriendWidget::newWindowOpened, this, &Widget::openNewDialog);
     connect(widget, &FriendWidget::chatroomWidgetClicked, this, &Widget::onChatroomWidgetClicked);
-    connect(widget, &FriendWidget::chatroomWidgetClicked, friendForm, &ChatForm::focusInput);
+    // connected after onChatroomWidgetClicked, which creates the form on the first click
+    connect(widget, &FriendWidget::chatroomWidgetClicked, this, [this, friendId] {
+        if (ChatForm* form = chatForms.value(friendId)) {
+            form->focusInput();
+        }
+    });
     connect(widget, &FriendWidget::copyFriendIdToClipboard, this, &Widget::copyFriendIdToClipboard);
     connect(widget, &FriendWidget::contextMenuCalled, widget, &FriendWidget::onContextMenuCalled);
     connect(widget, SIGNAL(removeFriend(int)), this, SLOT(removeFriend(int)));
@@ -1023,17 +1181,70 @@ void Widget::addFriend(uint32_t friendId, const ToxPk& friendPk)
     connect(core, &Core::friendAvatarChanged, widget, &FriendWidget::onAvatarChange);
     connect(core, &Core::friendAvatarRemoved, widget, &FriendWidget::onAvatarRemoved);
 
-    // Try to get the avatar from the cache
-    QPixmap avatar = Nexus::getProfile()->loadAvatar(friendPk);
+    // Try to get the avatar from the cache, it's loaded in the background if it isn't there yet,
+    // onAvatarLoaded() sets it then
+    Profile* profile = Nexus::getProfile();
+    QPixmap avatar = profile->requestAvatar(friendPk);
     if (!avatar.isNull()) {
-        friendForm->onAvatarChange(friendId, avatar);
         widget->onAvatarChange(friendPk, avatar);
     }
 
-    FilterCriteria filter = getFilterCriteria();
-    widget->search(ui->searchContactText->text(), filterOffline(filter));
+    return widget;
+}
+
+/**
+ * @brief Returns the chat form of a friend, creating it on first use.
+ * @return The form, or nullptr if there's no such friend.
+ *
+ * A form loads the chat history and keeps a chat log, so it's only created once the chat is
+ * opened or something has to be shown in it.
+ */
+ChatForm* Widget::getChatForm(uint32_t friendId)
+{
+    chatFormsUsed[friendId].start();
+    if (!chatIdleTimer->isActive() && Settings::getInstance().getChatIdleTime() > 0) {
+        chatIdleTimer->start();
+    }
+
+    ChatForm* form = chatForms.value(friendId);
+    if (form) {
+        return form;
+    }
 
-    updateFriendActivity(newfriend);
+    Friend* f = FriendList::findFriend(friendId);
+    if (!f) {
+        return nullptr;
+    }
+
+    Tracer::Span span{"Widget::getChatForm"};
+    auto history = Nexus::getProfile()->getHistory();
+    form = new ChatForm(f, history);
+    chatForms[friendId] = form;
+
+    const ToxPk friendPk = f->getPublicKey();
+    Settings& s = Settings::getInstance();
+    QDate activityDate = s.getFriendActivity(friendPk);
+    QDate chatDate = form->getLatestDate();
+    if (chatDate > activityDate && chatDate.isValid()) {
+        s.setFriendActivity(friendPk, chatDate);
+        contactListWidget->moveWidget(friendWidgets[friendId], f->getStatus());
+        contactListWidget->updateActivityDate(activityDate);
+    }
+
+    connect(form, &ChatForm::incomingNotification, this, &Widget::incomingNotification);
+    connect(form, &ChatForm::outgoingNotification, this, &Widget::outgoingNotification);
+    connect(form, &ChatForm::stopNotification, this, &Widget::onStopNotification);
+    connect(form, &ChatForm::endCallNotification, this, &Widget::onCallEnd);
+    connect(form, &ChatForm::rejectCall, this, &Widget::onRejectCall);
+
+    Profile* profile = Nexus::getProfile();
+    QPixmap avatar = profile->requestAvatar(friendPk);
+    if (!avatar.isNull()) {
+        form->onAvatarChange(friendId, avatar);
+    }
+
+    form->setStatusMessage(f->getStatusMessage());
+    return form;
 }
 
 void Widget::addFriendFailed(const ToxPk&, const QString& errorInfo)
@@ -1046,6 +1257,64 @@ void Widget::addFriendFailed(const ToxPk&, const QString& errorInfo)
     QMessageBox::critical(nullptr, "Error", info);
 }
 
+/**
+ * @brief Applies the friend events of one core loop iteration.
+ *
+ * Friends whose name changed or who went online or offline are put in their new place in the
+ * contact list together once all events are applied, and the list is only repainted once.
+ */
+void Widget::onFriendEventsReceived(const FriendEvents& events)
+{
+    contactListWidget->setUpdatesEnabled(false);
+    QSet<FriendWidget*> moved;
+
+    for (auto it = events.usernames.cbegin(); it != events.usernames.cend(); ++it) {
+        onFriendUsernameChanged(it.key(), it.value());
+        if (FriendWidget* widget = friendWidgets.value(it.key())) {
+            moved.insert(widget);
+        }
+    }
+
+    for (auto it = events.statusMessages.cbegin(); it != events.statusMessages.cend(); ++it) {
+        onFriendStatusMessageChanged(it.key(), it.value());
+    }
+
+    // before the status changes, so messages already received aren't sent again
+    for (const QPair<uint32_t, int>& receipt : events.receipts) {
+        onReceiptRecieved(receipt.first, receipt.second);
+    }
+
+    for (const QPair<uint32_t, Status>& status : events.statuses) {
+        const Friend* f = FriendList::findFriend(status.first);
+        FriendWidget* widget = friendWidgets.value(status.first);
+        if (f && widget
+            && (f->getStatus() == Status::Offline) != (status.second == Status::Offline)) {
+            moved.insert(widget);
+        }
+
+        onFriendStatusChanged(status.first, status.second);
+        if (ChatForm* form = chatForms.value(status.first)) {
+            form->onFriendStatusChanged(status.first, status.second);
+        }
+    }
+
+    for (auto it = events.typing.cbegin(); it != events.typing.cend(); ++it) {
+        onFriendTypingChanged(it.key(), it.value());
+    }
+
+    if (!moved.isEmpty()) {
+        contactListWidget->moveWidgets(moved.toList().toVector());
+    }
+
+    contactListWidget->setUpdatesEnabled(true);
+}
+
+/**
+ * @brief Updates a friend's status everywhere but in the contact list order.
+ *
+ * The widget is moved between the online and offline friends by onFriendEventsReceived(), after
+ * all status changes of a batch are applied.
+ */
 void Widget::onFriendStatusChanged(int friendId, Status status)
 {
     Friend* f = FriendList::findFriend(friendId);
@@ -1053,17 +1322,7 @@ void Widget::onFriendStatusChanged(int friendId, Status status)
         return;
     }
 
-    bool isActualChange = f->getStatus() != status;
-
     FriendWidget* widget = friendWidgets[friendId];
-    if (isActualChange) {
-        if (f->getStatus() == Status::Offline) {
-            contactListWidget->moveWidget(widget, Status::Online);
-        } else if (status == Status::Offline) {
-            contactListWidget->moveWidget(widget, Status::Offline);
-        }
-    }
-
     f->setStatus(status);
     widget->updateStatusLight();
     if (widget->isActive()) {
@@ -1085,7 +1344,9 @@ void Widget::onFriendStatusMessageChanged(int friendId, const QString& message)
     f->setStatusMessage(str);
 
     friendWidgets[friendId]->setStatusMsg(str);
-    chatForms[friendId]->setStatusMessage(str);
+    if (ChatForm* form = chatForms.value(friendId)) {
+        form->setStatusMessage(str);
+    }
 
     ContentDialog::updateFriendStatusMessage(friendId, message);
 }
@@ -1151,7 +1412,7 @@ void Widget::openDialog(GenericChatroomWidget* widget, bool newWindow)
     const Group* group = widget->getGroup();
     if (frnd) {
         id = frnd->getId();
-        form = chatForms[id];
+        form = getChatForm(id);
     } else {
         id = group->getId();
         form = groupChatForms[id];
@@ -1195,7 +1456,7 @@ void Widget::openDialog(GenericChatroomWidget* widget, bool newWindow)
     } else {
         hideMainForms(widget);
         if (frnd) {
-            chatForms[frnd->getId()]->show(contentLayout);
+            getChatForm(frnd->getId())->show(contentLayout);
         } else {
             groupChatForms[group->getId()]->show(contentLayout);
         }
@@ -1211,6 +1472,9 @@ void Widget::onFriendMessageReceived(int friendId, const QString& message, bool
         return;
     }
 
+    // before the message is saved, a new form would load it from the history as well
+    ChatForm* form = getChatForm(friendId);
+
     QDateTime timestamp = QDateTime::currentDateTime();
     Profile* profile = Nexus::getProfile();
     if (profile->isHistoryEnabled()) {
@@ -1223,9 +1487,50 @@ void Widget::onFriendMessageReceived(int friendId, const QString& message, bool
         profile->getHistory()->addNewMessage(publicKey, text, publicKey, timestamp, true, name);
     }
 
+    form->onFriendMessageReceived(friendId, message, isAction);
     newFriendMessageAlert(friendId);
 }
 
+void Widget::onFileReceiveRequested(const ToxFile& file)
+{
+    if (ChatForm* form = getChatForm(file.friendId)) {
+        form->onFileRecvRequest(file);
+    }
+}
+
+void Widget::onFileSendStarted(const ToxFile& file)
+{
+    if (ChatForm* form = getChatForm(file.friendId)) {
+        form->startFileSend(file);
+    }
+}
+
+void Widget::onFileSendFailed(uint32_t friendId, const QString& fname)
+{
+    if (ChatForm* form = getChatForm(friendId)) {
+        form->onFileSendFailed(friendId, fname);
+    }
+}
+
+void Widget::onFileNameChanged(const ToxPk& friendPk)
+{
+    const Friend* f = FriendList::findFriend(friendPk);
+    if (!f) {
+        return;
+    }
+
+    if (ChatForm* form = getChatForm(f->getId())) {
+        form->onFileNameChanged(friendPk);
+    }
+}
+
+void Widget::onAvInvite(uint32_t friendId, bool video)
+{
+    if (ChatForm* form = getChatForm(friendId)) {
+        form->onAvInvite(friendId, video);
+    }
+}
+
 void Widget::onReceiptRecieved(int friendId, int receipt)
 {
     Friend* f = FriendList::findFriend(friendId);
@@ -1233,7 +1538,9 @@ void Widget::onReceiptRecieved(int friendId, int receipt)
         return;
     }
 
-    chatForms[friendId]->getOfflineMsgEngine()->dischargeReceipt(receipt);
+    if (ChatForm* form = chatForms.value(friendId)) {
+        form->getOfflineMsgEngine()->dischargeReceipt(receipt);
+    }
 }
 
 void Widget::addFriendDialog(const Friend* frnd, ContentDialog* dialog)
@@ -1247,7 +1554,7 @@ void Widget::addFriendDialog(const Friend* frnd, ContentDialog* dialog)
         onAddClicked();
     }
 
-    auto form = chatForms[friendId];
+    auto form = getChatForm(friendId);
     auto chatroom = friendChatrooms[friendId];
     FriendWidget* friendWidget = dialog->addFriend(chatroom, form);
 
@@ -1285,7 +1592,8 @@ void Widget::addFriendDialog(const Friend* frnd, ContentDialog* dialog)
     connect(core, &Core::friendAvatarChanged, friendWidget, &FriendWidget::onAvatarChange);
     connect(core, &Core::friendAvatarRemoved, friendWidget, &FriendWidget::onAvatarRemoved);
 
-    QPixmap avatar = Nexus::getProfile()->loadAvatar(frnd->getPublicKey());
+    Profile* profile = Nexus::getProfile();
+    QPixmap avatar = profile->requestAvatar(frnd->getPublicKey());
     if (!avatar.isNull()) {
         friendWidget->onAvatarChange(frnd->getPublicKey(), avatar);
     }
@@ -1528,9 +1836,9 @@ void Widget::removeFriend(Friend* f, bool fake)
     friendWidgets.remove(friendId);
     delete widget;
 
-    auto chatForm = chatForms[friendId];
-    chatForms.remove(friendId);
-    delete chatForm;
+    // nullptr if the chat was never needed or released already
+    delete chatForms.take(friendId);
+    chatFormsUsed.remove(friendId);
 
     delete f;
     if (contentLayout && contentLayout->mainHead->layout()->isEmpty()) {
@@ -2138,7 +2446,9 @@ void Widget::onFriendTypingChanged(int friendId, bool isTyping)
         return;
     }
 
-    chatForms[friendId]->setFriendTyping(isTyping);
+    if (ChatForm* form = chatForms.value(friendId)) {
+        form->setFriendTyping(isTyping);
+    }
 }
 
 void Widget::onSetShowSystemTray(bool newValue)
@@ -2208,9 +2518,8 @@ bool Widget::filterOnline(FilterCriteria index)
 
 void Widget::clearAllReceipts()
 {
-    QList<Friend*> frnds = FriendList::getAllFriends();
-    for (Friend* f : frnds) {
-        chatForms[f->getId()]->getOfflineMsgEngine()->removeAllReceipts();
+    for (ChatForm* form : chatForms) {
+        form->getOfflineMsgEngine()->removeAllReceipts();
     }
 }
 
@@ -2534,7 +2843,7 @@ void Widget::focusChatInput()
 {
     if (activeChatroomWidget) {
         if (const Friend* f = activeChatroomWidget->getFriend()) {
-            chatForms[f->getId()]->focusInput();
+            getChatForm(f->getId())->focusInput();
         } else if (Group* g = activeChatroomWidget->getGroup()) {
             groupChatForms[g->getId()]->focusInput();
         }
@@ -22,7 +22,9 @@
 
 #include "ui_mainwindow.h"
 
+#include <QElapsedTimer>
 #include <QFileInfo>
+#include <QHash>
 #include <QMainWindow>
 #include <QPointer>
 #include <QSystemTrayIcon>
@@ -156,13 +158,20 @@ public slots:
     void setUsername(const QString& username);
     void setStatusMessage(const QString& statusMessage);
     void addFriend(uint32_t friendId, const ToxPk& friendPk);
+    void addFriends(const QVector<FriendInfo>& friends);
     void addFriendFailed(const ToxPk& userId, const QString& errorInfo = QString());
+    void onFriendEventsReceived(const FriendEvents& events);
     void onFriendStatusChanged(int friendId, Status status);
     void onFriendStatusMessageChanged(int friendId, const QString& message);
     void onFriendDisplayedNameChanged(const QString& displayed);
     void onFriendUsernameChanged(int friendId, const QString& username);
     void onFriendAliasChanged(uint32_t friendId, const QString& alias);
     void onFriendMessageReceived(int friendId, const QString& message, bool isAction);
+    void onFileReceiveRequested(const ToxFile& file);
+    void onFileSendStarted(const ToxFile& file);
+    void onFileSendFailed(uint32_t friendId, const QString& fname);
+    void onFileNameChanged(const ToxPk& friendPk);
+    void onAvInvite(uint32_t friendId, bool video);
     void onFriendRequestReceived(const ToxPk& friendPk, const QString& message);
     void updateFriendActivity(const Friend* frnd);
     void onMessageSendResult(uint32_t friendId, const QString& message, int messageId);
@@ -224,6 +233,10 @@ private slots:
     void incomingNotification(uint32_t friendId);
     void onRejectCall(uint32_t friendId);
     void onStopNotification();
+    void onAvatarLoaded(const ToxPk& owner, const QPixmap& pixmap);
+    void loadUndeliveredChats();
+    void onChatIdleTimeChanged(int minutes);
+    void releaseIdleChatForms();
 
 private:
     // QMainWindow overrides
@@ -238,6 +251,8 @@ private:
     void setActiveToolMenuButton(ActiveToolMenuButton newActiveButton);
     void hideMainForms(GenericChatroomWidget* chatroomWidget);
     Group* createGroup(int groupId);
+    FriendWidget* createFriendWidget(uint32_t friendId, const ToxPk& friendPk);
+    ChatForm* getChatForm(uint32_t friendId);
     void removeFriend(Friend* f, bool fake = false);
     void removeGroup(Group* g, bool fake = false);
     void saveWindowGeometry();
@@ -308,6 +323,8 @@ private:
     QMap<uint32_t, FriendWidget*> friendWidgets;
     QMap<uint32_t, std::shared_ptr<FriendChatroom>> friendChatrooms;
     QMap<uint32_t, ChatForm*> chatForms;
+    QHash<uint32_t, QElapsedTimer> chatFormsUsed;
+    QTimer* chatIdleTimer;
 
     QMap<uint32_t, GroupWidget*> groupWidgets;
     QMap<uint32_t, std::shared_ptr<GroupChatroom>> groupChatrooms;
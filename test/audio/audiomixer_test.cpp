@@ -0,0 +1,118 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "src/audio/audiomixer.h"
+
+#include <QtTest/QtTest>
+
+#include <vector>
+
+namespace {
+const unsigned frameSamples = 960;
+const uint32_t rate = 48000;
+
+std::vector<int16_t> makeFrame(int16_t value, uint8_t channels = 1)
+{
+    return std::vector<int16_t>(frameSamples * channels, value);
+}
+}
+
+class TestAudioMixer : public QObject
+{
+    Q_OBJECT
+private slots:
+    void jitterBufferTest();
+    void sumTest();
+    void saturationTest();
+    void gainTest();
+    void channelConversionTest();
+};
+
+void TestAudioMixer::jitterBufferTest()
+{
+    AudioMixer mixer;
+    QVERIFY(!mixer.mixFrame());
+
+    const auto frame = makeFrame(100);
+    mixer.addPeerFrame(0, frame.data(), frameSamples, 1, rate);
+    QVERIFY(!mixer.mixFrame());
+
+    mixer.addPeerFrame(0, frame.data(), frameSamples, 1, rate);
+    QVERIFY(mixer.mixFrame());
+    QCOMPARE(mixer.frameSamples(), frameSamples);
+    QCOMPARE(mixer.frameChannels(), static_cast<uint8_t>(1));
+    QCOMPARE(mixer.frameRate(), rate);
+    QCOMPARE(mixer.frameData()[0], static_cast<int16_t>(100));
+    QVERIFY(!mixer.mixFrame());
+}
+
+void TestAudioMixer::sumTest()
+{
+    AudioMixer mixer;
+    const auto a = makeFrame(100);
+    const auto b = makeFrame(-30);
+    mixer.addPeerFrame(0, a.data(), frameSamples, 1, rate);
+    mixer.addPeerFrame(1, b.data(), frameSamples, 1, rate);
+    mixer.addPeerFrame(0, a.data(), frameSamples, 1, rate);
+    QVERIFY(mixer.mixFrame());
+    QCOMPARE(mixer.frameData()[frameSamples - 1], static_cast<int16_t>(70));
+}
+
+void TestAudioMixer::saturationTest()
+{
+    AudioMixer mixer;
+    const auto loud = makeFrame(30000);
+    for (int peer = 0; peer < 2; ++peer) {
+        mixer.addPeerFrame(peer, loud.data(), frameSamples, 1, rate);
+        mixer.addPeerFrame(peer, loud.data(), frameSamples, 1, rate);
+    }
+    QVERIFY(mixer.mixFrame());
+    QCOMPARE(mixer.frameData()[0], std::numeric_limits<int16_t>::max());
+}
+
+void TestAudioMixer::gainTest()
+{
+    AudioMixer mixer;
+    mixer.setPeerGain(0, 0.5);
+    mixer.setPeerGain(1, 0.0);
+    const auto frame = makeFrame(1000);
+    for (int peer = 0; peer < 2; ++peer) {
+        mixer.addPeerFrame(peer, frame.data(), frameSamples, 1, rate);
+        mixer.addPeerFrame(peer, frame.data(), frameSamples, 1, rate);
+    }
+    QVERIFY(mixer.mixFrame());
+    QCOMPARE(mixer.frameData()[0], static_cast<int16_t>(500));
+}
+
+void TestAudioMixer::channelConversionTest()
+{
+    AudioMixer mixer;
+    const auto stereo = makeFrame(200, 2);
+    const auto mono = makeFrame(50);
+    mixer.addPeerFrame(0, stereo.data(), frameSamples, 2, rate);
+    mixer.addPeerFrame(0, stereo.data(), frameSamples, 2, rate);
+    mixer.addPeerFrame(1, mono.data(), frameSamples, 1, rate);
+    QVERIFY(mixer.mixFrame());
+    QCOMPARE(mixer.frameChannels(), static_cast<uint8_t>(2));
+    QCOMPARE(mixer.frameData()[0], static_cast<int16_t>(250));
+    QCOMPARE(mixer.frameData()[1], static_cast<int16_t>(250));
+}
+
+QTEST_GUILESS_MAIN(TestAudioMixer)
+#include "audiomixer_test.moc"
@@ -0,0 +1,79 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "src/audio/gainkernel.h"
+
+#include <QtTest/QtTest>
+
+#include <cstdlib>
+#include <vector>
+
+namespace {
+// 20 ms of 48 kHz stereo audio
+const size_t frameSize = 1920;
+
+std::vector<int16_t> makeNoise(size_t samples)
+{
+    std::vector<int16_t> data(samples);
+    std::srand(42);
+    for (int16_t& sample : data) {
+        sample = static_cast<int16_t>(std::rand() % 65536 - 32768);
+    }
+    return data;
+}
+}
+
+/**
+ * @brief Micro-benchmark of the gain kernels, not run by ctest.
+ *
+ * Build with -DBENCHMARKS=ON and run bench_gainkernel, the QtTest options like -iterations or
+ * -tickcounter apply.
+ */
+class BenchGainKernel : public QObject
+{
+    Q_OBJECT
+private slots:
+    void benchmarkKernel_data();
+    void benchmarkKernel();
+};
+
+void BenchGainKernel::benchmarkKernel_data()
+{
+    QTest::addColumn<int>("kernel");
+
+    const std::vector<GainKernel::Implementation> kernels = GainKernel::supportedImplementations();
+    for (size_t kernel = 0; kernel < kernels.size(); ++kernel) {
+        QTest::newRow(kernels[kernel].name) << static_cast<int>(kernel);
+    }
+}
+
+void BenchGainKernel::benchmarkKernel()
+{
+    QFETCH(int, kernel);
+    const GainKernel::KernelFunction function =
+        GainKernel::supportedImplementations()[static_cast<size_t>(kernel)].function;
+
+    std::vector<int16_t> data = makeNoise(frameSize);
+    QBENCHMARK {
+        function(data.data(), frameSize, 1.0f);
+    }
+}
+
+QTEST_GUILESS_MAIN(BenchGainKernel)
+#include "gainkernel_bench.moc"
@@ -0,0 +1,113 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "src/audio/gainkernel.h"
+
+#include <QtTest/QtTest>
+
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+namespace {
+// 20 ms of 48 kHz stereo audio, plus a few samples to hit the scalar tail of the vector loops
+const size_t frameSize = 1923;
+
+std::vector<int16_t> makeNoise(size_t samples)
+{
+    std::vector<int16_t> data(samples);
+    std::srand(42);
+    for (int16_t& sample : data) {
+        sample = static_cast<int16_t>(std::rand() % 65536 - 32768);
+    }
+    return data;
+}
+}
+
+class TestGainKernel : public QObject
+{
+    Q_OBJECT
+private slots:
+    void matchesScalar_data();
+    void matchesScalar();
+    void saturationTest();
+    void silenceTest();
+};
+
+void TestGainKernel::matchesScalar_data()
+{
+    QTest::addColumn<int>("kernel");
+    QTest::addColumn<float>("gain");
+
+    const std::vector<GainKernel::Implementation> kernels = GainKernel::supportedImplementations();
+    const float gains[] = {0.0316f, 1.0f, 3.1623f, 31.623f};
+    for (size_t kernel = 0; kernel < kernels.size(); ++kernel) {
+        for (float gain : gains) {
+            const QByteArray row =
+                QByteArray(kernels[kernel].name) + " x" + QByteArray::number(gain);
+            QTest::newRow(row.constData()) << static_cast<int>(kernel) << gain;
+        }
+    }
+}
+
+/**
+ * @brief Every kernel the CPU supports has to match the scalar reference, not just the one
+ * apply() dispatches to.
+ */
+void TestGainKernel::matchesScalar()
+{
+    QFETCH(int, kernel);
+    QFETCH(float, gain);
+    const GainKernel::KernelFunction function =
+        GainKernel::supportedImplementations()[static_cast<size_t>(kernel)].function;
+
+    std::vector<int16_t> reference = makeNoise(frameSize);
+    std::vector<int16_t> data = reference;
+    const GainKernel::Level expected = GainKernel::applyScalar(reference.data(), frameSize, gain);
+    const GainKernel::Level actual = function(data.data(), frameSize, gain);
+
+    for (size_t i = 0; i < frameSize; ++i) {
+        // rounding of exact halves may differ by one
+        QVERIFY(std::abs(reference[i] - data[i]) <= 1);
+    }
+    QVERIFY(qAbs(expected.rms - actual.rms) < 1e-4f);
+    QVERIFY(qAbs(expected.peak - actual.peak) < 1e-6f);
+}
+
+void TestGainKernel::saturationTest()
+{
+    std::vector<int16_t> data(frameSize, 20000);
+    data[1] = -20000;
+    const GainKernel::Level level = GainKernel::apply(data.data(), frameSize, 4.0f);
+    QCOMPARE(data[0], std::numeric_limits<int16_t>::max());
+    QCOMPARE(data[1], std::numeric_limits<int16_t>::min());
+    QCOMPARE(data[frameSize - 1], std::numeric_limits<int16_t>::max());
+    QCOMPARE(level.peak, 1.0f);
+}
+
+void TestGainKernel::silenceTest()
+{
+    std::vector<int16_t> data(frameSize, 0);
+    const GainKernel::Level level = GainKernel::apply(data.data(), frameSize, 10.0f);
+    QCOMPARE(level.rms, 0.0f);
+    QCOMPARE(level.peak, 0.0f);
+}
+
+QTEST_GUILESS_MAIN(TestGainKernel)
+#include "gainkernel_test.moc"
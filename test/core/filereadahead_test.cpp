@@ -0,0 +1,129 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "src/core/filereadahead.h"
+
+#include <QElapsedTimer>
+#include <QTemporaryFile>
+#include <QThread>
+#include <QtTest/QtTest>
+
+#include <cstring>
+
+namespace {
+const int chunkSize = 1371;
+const int timeout = 5000;
+
+/**
+ * @brief Polls the read-ahead buffer until it answers the way toxcore would see it.
+ */
+qint64 readChunk(FileReadAhead& reader, quint64 pos, size_t length, const uint8_t** data)
+{
+    QElapsedTimer timer;
+    timer.start();
+    qint64 nread;
+    while (!(nread = reader.read(pos, length, data)) && timer.elapsed() < timeout) {
+        QThread::msleep(1);
+    }
+    return nread;
+}
+} // namespace
+
+class TestFileReadAhead : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void sequentialTest();
+    void seekTest();
+    void endOfFileTest();
+    void missingFileTest();
+    void closeTest();
+
+private:
+    QTemporaryFile file;
+    QByteArray content;
+};
+
+void TestFileReadAhead::initTestCase()
+{
+    content.resize(3 * FileReadAhead::BLOCK_SIZE + 123);
+    for (int i = 0; i < content.size(); ++i) {
+        content[i] = static_cast<char>(i * 7 + i / 251);
+    }
+
+    QVERIFY(file.open());
+    QCOMPARE(file.write(content), static_cast<qint64>(content.size()));
+    file.flush();
+}
+
+void TestFileReadAhead::sequentialTest()
+{
+    FileReadAhead reader{file.fileName()};
+    for (int pos = 0; pos < content.size(); pos += chunkSize) {
+        const size_t length = qMin(chunkSize, content.size() - pos);
+        const uint8_t* data = nullptr;
+        QCOMPARE(readChunk(reader, pos, length, &data), static_cast<qint64>(length));
+        QVERIFY(memcmp(data, content.constData() + pos, length) == 0);
+    }
+}
+
+void TestFileReadAhead::seekTest()
+{
+    FileReadAhead reader{file.fileName()};
+    const uint8_t* data = nullptr;
+    const quint64 far = 2 * FileReadAhead::BLOCK_SIZE + 17;
+    QCOMPARE(readChunk(reader, far, chunkSize, &data), static_cast<qint64>(chunkSize));
+    QVERIFY(memcmp(data, content.constData() + far, chunkSize) == 0);
+
+    QCOMPARE(readChunk(reader, 5, chunkSize, &data), static_cast<qint64>(chunkSize));
+    QVERIFY(memcmp(data, content.constData() + 5, chunkSize) == 0);
+}
+
+void TestFileReadAhead::endOfFileTest()
+{
+    FileReadAhead reader{file.fileName()};
+    const uint8_t* data = nullptr;
+    const quint64 tail = content.size() - 10;
+    QCOMPARE(readChunk(reader, tail, chunkSize, &data), static_cast<qint64>(10));
+    QVERIFY(memcmp(data, content.constData() + tail, 10) == 0);
+
+    QCOMPARE(readChunk(reader, content.size() + 1, chunkSize, &data), static_cast<qint64>(-1));
+}
+
+void TestFileReadAhead::missingFileTest()
+{
+    FileReadAhead reader{file.fileName() + ".missing"};
+    const uint8_t* data = nullptr;
+    QCOMPARE(readChunk(reader, 0, chunkSize, &data), static_cast<qint64>(-1));
+}
+
+void TestFileReadAhead::closeTest()
+{
+    FileReadAhead reader{file.fileName()};
+    const uint8_t* data = nullptr;
+    QCOMPARE(readChunk(reader, 0, chunkSize, &data), static_cast<qint64>(chunkSize));
+    QVERIFY(FileReadAhead::totalBuffered() >= chunkSize);
+    reader.close();
+    QCOMPARE(reader.read(chunkSize, chunkSize, &data), static_cast<qint64>(-1));
+    QCOMPARE(FileReadAhead::totalBuffered(), static_cast<qint64>(0));
+}
+
+QTEST_GUILESS_MAIN(TestFileReadAhead)
+#include "filereadahead_test.moc"
@@ -0,0 +1,225 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "src/core/transferscheduler.h"
+
+#include <tox/tox.h>
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QThread>
+
+#include <algorithm>
+
+/*
+ * Sends a file between two Tox instances on the loopback interface and prints the throughput,
+ * once with the old fixed 10 ms core loop interval and once with TransferScheduler.
+ *
+ * Usage: bench_filetransfer [size in MiB]
+ */
+
+namespace {
+const unsigned fixedInterval = 10;
+const qint64 connectTimeout = 60 * 1000;
+const qint64 transferTimeout = 10 * 60 * 1000;
+
+struct Peer
+{
+    Tox* tox = nullptr;
+    QByteArray data;
+    quint64 received = 0;
+    bool connected = false;
+    bool finished = false;
+    TransferScheduler scheduler;
+};
+
+void onFriendRequest(Tox* tox, const uint8_t* publicKey, const uint8_t*, size_t, void*)
+{
+    tox_friend_add_norequest(tox, publicKey, nullptr);
+}
+
+void onConnectionStatus(Tox*, uint32_t, TOX_CONNECTION status, void* vPeer)
+{
+    static_cast<Peer*>(vPeer)->connected = status != TOX_CONNECTION_NONE;
+}
+
+void onFileRecv(Tox* tox, uint32_t friendId, uint32_t fileId, uint32_t, uint64_t, const uint8_t*,
+                size_t, void*)
+{
+    tox_file_control(tox, friendId, fileId, TOX_FILE_CONTROL_RESUME, nullptr);
+}
+
+void onFileRecvChunk(Tox*, uint32_t, uint32_t, uint64_t, const uint8_t*, size_t length, void* vPeer)
+{
+    Peer* peer = static_cast<Peer*>(vPeer);
+    peer->received += length;
+    peer->scheduler.addBytes(length);
+    peer->finished = !length;
+}
+
+void onFileChunkRequest(Tox* tox, uint32_t friendId, uint32_t fileId, uint64_t pos, size_t length,
+                        void* vPeer)
+{
+    Peer* peer = static_cast<Peer*>(vPeer);
+    if (!length) {
+        return;
+    }
+
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(peer->data.constData()) + pos;
+    if (tox_file_send_chunk(tox, friendId, fileId, pos, data, length, nullptr)) {
+        peer->scheduler.addBytes(length);
+    }
+}
+
+Tox* makeTox()
+{
+    Tox_Options* options = tox_options_new(nullptr);
+    tox_options_set_ipv6_enabled(options, false);
+    tox_options_set_local_discovery_enabled(options, false);
+    Tox* tox = tox_new(options, nullptr);
+    tox_options_free(options);
+    if (!tox) {
+        return nullptr;
+    }
+
+    tox_callback_friend_request(tox, onFriendRequest);
+    tox_callback_friend_connection_status(tox, onConnectionStatus);
+    tox_callback_file_recv(tox, onFileRecv);
+    tox_callback_file_recv_chunk(tox, onFileRecvChunk);
+    tox_callback_file_chunk_request(tox, onFileChunkRequest);
+    return tox;
+}
+
+/**
+ * @brief Iterates both instances once and sleeps like Core::process would.
+ */
+void iterate(Peer& sender, Peer& receiver, bool adaptive, bool active)
+{
+    tox_iterate(sender.tox, &sender);
+    tox_iterate(receiver.tox, &receiver);
+
+    unsigned interval = std::min(tox_iteration_interval(sender.tox),
+                                 tox_iteration_interval(receiver.tox));
+    if (adaptive) {
+        interval = std::min({interval, sender.scheduler.nextInterval(active, false),
+                             receiver.scheduler.nextInterval(active, false)});
+    } else if (active) {
+        interval = std::min(interval, fixedInterval);
+    }
+
+    QThread::msleep(interval);
+}
+
+bool connectPeers(Peer& sender, Peer& receiver)
+{
+    uint8_t dhtId[TOX_PUBLIC_KEY_SIZE];
+    tox_self_get_dht_id(sender.tox, dhtId);
+    const uint16_t port = tox_self_get_udp_port(sender.tox, nullptr);
+    tox_bootstrap(receiver.tox, "127.0.0.1", port, dhtId, nullptr);
+
+    uint8_t address[TOX_ADDRESS_SIZE];
+    tox_self_get_address(receiver.tox, address);
+    const uint8_t message[] = "benchmark";
+    tox_friend_add(sender.tox, address, message, sizeof(message), nullptr);
+
+    QElapsedTimer timer;
+    timer.start();
+    while (!(sender.connected && receiver.connected)) {
+        if (timer.hasExpired(connectTimeout)) {
+            return false;
+        }
+
+        iterate(sender, receiver, false, false);
+    }
+
+    return true;
+}
+
+/**
+ * @brief Sends sender.data to the receiver.
+ * @return Throughput in MB/s, or a negative value on failure.
+ */
+double transfer(Peer& sender, Peer& receiver, bool adaptive)
+{
+    receiver.received = 0;
+    receiver.finished = false;
+
+    const uint8_t name[] = "benchmark";
+    if (tox_file_send(sender.tox, 0, TOX_FILE_KIND_DATA, sender.data.size(), nullptr, name,
+                      sizeof(name), nullptr)
+        == UINT32_MAX) {
+        return -1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    while (!receiver.finished) {
+        if (timer.hasExpired(transferTimeout)) {
+            return -1;
+        }
+
+        iterate(sender, receiver, adaptive, true);
+    }
+
+    const double seconds = std::max<qint64>(timer.elapsed(), 1) / 1000.0;
+    return receiver.received / seconds / 1000000.0;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QTextStream out(stdout);
+    const int mebibytes = argc > 1 ? QByteArray(argv[1]).toInt() : 64;
+    if (mebibytes <= 0) {
+        out << "Usage: " << argv[0] << " [size in MiB]" << endl;
+        return 1;
+    }
+
+    Peer sender;
+    Peer receiver;
+    sender.tox = makeTox();
+    receiver.tox = makeTox();
+    if (!sender.tox || !receiver.tox) {
+        out << "Failed to create the Tox instances" << endl;
+        return 1;
+    }
+
+    sender.data = QByteArray(mebibytes * 1024 * 1024, 'x');
+    int result = 0;
+    if (!connectPeers(sender, receiver)) {
+        out << "Failed to connect the Tox instances" << endl;
+        result = 1;
+    } else {
+        for (bool adaptive : {false, true}) {
+            const double speed = transfer(sender, receiver, adaptive);
+            out << (adaptive ? "adaptive interval: " : "fixed interval:    ");
+            if (speed < 0) {
+                out << "transfer failed" << endl;
+                result = 1;
+            } else {
+                out << QString::number(speed, 'f', 2) << " MB/s" << endl;
+            }
+        }
+    }
+
+    tox_kill(sender.tox);
+    tox_kill(receiver.tox);
+    return result;
+}
@@ -0,0 +1,176 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "src/core/filewritebehind.h"
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtTest/QtTest>
+
+#include <memory>
+#include <sodium.h>
+
+namespace {
+const int chunkSize = 1371;
+const int timeout = 5000;
+} // namespace
+
+class TestFileWriteBehind : public QObject
+{
+    Q_OBJECT
+private slots:
+    void writeTest();
+    void pendingTest();
+    void failureTest();
+    void checkpointTest();
+    void hashTest();
+
+private:
+    QTemporaryDir dir;
+};
+
+void TestFileWriteBehind::writeTest()
+{
+    const QString path = dir.filePath("write");
+    std::shared_ptr<QFile> file{new QFile(path)};
+    QVERIFY(file->open(QIODevice::ReadWrite));
+
+    QByteArray content(3 * 1024 * 1024 + 17, '\0');
+    for (int i = 0; i < content.size(); ++i) {
+        content[i] = static_cast<char>(i * 13 + i / 509);
+    }
+
+    FileWriteBehind writer{file};
+    for (int pos = 0; pos < content.size(); pos += chunkSize) {
+        const int length = qMin(chunkSize, content.size() - pos);
+        QVERIFY(writer.write(reinterpret_cast<const uint8_t*>(content.constData() + pos), length));
+    }
+
+    writer.close();
+    QTRY_VERIFY_WITH_TIMEOUT(writer.isFinished(), timeout);
+    QVERIFY(!writer.hasFailed());
+    QCOMPARE(writer.pending(), static_cast<qint64>(0));
+    QVERIFY(!file->isOpen());
+
+    QFile result{path};
+    QVERIFY(result.open(QIODevice::ReadOnly));
+    QCOMPARE(result.readAll(), content);
+}
+
+void TestFileWriteBehind::pendingTest()
+{
+    std::shared_ptr<QFile> file{new QFile(dir.filePath("pending"))};
+    QVERIFY(file->open(QIODevice::ReadWrite));
+
+    FileWriteBehind writer{file};
+    const QByteArray chunk(chunkSize, 'x');
+    QVERIFY(writer.write(reinterpret_cast<const uint8_t*>(chunk.constData()), chunk.size()));
+    QVERIFY(writer.pending() <= chunk.size());
+    QTRY_COMPARE_WITH_TIMEOUT(writer.pending(), static_cast<qint64>(0), timeout);
+    QCOMPARE(FileWriteBehind::totalPending(), static_cast<qint64>(0));
+    QVERIFY(!writer.isFinished());
+}
+
+void TestFileWriteBehind::failureTest()
+{
+    const QString path = dir.filePath("readonly");
+    QFile create{path};
+    QVERIFY(create.open(QIODevice::WriteOnly));
+    create.close();
+
+    std::shared_ptr<QFile> file{new QFile(path)};
+    QVERIFY(file->open(QIODevice::ReadOnly));
+
+    FileWriteBehind writer{file};
+    const QByteArray chunk(chunkSize, 'x');
+    writer.write(reinterpret_cast<const uint8_t*>(chunk.constData()), chunk.size());
+    QTRY_VERIFY_WITH_TIMEOUT(writer.hasFailed(), timeout);
+    QVERIFY(!writer.write(reinterpret_cast<const uint8_t*>(chunk.constData()), chunk.size()));
+}
+
+void TestFileWriteBehind::checkpointTest()
+{
+    const QString path = dir.filePath("checkpoint");
+    std::shared_ptr<QFile> file{new QFile(path)};
+    QVERIFY(file->open(QIODevice::ReadWrite));
+
+    const QByteArray first(FileWriteBehind::CHECKSUM_WINDOW + chunkSize, 'a');
+    FileWriteBehind writer{file};
+    QVERIFY(writer.write(reinterpret_cast<const uint8_t*>(first.constData()), first.size()));
+    writer.close();
+    QTRY_VERIFY_WITH_TIMEOUT(writer.isFinished(), timeout);
+
+    const FileWriteBehind::Checkpoint checkpoint = writer.checkpoint();
+    QCOMPARE(checkpoint.offset, static_cast<quint64>(first.size()));
+
+    // continue the partial file like after a restart
+    std::shared_ptr<QFile> reopened{new QFile(path)};
+    QVERIFY(reopened->open(QIODevice::ReadWrite));
+    const QByteArray tail = FileWriteBehind::readTail(*reopened, checkpoint.offset);
+    QCOMPARE(FileWriteBehind::checksum(tail), checkpoint.checksum);
+    QVERIFY(reopened->seek(checkpoint.offset));
+
+    const QByteArray second(chunkSize, 'b');
+    FileWriteBehind resumed{reopened, checkpoint.offset, tail};
+    QCOMPARE(resumed.checkpoint().checksum, checkpoint.checksum);
+    QVERIFY(resumed.write(reinterpret_cast<const uint8_t*>(second.constData()), second.size()));
+    resumed.close();
+    QTRY_VERIFY_WITH_TIMEOUT(resumed.isFinished(), timeout);
+    QCOMPARE(resumed.checkpoint().offset, static_cast<quint64>(first.size() + second.size()));
+
+    QFile result{path};
+    QVERIFY(result.open(QIODevice::ReadOnly));
+    QCOMPARE(result.readAll(), first + second);
+    const QByteArray resultTail = FileWriteBehind::readTail(result, first.size() + second.size());
+    QCOMPARE(FileWriteBehind::checksum(resultTail), resumed.checkpoint().checksum);
+}
+
+void TestFileWriteBehind::hashTest()
+{
+    std::shared_ptr<QFile> file{new QFile(dir.filePath("hash"))};
+    QVERIFY(file->open(QIODevice::ReadWrite));
+
+    QByteArray content(256 * 1024 + 3, '\0');
+    for (int i = 0; i < content.size(); ++i) {
+        content[i] = static_cast<char>(i * 7 + i / 251);
+    }
+
+    QByteArray expected(crypto_generichash_BYTES, '\0');
+    crypto_generichash(reinterpret_cast<uint8_t*>(expected.data()), expected.size(),
+                       reinterpret_cast<const uint8_t*>(content.constData()), content.size(),
+                       nullptr, 0);
+
+    FileWriteBehind writer{file};
+    QVERIFY(writer.enableHash());
+    for (int pos = 0; pos < content.size(); pos += chunkSize) {
+        const int length = qMin(chunkSize, content.size() - pos);
+        QVERIFY(writer.write(reinterpret_cast<const uint8_t*>(content.constData() + pos), length));
+    }
+
+    // the data written so far couldn't be part of the digest anymore
+    QVERIFY(!writer.enableHash());
+    QVERIFY(writer.digest().isEmpty());
+
+    writer.close();
+    QTRY_VERIFY_WITH_TIMEOUT(writer.isFinished(), timeout);
+    QCOMPARE(writer.digest(), expected);
+}
+
+QTEST_GUILESS_MAIN(TestFileWriteBehind)
+#include "filewritebehind_test.moc"
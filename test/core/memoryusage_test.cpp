@@ -0,0 +1,104 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "src/core/memoryusage.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QtTest/QtTest>
+
+class TestMemoryUsage : public QObject
+{
+    Q_OBJECT
+private slots:
+    void collectTest();
+    void jsonTest();
+    void writeTest();
+
+private:
+    QTemporaryDir dir;
+};
+
+void TestMemoryUsage::collectTest()
+{
+    qint64 lines = 3;
+    const int first = MemoryUsage::addSource([&lines]() {
+        return MemoryUsage::Entry{"chatlog", "first", lines, lines * 100};
+    });
+    const int second =
+        MemoryUsage::addSource([]() { return MemoryUsage::Entry{"cache", "second", 1, 10}; });
+
+    QVector<MemoryUsage::Entry> entries = MemoryUsage::collect();
+    QCOMPARE(entries.size(), 2);
+    QCOMPARE(entries[0].name, QStringLiteral("first"));
+    QCOMPARE(entries[0].bytes, static_cast<qint64>(300));
+    QCOMPARE(entries[1].name, QStringLiteral("second"));
+
+    // sources are asked again on every collect
+    lines = 5;
+    MemoryUsage::removeSource(second);
+    entries = MemoryUsage::collect();
+    QCOMPARE(entries.size(), 1);
+    QCOMPARE(entries[0].count, static_cast<qint64>(5));
+
+    MemoryUsage::removeSource(first);
+    QVERIFY(MemoryUsage::collect().isEmpty());
+}
+
+void TestMemoryUsage::jsonTest()
+{
+    const QVector<MemoryUsage::Entry> entries{{"chatlog", "friend 1", 2, 200},
+                                              {"chatlog", "friend 2", 1, 50},
+                                              {"sqlite", "page cache", 1, 4096}};
+    const QJsonObject json = QJsonDocument::fromJson(MemoryUsage::toJson(entries)).object();
+
+    QCOMPARE(json["totalBytes"].toDouble(), 4346.0);
+    const QJsonObject subsystems = json["subsystems"].toObject();
+    QCOMPARE(subsystems["chatlog"].toDouble(), 250.0);
+    QCOMPARE(subsystems["sqlite"].toDouble(), 4096.0);
+
+    const QJsonArray list = json["entries"].toArray();
+    QCOMPARE(list.size(), 3);
+    const QJsonObject entry = list[1].toObject();
+    QCOMPARE(entry["subsystem"].toString(), QStringLiteral("chatlog"));
+    QCOMPARE(entry["name"].toString(), QStringLiteral("friend 2"));
+    QCOMPARE(entry["count"].toDouble(), 1.0);
+    QCOMPARE(entry["bytes"].toDouble(), 50.0);
+}
+
+void TestMemoryUsage::writeTest()
+{
+    const int id =
+        MemoryUsage::addSource([]() { return MemoryUsage::Entry{"cache", "icons", 4, 64}; });
+    const QString path = dir.filePath("sub/memory.json");
+    QVERIFY(MemoryUsage::writeJson(path));
+    MemoryUsage::removeSource(id);
+
+    QFile file{path};
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QJsonObject json = QJsonDocument::fromJson(file.readAll()).object();
+    QCOMPARE(json["totalBytes"].toDouble(), 64.0);
+    QCOMPARE(json["entries"].toArray().size(), 1);
+}
+
+QTEST_GUILESS_MAIN(TestMemoryUsage)
+#include "memoryusage_test.moc"
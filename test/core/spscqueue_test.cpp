@@ -0,0 +1,101 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "src/core/spscqueue.h"
+
+#include <QtTest/QtTest>
+#include <QThread>
+
+#include <thread>
+
+class TestSpscQueue : public QObject
+{
+    Q_OBJECT
+private slots:
+    void emptyTest();
+    void fullTest();
+    void orderTest();
+    void threadedTest();
+};
+
+void TestSpscQueue::emptyTest()
+{
+    SpscQueue<int, 4> queue;
+    QVERIFY(queue.isEmpty());
+    QVERIFY(queue.front() == nullptr);
+}
+
+void TestSpscQueue::fullTest()
+{
+    SpscQueue<int, 4> queue;
+    for (int i = 0; i < 4; ++i) {
+        int* slot = queue.writeSlot();
+        QVERIFY(slot != nullptr);
+        *slot = i;
+        queue.push();
+    }
+    QVERIFY(queue.writeSlot() == nullptr);
+
+    queue.pop();
+    QVERIFY(queue.writeSlot() != nullptr);
+}
+
+void TestSpscQueue::orderTest()
+{
+    SpscQueue<int, 4> queue;
+    // wrap around a few times
+    for (int i = 0; i < 10; ++i) {
+        *queue.writeSlot() = i;
+        queue.push();
+        QCOMPARE(*queue.front(), i);
+        queue.pop();
+    }
+    QVERIFY(queue.isEmpty());
+}
+
+void TestSpscQueue::threadedTest()
+{
+    SpscQueue<int, 8> queue;
+    const int count = 1000;
+
+    std::thread producer([&queue, count]() {
+        for (int i = 0; i < count; ++i) {
+            int* slot;
+            while (!(slot = queue.writeSlot())) {
+                QThread::yieldCurrentThread();
+            }
+            *slot = i;
+            queue.push();
+        }
+    });
+
+    for (int expected = 0; expected < count; ++expected) {
+        int* slot;
+        while (!(slot = queue.front())) {
+            QThread::yieldCurrentThread();
+        }
+        QCOMPARE(*slot, expected);
+        queue.pop();
+    }
+
+    producer.join();
+}
+
+QTEST_GUILESS_MAIN(TestSpscQueue)
+#include "spscqueue_test.moc"
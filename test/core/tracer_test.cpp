@@ -0,0 +1,125 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "src/core/tracer.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QtTest/QtTest>
+
+namespace {
+class WorkerThread : public QThread
+{
+protected:
+    void run() override
+    {
+        Tracer::Span span{"worker"};
+    }
+};
+} // namespace
+
+class TestTracer : public QObject
+{
+    Q_OBJECT
+private slots:
+    void disabledTest();
+    void traceTest();
+
+private:
+    QJsonArray readEvents(const QString& path);
+
+private:
+    QTemporaryDir dir;
+};
+
+QJsonArray TestTracer::readEvents(const QString& path)
+{
+    QFile file{path};
+    if (!file.open(QIODevice::ReadOnly)) {
+        return {};
+    }
+
+    return QJsonDocument::fromJson(file.readAll()).object()["traceEvents"].toArray();
+}
+
+void TestTracer::disabledTest()
+{
+    QVERIFY(!Tracer::isEnabled());
+    {
+        Tracer::Span span{"ignored"};
+    }
+
+    QVERIFY(!Tracer::finish(dir.filePath("disabled.json")));
+    QVERIFY(!QFile::exists(dir.filePath("disabled.json")));
+}
+
+void TestTracer::traceTest()
+{
+    Tracer::start();
+    QVERIFY(Tracer::isEnabled());
+    {
+        Tracer::Span outer{"outer"};
+        Tracer::Span inner{"inner"};
+    }
+
+    WorkerThread thread;
+    thread.setObjectName("Worker");
+    thread.start();
+    QVERIFY(thread.wait(5000));
+
+    const QString path = dir.filePath("trace.json");
+    QVERIFY(Tracer::finish(path));
+    QVERIFY(!Tracer::isEnabled());
+
+    QHash<QString, QJsonObject> spans;
+    QHash<int, QString> threads;
+    for (const QJsonValue& value : readEvents(path)) {
+        const QJsonObject event = value.toObject();
+        if (event["ph"].toString() == "M") {
+            threads[event["tid"].toInt()] = event["args"].toObject()["name"].toString();
+        } else {
+            QCOMPARE(event["ph"].toString(), QStringLiteral("X"));
+            spans[event["name"].toString()] = event;
+        }
+    }
+
+    QCOMPARE(spans.size(), 3);
+    const QJsonObject outer = spans["outer"];
+    const QJsonObject inner = spans["inner"];
+    QVERIFY(outer["ts"].toDouble() <= inner["ts"].toDouble());
+    QVERIFY(outer["ts"].toDouble() + outer["dur"].toDouble()
+            >= inner["ts"].toDouble() + inner["dur"].toDouble());
+    QCOMPARE(inner["tid"].toInt(), outer["tid"].toInt());
+    QVERIFY(spans["worker"]["tid"].toInt() != outer["tid"].toInt());
+    QCOMPARE(threads[spans["worker"]["tid"].toInt()], QStringLiteral("Worker"));
+
+    // nothing is recorded after finishing
+    {
+        Tracer::Span span{"late"};
+    }
+
+    QVERIFY(!Tracer::finish(path));
+}
+
+QTEST_GUILESS_MAIN(TestTracer)
+#include "tracer_test.moc"
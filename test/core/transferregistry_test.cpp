@@ -0,0 +1,117 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "src/core/transferregistry.h"
+
+#include <QtTest/QtTest>
+
+class TestTransferRegistry : public QObject
+{
+    Q_OBJECT
+private slots:
+    void findTest();
+    void takeTest();
+    void friendFilesTest();
+    void progressTest();
+};
+
+void TestTransferRegistry::findTest()
+{
+    TransferRegistry registry;
+    QVERIFY(!registry.find(1, 2));
+
+    ToxFile file{2, 1, "name", "", ToxFile::SENDING};
+    TransferRegistry::Handle handle = registry.insert(file);
+    QVERIFY(handle);
+    QCOMPARE(registry.find(1, 2), handle);
+    QCOMPARE(registry.find(TransferRegistry::makeKey(1, 2)), handle);
+    QVERIFY(!registry.find(2, 1));
+
+    // changes through a handle are seen by everyone
+    handle->bytesSent = 42;
+    QCOMPARE(registry.find(1, 2)->bytesSent, static_cast<quint64>(42));
+}
+
+void TestTransferRegistry::takeTest()
+{
+    TransferRegistry registry;
+    registry.insert(ToxFile{2, 1, "name", "", ToxFile::SENDING});
+
+    TransferRegistry::Handle handle = registry.take(1, 2);
+    QVERIFY(handle);
+    QCOMPARE(handle->fileName, QByteArray("name"));
+    QVERIFY(!registry.find(1, 2));
+    QVERIFY(!registry.take(1, 2));
+    QVERIFY(registry.files().isEmpty());
+}
+
+void TestTransferRegistry::friendFilesTest()
+{
+    TransferRegistry registry;
+    // friends sharing a shard must not be mixed up
+    const uint32_t other = TransferRegistry::SHARD_COUNT + 1;
+    registry.insert(ToxFile{0, 1, "a", "", ToxFile::SENDING});
+    registry.insert(ToxFile{1, 1, "b", "", ToxFile::RECEIVING});
+    registry.insert(ToxFile{0, other, "c", "", ToxFile::SENDING});
+    registry.insert(ToxFile{0, 2, "d", "", ToxFile::SENDING});
+
+    QCOMPARE(registry.files().size(), 4);
+
+    const QVector<TransferRegistry::Handle> files = registry.filesOf(1);
+    QCOMPARE(files.size(), 2);
+    for (const TransferRegistry::Handle& file : files) {
+        QCOMPARE(file->friendId, static_cast<uint32_t>(1));
+    }
+
+    const QVector<TransferRegistry::Handle> otherFiles = registry.filesOf(other);
+    QCOMPARE(otherFiles.size(), 1);
+    QCOMPARE(otherFiles.first()->fileName, QByteArray("c"));
+
+    // the result doesn't change with the registry
+    registry.take(1, 0);
+    QCOMPARE(files.size(), 2);
+    QCOMPARE(registry.filesOf(1).size(), 1);
+}
+
+void TestTransferRegistry::progressTest()
+{
+    TransferRegistry registry;
+    ToxFileProgress progress;
+    QVERIFY(!registry.progress(1, 2, progress));
+
+    ToxFile file{2, 1, "name", "", ToxFile::RECEIVING};
+    file.filesize = 100;
+    TransferRegistry::Handle handle = registry.insert(file);
+    QVERIFY(registry.progress(1, 2, progress));
+    QCOMPARE(progress.bytesSent, static_cast<quint64>(0));
+    QCOMPARE(progress.filesize, static_cast<quint64>(100));
+
+    // only published changes are visible
+    handle->bytesSent = 50;
+    QVERIFY(registry.progress(1, 2, progress));
+    QCOMPARE(progress.bytesSent, static_cast<quint64>(0));
+
+    registry.publish(*handle);
+    QVERIFY(registry.progress(1, 2, progress));
+    QCOMPARE(progress.bytesSent, static_cast<quint64>(50));
+    QCOMPARE(progress.direction, ToxFile::RECEIVING);
+}
+
+QTEST_GUILESS_MAIN(TestTransferRegistry)
+#include "transferregistry_test.moc"
@@ -0,0 +1,84 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "src/core/transferscheduler.h"
+
+#include <QtTest/QtTest>
+
+class TestTransferScheduler : public QObject
+{
+    Q_OBJECT
+private slots:
+    void idleTest();
+    void tightenTest();
+    void backOffTest();
+    void waitingTest();
+};
+
+void TestTransferScheduler::idleTest()
+{
+    TransferScheduler scheduler;
+    QCOMPARE(scheduler.nextInterval(false, false), TransferScheduler::IDLE_INTERVAL);
+
+    // bytes of a transfer that just finished don't count for the next one
+    scheduler.addBytes(1024);
+    QCOMPARE(scheduler.nextInterval(false, false), TransferScheduler::IDLE_INTERVAL);
+    QCOMPARE(scheduler.currentInterval(), TransferScheduler::START_INTERVAL);
+}
+
+void TestTransferScheduler::tightenTest()
+{
+    TransferScheduler scheduler;
+    unsigned last = TransferScheduler::START_INTERVAL;
+    for (int i = 0; i < 10; ++i) {
+        scheduler.addBytes(1371);
+        const unsigned interval = scheduler.nextInterval(true, false);
+        QVERIFY(interval <= last);
+        last = interval;
+    }
+
+    QCOMPARE(last, TransferScheduler::MIN_INTERVAL);
+}
+
+void TestTransferScheduler::backOffTest()
+{
+    TransferScheduler scheduler;
+    unsigned last = TransferScheduler::START_INTERVAL;
+    for (int i = 0; i < 10; ++i) {
+        const unsigned interval = scheduler.nextInterval(true, false);
+        QVERIFY(interval >= last);
+        last = interval;
+    }
+
+    QCOMPARE(last, TransferScheduler::MAX_INTERVAL);
+
+    // data moving again tightens the loop right away
+    scheduler.addBytes(1371);
+    QVERIFY(scheduler.nextInterval(true, false) < TransferScheduler::MAX_INTERVAL);
+}
+
+void TestTransferScheduler::waitingTest()
+{
+    TransferScheduler scheduler;
+    QCOMPARE(scheduler.nextInterval(true, true), TransferScheduler::START_INTERVAL);
+    QCOMPARE(scheduler.nextInterval(true, true), TransferScheduler::START_INTERVAL);
+}
+
+QTEST_GUILESS_MAIN(TestTransferScheduler)
+#include "transferscheduler_test.moc"
@@ -0,0 +1,89 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "src/persistence/savescheduler.h"
+
+#include <QSignalSpy>
+#include <QtTest/QtTest>
+
+class TestSaveScheduler : public QObject
+{
+    Q_OBJECT
+private slots:
+    void coalesceTest();
+    void intervalTest();
+    void cancelTest();
+    void hashTest();
+};
+
+void TestSaveScheduler::coalesceTest()
+{
+    SaveScheduler scheduler{50, 0};
+    QSignalSpy spy{&scheduler, &SaveScheduler::saveDue};
+
+    // requests while one is pending don't push it further out
+    for (int i = 0; i < 5; ++i) {
+        scheduler.schedule();
+        QTest::qWait(5);
+    }
+    QVERIFY(spy.wait(200));
+    QTest::qWait(100);
+    QCOMPARE(spy.count(), 1);
+}
+
+void TestSaveScheduler::intervalTest()
+{
+    SaveScheduler scheduler{0, 300};
+    QSignalSpy spy{&scheduler, &SaveScheduler::saveDue};
+
+    scheduler.markSaved(SaveScheduler::hash("data"));
+    scheduler.schedule();
+    QTest::qWait(100);
+    QCOMPARE(spy.count(), 0);
+    QVERIFY(spy.wait(500));
+}
+
+void TestSaveScheduler::cancelTest()
+{
+    SaveScheduler scheduler{50, 0};
+    QSignalSpy spy{&scheduler, &SaveScheduler::saveDue};
+
+    scheduler.schedule();
+    scheduler.cancel();
+    QTest::qWait(150);
+    QCOMPARE(spy.count(), 0);
+}
+
+void TestSaveScheduler::hashTest()
+{
+    SaveScheduler scheduler{0, 0};
+    const QByteArray hash = SaveScheduler::hash("data");
+    QVERIFY(!scheduler.isSaved(hash));
+
+    scheduler.markSaved(hash);
+    QVERIFY(scheduler.isSaved(hash));
+    QVERIFY(!scheduler.isSaved(SaveScheduler::hash("other data")));
+
+    // with a new key the same data has to be written again
+    scheduler.forget();
+    QVERIFY(!scheduler.isSaved(hash));
+}
+
+QTEST_GUILESS_MAIN(TestSaveScheduler)
+#include "savescheduler_test.moc"
@@ -0,0 +1,148 @@
+/*
+    Copyright © 2018 by The qTox Project Contributors
+
+    This file is part of qTox, a Qt-based graphical interface for Tox.
+
+    qTox is libre software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    qTox is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with qTox.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "src/persistence/settingsserializer.h"
+
+#include <QSettings>
+#include <QTemporaryDir>
+#include <QtTest/QtTest>
+
+namespace {
+const int friendCount = 2000;
+} // namespace
+
+class TestSettingsSerializer : public QObject
+{
+    Q_OBJECT
+private slots:
+    void roundTripTest();
+    void arraysTest();
+    void iniTest();
+
+private:
+    QTemporaryDir dir;
+};
+
+void TestSettingsSerializer::roundTripTest()
+{
+    const QString path = dir.filePath("roundtrip.ini");
+    {
+        SettingsSerializer ps{path};
+        ps.beginGroup("General");
+        ps.setValue("name", "qTox");
+        ps.setValue("enabled", true);
+        ps.endGroup();
+        ps.beginGroup("Friends");
+        ps.beginWriteArray("Friend", friendCount);
+        for (int i = 0; i < friendCount; ++i) {
+            ps.setArrayIndex(i);
+            ps.setValue("addr", QString::number(i));
+            ps.setValue("circle", i % 7);
+        }
+        ps.endArray();
+        ps.endGroup();
+        ps.save();
+    }
+
+    QVERIFY(SettingsSerializer::isSerializedFormat(path));
+
+    SettingsSerializer ps{path};
+    ps.load();
+    ps.beginGroup("General");
+    QCOMPARE(ps.value("name").toString(), QStringLiteral("qTox"));
+    QCOMPARE(ps.value("enabled").toBool(), true);
+    QCOMPARE(ps.value("missing", 42).toInt(), 42);
+    ps.endGroup();
+
+    ps.beginGroup("Friends");
+    QCOMPARE(ps.beginReadArray("Friend"), friendCount);
+    for (int i = 0; i < friendCount; ++i) {
+        ps.setArrayIndex(i);
+        QCOMPARE(ps.value("addr").toString(), QString::number(i));
+        QCOMPARE(ps.value("circle").toInt(), i % 7);
+    }
+    ps.endArray();
+
+    // values outside of the array don't match array values with the same key
+    QVERIFY(!ps.value("addr").isValid());
+    ps.endGroup();
+}
+
+void TestSettingsSerializer::arraysTest()
+{
+    SettingsSerializer ps{dir.filePath("arrays.ini")};
+    ps.beginGroup("Group");
+    ps.beginWriteArray("First", 1);
+    ps.setArrayIndex(0);
+    ps.setValue("key", "first");
+    ps.endArray();
+    ps.beginWriteArray("Second", 1);
+    ps.setArrayIndex(0);
+    ps.setValue("key", "second");
+    ps.endArray();
+    ps.setValue("key", "group");
+
+    ps.beginReadArray("First");
+    ps.setArrayIndex(0);
+    QCOMPARE(ps.value("key").toString(), QStringLiteral("first"));
+    ps.endArray();
+    ps.beginReadArray("Second");
+    ps.setArrayIndex(0);
+    QCOMPARE(ps.value("key").toString(), QStringLiteral("second"));
+    ps.endArray();
+    QCOMPARE(ps.value("key").toString(), QStringLiteral("group"));
+}
+
+void TestSettingsSerializer::iniTest()
+{
+    const QString path = dir.filePath("legacy.ini");
+    {
+        QSettings s{path, QSettings::IniFormat};
+        s.beginGroup("Privacy");
+        s.setValue("name", "qTox");
+        s.endGroup();
+        s.beginGroup("Friends");
+        s.beginWriteArray("Friend", 3);
+        for (int i = 0; i < 3; ++i) {
+            s.setArrayIndex(i);
+            s.setValue("addr", QString::number(i * 10));
+        }
+        s.endArray();
+        s.endGroup();
+    }
+
+    QVERIFY(!SettingsSerializer::isSerializedFormat(path));
+
+    SettingsSerializer ps{path};
+    ps.load();
+    ps.beginGroup("Privacy");
+    QCOMPARE(ps.value("name").toString(), QStringLiteral("qTox"));
+    ps.endGroup();
+
+    ps.beginGroup("Friends");
+    QCOMPARE(ps.beginReadArray("Friend"), 3);
+    for (int i = 0; i < 3; ++i) {
+        // QSettings arrays start at 1
+        ps.setArrayIndex(i + 1);
+        QCOMPARE(ps.value("addr").toString(), QString::number(i * 10));
+    }
+}
+
+QTEST_GUILESS_MAIN(TestSettingsSerializer)
+#include "settingsserializer_test.moc"